@@ -2,7 +2,9 @@
 #define ANIMATIONSHADERS_H
 #include <string>
 
-static std::string animationVertexShader = R"(
+// Skinning stage, run once per frame with transform feedback. Writes the skinned position and
+// normal of every vertex so each pass that draws the character reuses them.
+static std::string skinningVertexShader = R"(
 #version 330 core
 
 // Input
@@ -12,48 +14,64 @@ layout(location = 2) in vec2 vertexUV;
 layout(location = 3) in vec4 joints;    // Joint indices
 layout(location = 4) in vec4 weights;   // Joint weights
 
+// Captured by transform feedback
+out vec3 skinnedPosition;
+out vec3 skinnedNormal;
 
-// Output data, to be interpolated for each fragment
-out vec3 worldPosition;
-out vec3 worldNormal;
-out vec2 worldUV;
-
-uniform mat4 MVP;
 const int MAX_JOINTS = 128;
-uniform mat4 jointMatrices[MAX_JOINTS];  // Array of joint matrices
+
+// Top three rows of each joint matrix, the last row of an affine transform is always (0,0,0,1)
+layout(std140) uniform JointPalette {
+    mat3x4 jointMatrices[MAX_JOINTS];
+};
 
 void main() {
     // Initialize transformed position and normal
-    vec4 skinnedPosition = vec4(0.0);
-    vec3 skinnedNormal = vec3(0.0);
+    vec3 position = vec3(0.0);
+    vec3 normal = vec3(0.0);
 
     // Apply skinning transformation
     for (int i = 0; i < 4; i++) {  // Assuming max 4 joints per vertex
-                                   int jointIndex = int(joints[i]);
-                                   float weight = weights[i];
-
-                                   // Skip if weight is zero
-                                   if (weight > 0.0) {
-                                       // Transform position and normal by joint matrix
-                                       skinnedPosition += jointMatrices[jointIndex] * vec4(vertexPosition, 1.0) * weight;
-
-                                       // Transform normal by joint matrix (excluding translation)
-                                       //mat3 normalMatrix = transpose(inverse(mat3(jointMatrices[jointIndex])));
-                                       mat3 jointRotation = mat3(jointMatrices[jointIndex]);
-                                       skinnedNormal += jointRotation * vertexNormal * weight;
-                                   }
+        int jointIndex = int(joints[i]);
+        float weight = weights[i];
+
+        // Skip if weight is zero
+        if (weight > 0.0) {
+            // Row-vector multiply applies the 3x4 joint transform
+            position += (vec4(vertexPosition, 1.0) * jointMatrices[jointIndex]) * weight;
+
+            // Transform normal by joint matrix (excluding translation)
+            normal += (vec4(vertexNormal, 0.0) * jointMatrices[jointIndex]) * weight;
+        }
     }
 
+    skinnedPosition = position;
+    skinnedNormal = normalize(normal);
+}
+)";
+
+// Draws pre-skinned vertices like a static mesh
+static std::string skinnedMeshVertexShader = R"(
+#version 330 core
+
+// Input
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+
+// Output data, to be interpolated for each fragment
+out vec3 worldPosition;
+out vec3 worldNormal;
+
+uniform mat4 MVP;
+
+void main() {
     // Transform vertex
-    gl_Position = MVP * skinnedPosition;
+    gl_Position = MVP * vec4(vertexPosition, 1.0);
 
     // World-space geometry
-    worldPosition = skinnedPosition.xyz;
-    worldNormal = normalize(skinnedNormal);
-    worldUV = vertexUV;
+    worldPosition = vertexPosition;
+    worldNormal = vertexNormal;
 }
-
-
 )";
 
 static std::string animationFragmentShader = R"(
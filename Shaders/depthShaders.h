@@ -13,6 +13,24 @@ void main()
 }
 )";
 
+// Depth pass of the static scene, reads the same ObjectTransform block as sceneLightingVertexShader
+static std::string sceneDepthVertexShader = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+layout(std140) uniform ObjectTransform {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+uniform mat4 lightSpaceMatrix;
+
+void main()
+{
+    gl_Position = lightSpaceMatrix * modelMatrix * vec4(aPos, 1.0);
+}
+)";
+
 static std::string depthFragmentShader = R"(
 #version 330 core
 
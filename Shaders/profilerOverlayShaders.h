@@ -0,0 +1,37 @@
+#include <string>
+
+static std::string profilerOverlayVertexShader = R"(
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+
+out vec2 texCoord;
+out vec4 color;
+
+uniform vec2 screenSize;
+
+void main()
+{
+    // Pixels from the top left corner
+    texCoord = aTexCoord;
+    color = aColor;
+    gl_Position = vec4(aPos.x / screenSize.x * 2.0 - 1.0, 1.0 - aPos.y / screenSize.y * 2.0, 0.0, 1.0);
+}
+)";
+
+static std::string profilerOverlayFragmentShader = R"(
+#version 330 core
+in vec2 texCoord;
+in vec4 color;
+out vec4 FragColor;
+
+uniform sampler2D fontAtlas;
+
+void main()
+{
+    // Negative texture coordinates mark solid quads, the rest are glyphs
+    float coverage = texCoord.x < 0.0 ? 1.0 : texture(fontAtlas, texCoord).r;
+    FragColor = vec4(color.rgb, color.a * coverage);
+}
+)";
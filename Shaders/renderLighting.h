@@ -38,6 +38,41 @@ void main() {
 )";
 
 
+// Variant for the static scene, the cached transforms of each object come from a uniform buffer
+// range bound per draw, so nothing is recomputed or re-uploaded while objects stay put.
+static std::string sceneLightingVertexShader = R"(
+#version 330 core
+
+// Input
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 vertexUV;
+
+// Output data, to be interpolated for each fragment
+out vec2 uv;
+out vec3 worldPosition;
+out vec3 worldNormal;
+out vec4 FragPositionLightSpace;
+
+layout(std140) uniform ObjectTransform {
+    mat4 modelMatrix;
+    mat4 normalMatrix;      // Upper 3x3 holds the inverse transpose of the model matrix
+};
+
+uniform mat4 viewProjection;
+uniform mat4 lightSpaceMatrix;
+
+void main() {
+    worldPosition = vec3(modelMatrix * vec4(vertexPosition, 1.0));
+    gl_Position = viewProjection * vec4(worldPosition, 1.0);
+
+    uv = vertexUV;
+    worldNormal = normalize(mat3(normalMatrix) * vertexNormal);
+
+    FragPositionLightSpace = lightSpaceMatrix * vec4(worldPosition, 1.0);
+}
+)";
+
 static std::string lightingFragmentShader = R"(
 #version 330 core
 
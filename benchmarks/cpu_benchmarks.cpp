@@ -0,0 +1,297 @@
+// Microbenchmarks of the CPU hot paths: sea waves, cloud particles, bot animation and the mountain
+// mesh. The systems are the ones main.cpp derives its GL structs from (scene/*.h), so the code
+// measured is the code the program runs. Nothing here needs a window, a GL context or a GL loader.
+//
+// Build from the repository root with only glm and tinygltf on the include path:
+//   g++ -O2 -std=c++17 -I. -I<glm> -I<tinygltf> benchmarks/cpu_benchmarks.cpp -o cpu_benchmarks -pthread
+// Add -DTRACK_ALLOCATIONS to also count heap allocations per iteration.
+#define ALLOCATION_TRACKER_IMPLEMENTATION
+#include <core/alloc_tracker.h>
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include <tiny_gltf.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <core/frame_arena.h>
+#include <core/profiler.h>
+#include <scene/settings.h>
+#include <scene/clouds.h>
+#include <scene/mountain.h>
+#include <scene/sea.h>
+#include <scene/bot_animation.h>
+
+static const char* benchmarkFilter = nullptr;	// Only benchmarks whose name contains this run
+static int benchmarkSize = 0;					// Only this size when set
+static double minBenchmarkSeconds = 0.25;		// Measured time per benchmark and size
+static const int MIN_BENCHMARK_ITERATIONS = 10;
+static const int BENCHMARK_WARMUP_ITERATIONS = 5;	// Grow every buffer before measuring
+static const int SKELETON_KEYS = 60;			// Keys per channel of the generated clip, 2s at 30Hz
+
+static const int SEA_GRID_SIZES[] = { 32, 64, 128, 256 };
+static const int PARTICLE_COUNTS[] = { 500, 2000, 8000, 32000 };
+static const int JOINT_COUNTS[] = { 16, 64, 256 };
+static const int MOUNTAIN_SEGMENTS[] = { 20, 50, 100, 200 };
+
+// Times body(iteration) until both the minimum time and iteration count are reached. Every
+// iteration is a frame: the frame arenas are rewound and the pose cache emptied after it.
+template <typename Body>
+static void runBenchmark(const char* name, int size, double itemsPerIteration, const char* unit, Body body) {
+	if (benchmarkFilter != nullptr && strstr(name, benchmarkFilter) == nullptr) {
+		return;
+	}
+	if (benchmarkSize > 0 && size != benchmarkSize) {
+		return;
+	}
+
+	int iteration = 0;
+	for (; iteration < BENCHMARK_WARMUP_ITERATIONS; ++iteration) {
+		body(iteration);
+		FrameArena::endFrame();
+		poseCache.beginFrame();
+	}
+
+	AllocationTracker::ThreadCounters& counters = AllocationTracker::local();
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+	int64_t elapsed = 0;
+	int measured = 0;
+	const int64_t minElapsed = static_cast<int64_t>(minBenchmarkSeconds * 1e9);
+	while (measured < MIN_BENCHMARK_ITERATIONS || elapsed < minElapsed) {
+		uint64_t allocationsBefore = counters.allocations.load(std::memory_order_relaxed);
+		uint64_t bytesBefore = counters.bytes.load(std::memory_order_relaxed);
+		int64_t start = Profiler::now();
+		body(iteration++);
+		elapsed += Profiler::now() - start;
+		allocations += counters.allocations.load(std::memory_order_relaxed) - allocationsBefore;
+		bytes += counters.bytes.load(std::memory_order_relaxed) - bytesBefore;
+		measured++;
+
+		// Outside the timed region, a spilled arena frees its blocks here
+		FrameArena::endFrame();
+		poseCache.beginFrame();
+	}
+
+	double nsPerIteration = double(elapsed) / measured;
+	double throughput = itemsPerIteration / (nsPerIteration * 1e-9);
+	printf("%-20s %8d %12.0f %10.2f M%-10s", name, size, nsPerIteration, throughput * 1e-6, unit);
+	if (ALLOCATION_TRACKING) {
+		printf(" %11.1f %12.0f\n", double(allocations) / measured, double(bytes) / measured);
+	} else {
+		printf(" %11s %12s\n", "-", "-");
+	}
+}
+
+static void benchmarkSea() {
+	for (int gridSize : SEA_GRID_SIZES) {
+		SeaSimulation sea;
+		sea.seaGridSize = gridSize;
+		sea.generateCliffSea();
+		runBenchmark("sea simulate", gridSize, double(sea.seaVertices.size()), "vert/s", [&](int) {
+			sea.stepCliffSea(SIMULATION_STEP);
+			sea.simulateCliffSea();
+		});
+
+		// What every rendered frame pays between steps
+		std::vector<SeaSimulation::SeaVertex> frameVertices;
+		runBenchmark("sea interpolate", gridSize, double(sea.seaVertices.size()), "vert/s", [&](int iteration) {
+			sea.interpolateCliffSea((iteration % 16) / 16.0f, frameVertices);
+		});
+	}
+}
+
+static void benchmarkClouds() {
+	glm::mat4 projection = glm::perspective(glm::radians(FoV), 4.0f / 3.0f, zNear, zFar);
+	for (int particleCount : PARTICLE_COUNTS) {
+		// The same clouds every run
+		CloudSimulation clouds;
+		clouds.particleCount = particleCount;
+		clouds.initializeParticles(1);
+		runBenchmark("cloud update", particleCount, particleCount, "part/s", [&](int) {
+			clouds.update(SIMULATION_STEP);
+		});
+
+		// The camera circles the clouds so every sort sees a different order, as it does in the scene
+		std::vector<glm::mat4> drawMVPs;
+		std::vector<float> drawAlphas;
+		runBenchmark("cloud draw list", particleCount, particleCount, "part/s", [&](int iteration) {
+			float angle = iteration * 0.05f;
+			glm::vec3 cameraPos(180.0f + 400.0f * cos(angle), 250.0f, -100.0f + 400.0f * sin(angle));
+			glm::mat4 viewProjection = projection * glm::lookAt(cameraPos, glm::vec3(180.0f, 175.0f, -100.0f),
+														  glm::vec3(0.0f, 1.0f, 0.0f));
+			clouds.buildDrawList(viewProjection, cameraPos, 0.5f, drawMVPs, drawAlphas);
+		});
+	}
+}
+
+// Appends count elements of data to the model's only buffer, returns the accessor made for them
+template <typename T>
+static int addAccessor(tinygltf::Model& model, const std::vector<T>& data, int type, size_t count) {
+	tinygltf::Buffer& buffer = model.buffers[0];
+	tinygltf::Accessor accessor;
+	accessor.bufferView = 0;
+	accessor.byteOffset = buffer.data.size();
+	accessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+	accessor.type = type;
+	accessor.count = count;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+	buffer.data.insert(buffer.data.end(), bytes, bytes + data.size() * sizeof(T));
+	model.bufferViews[0].byteLength = buffer.data.size();
+	model.accessors.push_back(accessor);
+	return static_cast<int>(model.accessors.size()) - 1;
+}
+
+// A skinned skeleton of jointCount joints, four children to a joint, with one looping clip that
+// rotates and translates every joint. Only what the animation code reads is filled in.
+static void buildSkeleton(tinygltf::Model& model, int jointCount) {
+	model = tinygltf::Model();
+	model.buffers.resize(1);
+	model.bufferViews.resize(1);
+	model.bufferViews[0].buffer = 0;
+
+	model.nodes.resize(jointCount);
+	tinygltf::Skin skin;
+	for (int i = 0; i < jointCount; ++i) {
+		model.nodes[i].translation = { 0.0, 0.5, 0.0 };
+		if (i > 0) {
+			model.nodes[(i - 1) / 4].children.push_back(i);
+		}
+		skin.joints.push_back(i);
+	}
+
+	std::vector<glm::mat4> inverseBindMatrices(jointCount, glm::mat4(1.0f));
+	skin.inverseBindMatrices = addAccessor(model, inverseBindMatrices, TINYGLTF_TYPE_MAT4, jointCount);
+	model.skins.push_back(skin);
+
+	std::vector<float> times(SKELETON_KEYS);
+	for (int k = 0; k < SKELETON_KEYS; ++k) {
+		times[k] = k / 30.0f;
+	}
+	int timeAccessor = addAccessor(model, times, TINYGLTF_TYPE_SCALAR, SKELETON_KEYS);
+
+	// Curved enough that key reduction keeps most keys, like motion-captured clips
+	tinygltf::Animation animation;
+	for (int joint = 0; joint < jointCount; ++joint) {
+		std::vector<glm::vec4> rotations(SKELETON_KEYS);
+		std::vector<glm::vec3> translations(SKELETON_KEYS);
+		for (int k = 0; k < SKELETON_KEYS; ++k) {
+			float phase = k * 0.7f + joint;
+			glm::quat q = glm::angleAxis(0.5f * sin(phase), glm::normalize(glm::vec3(sin(joint), 1.0f, cos(joint))));
+			rotations[k] = glm::vec4(q.x, q.y, q.z, q.w);	// glTF order
+			translations[k] = glm::vec3(0.05f * sin(phase * 1.3f), 0.5f, 0.05f * cos(phase));
+		}
+
+		const char* paths[2] = { "rotation", "translation" };
+		int outputs[2] = {
+			addAccessor(model, rotations, TINYGLTF_TYPE_VEC4, SKELETON_KEYS),
+			addAccessor(model, translations, TINYGLTF_TYPE_VEC3, SKELETON_KEYS),
+		};
+		for (int c = 0; c < 2; ++c) {
+			tinygltf::AnimationSampler sampler;
+			sampler.input = timeAccessor;
+			sampler.output = outputs[c];
+			sampler.interpolation = "LINEAR";
+			animation.samplers.push_back(sampler);
+
+			tinygltf::AnimationChannel channel;
+			channel.sampler = static_cast<int>(animation.samplers.size()) - 1;
+			channel.target_node = joint;
+			channel.target_path = paths[c];
+			animation.channels.push_back(channel);
+		}
+	}
+	model.animations.push_back(animation);
+}
+
+static void benchmarkBot() {
+	for (int jointCount : JOINT_COUNTS) {
+		tinygltf::Model model;
+		buildSkeleton(model, jointCount);
+		BotAnimation bot;
+		bot.position = glm::vec3(0.0f);
+		bot.scale = glm::vec3(1.0f);
+		GltfBuffers buffers;
+		buffers.useModel(model);
+		bot.prepareAnimationData(model, buffers);
+
+		// Every call samples a new pose, the pose cache is emptied between iterations
+		runBenchmark("bot update", jointCount, jointCount, "joint/s", [&](int iteration) {
+			bot.update(iteration * SIMULATION_STEP, SIMULATION_STEP);
+		});
+
+		// The uncached half of update(): sampling, the node hierarchy and the joint matrices
+		runBenchmark("bot evaluate", jointCount, jointCount, "joint/s", [&](int iteration) {
+			bot.evaluatePose(iteration * SIMULATION_STEP);
+		});
+
+		const BotAnimation::AnimationData& data = *bot.animationData;
+		std::vector<JointPose> nodePoses;
+		runBenchmark("bot animation", jointCount, jointCount, "joint/s", [&](int iteration) {
+			bot.updateAnimation(data.skeleton, data.skeleton.animations[0], data.animationObjects[0],
+								bot.channelCursors[0], iteration * SIMULATION_STEP, nodePoses);
+		});
+
+		// What every rendered frame pays per bot between steps: the blend into the snapshot and the
+		// rows written into the mapped JointPalette slot
+		BotAnimation::RenderState state;
+		size_t paletteJoints = std::min(static_cast<size_t>(jointCount), static_cast<size_t>(BotAnimation::MAX_PALETTE_JOINTS));
+		std::vector<glm::vec4> paletteRows(paletteJoints * 3);
+		runBenchmark("bot palette", jointCount, double(paletteJoints), "joint/s", [&](int iteration) {
+			bot.captureRenderState(state, (iteration % 16) / 16.0f);
+			BotAnimation::packJointPalette(state.jointMatrices, paletteJoints, paletteRows.data());
+		});
+
+		// What each crowd member costs to create, the clips and skins are shared with the source
+		BotAnimation member;
+		runBenchmark("bot copy", jointCount, 1, "copy/s", [&](int) {
+			member.copyInstance(bot);
+		});
+	}
+}
+
+static void benchmarkMountain() {
+	for (int segments : MOUNTAIN_SEGMENTS) {
+		MountainGeometry mountain;
+		mountain.segments = segments;
+		runBenchmark("mountain geometry", segments, 2.0 * segments * segments, "tri/s", [&](int) {
+			mountain.generateMountainGeometry();
+		});
+	}
+}
+
+static void printBenchmarkUsage(const char* program) {
+	printf("Usage: %s [--filter NAME] [--size N] [--min-time SECONDS]\n", program);
+}
+
+static bool parseBenchmarkArguments(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+			benchmarkFilter = argv[++i];
+		} else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+			benchmarkSize = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--min-time") == 0 && hasValue) {
+			minBenchmarkSeconds = atof(argv[++i]);
+		} else {
+			printBenchmarkUsage(argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (!parseBenchmarkArguments(argc, argv)) {
+		return 1;
+	}
+
+	printf("%-20s %8s %12s %22s %11s %12s\n", "benchmark", "size", "ns/iter", "throughput", "allocs/iter", "bytes/iter");
+	benchmarkSea();
+	benchmarkClouds();
+	benchmarkBot();
+	benchmarkMountain();
+	return 0;
+}
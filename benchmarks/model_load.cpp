@@ -0,0 +1,89 @@
+// Load time and memory of the bot model load path: loadGltf(), the buffer view uploads of
+// MyBot::bindBufferViews() and prepareAnimationData(), without a window. Each buffer view with a
+// GL target is read once where the program hands it to glBufferData, the driver's copy is not
+// counted. Peak RSS is a process high-water mark, run once per mode to compare them.
+//
+// Build from the repository root with only glm and tinygltf (and its json.hpp) on the include path:
+//   g++ -O2 -std=c++17 -I. -I<glm> -I<tinygltf> benchmarks/model_load.cpp -o model_load -pthread
+// Then, from the repository root:
+//   ./model_load model/bot/bot.glb			(buffers mapped, as MyBot::initialize())
+//   ./model_load model/bot/bot.glb --copy	(tinygltf copies every buffer, as with keepCpuModel)
+#define ALLOCATION_TRACKER_IMPLEMENTATION
+#include <core/alloc_tracker.h>
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NO_EXTERNAL_IMAGE
+#include <tiny_gltf.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <core/resident_bytes.h>
+#include <scene/bot_animation.h>
+#include <scene/gltf_buffers.h>
+#include <scene/gltf_loader.h>
+
+// Current resident set, 0 where /proc is not available
+static double currentResidentMiB() {
+	long pages = 0;
+	long resident = 0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm == nullptr) {
+		return 0.0;
+	}
+	if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+		resident = 0;
+	}
+	fclose(statm);
+	return resident * (sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || (argc > 2 && strcmp(argv[2], "--copy") != 0)) {
+		printf("Usage: %s MODEL [--copy]\n", argv[0]);
+		return 1;
+	}
+	const bool mapBuffers = argc == 2;
+
+	auto start = std::chrono::steady_clock::now();
+	tinygltf::Model model;
+	GltfBuffers buffers;
+	std::string err;
+	std::string warn;
+	if (!loadGltf(model, buffers, argv[1], mapBuffers, err, warn)) {
+		printf("Failed to load %s: %s\n", argv[1], err.c_str());
+		return 1;
+	}
+	double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Stands in for glBufferData, which reads every byte of the view once
+	size_t uploaded = 0;
+	unsigned int checksum = 0;
+	for (size_t i = 0; i < model.bufferViews.size(); ++i) {
+		if (model.bufferViews[i].target == 0) {
+			continue;
+		}
+		const unsigned char* bytes = buffers.view(model, static_cast<int>(i));
+		for (size_t j = 0; j < model.bufferViews[i].byteLength; ++j) {
+			checksum += bytes[j];
+		}
+		uploaded += model.bufferViews[i].byteLength;
+	}
+
+	BotAnimation bot;
+	bot.modelPath = argv[1];
+	bot.prepareAnimationData(model, buffers);
+	buffers.release();
+	if (!mapBuffers) {
+		std::vector<tinygltf::Buffer>().swap(model.buffers);
+	}
+	double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%s (%s)\n", argv[1], mapBuffers ? "mapped" : "copied");
+	printf("  load %.1f ms, load + upload + animation %.1f ms\n", loadMs, totalMs);
+	printf("  %zu bytes uploaded from %zu buffer views (checksum %u)\n", uploaded, model.bufferViews.size(), checksum);
+	printf("  peak RSS %.1f MiB, RSS after release %.1f MiB\n", peakResidentMiB(), currentResidentMiB());
+	return 0;
+}
@@ -0,0 +1,362 @@
+#ifndef _ALLOC_TRACKER_H_
+#define _ALLOC_TRACKER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(TRACK_ALLOCATIONS) && !defined(_WIN32)
+#include <dlfcn.h>
+#endif
+
+// Opt-in heap allocation tracking. Build with TRACK_ALLOCATIONS defined and the translation unit that
+// defines ALLOCATION_TRACKER_IMPLEMENTATION replaces the global operator new and delete; without it
+// nothing is hooked and every call below returns straight away. Only C++ allocations are seen,
+// malloc calls made by the driver or GLFW are not.
+//
+// Counters are per thread so the hook never contends, frames are measured by diffing them between
+// beginFrame() and endFrame(). One allocation in SAMPLE_INTERVAL records its call site; once the
+// warm-up frames are over every allocation does, since after that each one is a regression.
+#ifdef TRACK_ALLOCATIONS
+static const bool ALLOCATION_TRACKING = true;
+#else
+static const bool ALLOCATION_TRACKING = false;
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ALLOCATION_CALLSITE() __builtin_return_address(0)
+#else
+#define ALLOCATION_CALLSITE() nullptr
+#endif
+
+struct AllocationTracker {
+	enum Mode {
+		MODE_COUNT,			// Only gather statistics
+		MODE_REPORT,		// Print every steady-state frame or scope that allocates
+		MODE_FAIL,			// Report, then abort
+	};
+
+	static const int MAX_THREADS = 64;			// Later threads share the last slot
+	static const int MAX_CALLSITES = 512;
+	static const uint64_t SAMPLE_INTERVAL = 64;
+	static const int REPORTED_CALLSITES = 8;
+
+	struct alignas(64) ThreadCounters {
+		std::atomic<uint64_t> allocations{0};
+		std::atomic<uint64_t> bytes{0};
+		std::atomic<uint64_t> frees{0};
+		const char* name = nullptr;
+		uint64_t frameStart = 0;				// Allocation count at beginFrame()
+		uint64_t frameStartBytes = 0;
+	};
+
+	struct Callsite {
+		std::atomic<void*> address{nullptr};
+		std::atomic<uint64_t> samples{0};
+	};
+
+	struct State {
+		ThreadCounters threads[MAX_THREADS];
+		std::atomic<int> threadCount{0};
+		Callsite callsites[MAX_CALLSITES];
+		std::atomic<bool> sampleEveryAllocation{false};
+
+		Mode mode = MODE_COUNT;
+		uint64_t warmupFrames = 120;
+		std::atomic<uint64_t> frames{0};
+		uint64_t totalAllocations = 0;
+		uint64_t totalBytes = 0;
+		uint64_t peakAllocations = 0;
+		std::atomic<uint64_t> steadyStateViolations{0};
+	};
+
+	static State& state() {
+		static State instance;
+		return instance;
+	}
+
+	static int trackedThreads() {
+		int count = state().threadCount.load();
+		if (count > MAX_THREADS) {
+			count = MAX_THREADS;
+		}
+		return count;
+	}
+
+	static ThreadCounters& local() {
+		static thread_local int slot = -1;
+		if (slot < 0) {
+			slot = state().threadCount.fetch_add(1);
+			if (slot >= MAX_THREADS) {
+				slot = MAX_THREADS - 1;
+			}
+		}
+		return state().threads[slot];
+	}
+
+	// Called from the hooks, must not allocate
+	static void recordAllocation(size_t size, void* callsite) {
+		ThreadCounters& counters = local();
+		uint64_t count = counters.allocations.fetch_add(1, std::memory_order_relaxed) + 1;
+		counters.bytes.fetch_add(size, std::memory_order_relaxed);
+		if (count % SAMPLE_INTERVAL == 0 || state().sampleEveryAllocation.load(std::memory_order_relaxed)) {
+			sampleCallsite(callsite);
+		}
+	}
+
+	static void recordFree() {
+		local().frees.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Open addressing on the return address, sites beyond the table's capacity are dropped
+	static void sampleCallsite(void* address) {
+		Callsite* callsites = state().callsites;
+		size_t start = (reinterpret_cast<uintptr_t>(address) >> 4) % MAX_CALLSITES;
+		for (int probe = 0; probe < MAX_CALLSITES; ++probe) {
+			Callsite& site = callsites[(start + probe) % MAX_CALLSITES];
+			void* current = site.address.load(std::memory_order_relaxed);
+			if (current == nullptr) {
+				void* expected = nullptr;
+				if (!site.address.compare_exchange_strong(expected, address) && expected != address) {
+					continue;
+				}
+				current = address;
+			}
+			if (current == address) {
+				site.samples.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+	}
+
+	static void clearCallsites() {
+		for (Callsite& site : state().callsites) {
+			site.samples = 0;
+			site.address = nullptr;
+		}
+	}
+
+	static void configure(Mode mode, uint64_t warmupFrames) {
+		state().mode = mode;
+		state().warmupFrames = warmupFrames;
+	}
+
+	// Shown in reports, threads without a name are listed by slot
+	static void nameThread(const char* name) {
+		if (ALLOCATION_TRACKING) {
+			local().name = name;
+		}
+	}
+
+	static bool inSteadyState() {
+		return state().frames.load(std::memory_order_relaxed) >= state().warmupFrames;
+	}
+
+	static void beginFrame() {
+		if (!ALLOCATION_TRACKING) {
+			return;
+		}
+		State& s = state();
+		int threadCount = trackedThreads();
+		for (int i = 0; i < threadCount; ++i) {
+			s.threads[i].frameStart = s.threads[i].allocations.load(std::memory_order_relaxed);
+			s.threads[i].frameStartBytes = s.threads[i].bytes.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Allocations made by every thread since beginFrame()
+	static uint64_t endFrame() {
+		if (!ALLOCATION_TRACKING) {
+			return 0;
+		}
+		State& s = state();
+		int threadCount = trackedThreads();
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+		for (int i = 0; i < threadCount; ++i) {
+			allocations += s.threads[i].allocations.load(std::memory_order_relaxed) - s.threads[i].frameStart;
+			bytes += s.threads[i].bytes.load(std::memory_order_relaxed) - s.threads[i].frameStartBytes;
+		}
+
+		bool steadyState = inSteadyState();
+		s.totalAllocations += allocations;
+		s.totalBytes += bytes;
+		if (steadyState && allocations > s.peakAllocations) {
+			s.peakAllocations = allocations;
+		}
+
+		if (steadyState && allocations > 0) {
+			s.steadyStateViolations++;
+			if (s.mode != MODE_COUNT) {
+				fprintf(stderr, "Steady-state frame %llu made %llu heap allocations (%llu bytes)\n",
+						(unsigned long long)s.frames.load(), (unsigned long long)allocations, (unsigned long long)bytes);
+				for (int i = 0; i < threadCount; ++i) {
+					uint64_t threadAllocations = s.threads[i].allocations.load(std::memory_order_relaxed) - s.threads[i].frameStart;
+					if (threadAllocations > 0) {
+						printThread(i);
+						fprintf(stderr, ": %llu\n", (unsigned long long)threadAllocations);
+					}
+				}
+				printCallsites();
+				if (s.mode == MODE_FAIL) {
+					abort();
+				}
+			}
+		}
+
+		uint64_t frame = s.frames.fetch_add(1) + 1;
+		if (frame == s.warmupFrames) {
+			// Forget the warm-up sites, from now on every allocation is recorded
+			clearCallsites();
+			s.sampleEveryAllocation = true;
+		}
+		return allocations;
+	}
+
+	static void printThread(int slot) {
+		const char* name = state().threads[slot].name;
+		if (name != nullptr) {
+			fprintf(stderr, "  %s", name);
+		} else {
+			fprintf(stderr, "  thread %d", slot);
+		}
+	}
+
+	// Most sampled call sites, named when the symbol is exported, resolve the rest with addr2line
+	static void printCallsites() {
+		Callsite* callsites = state().callsites;
+		bool reported[MAX_CALLSITES] = {};
+		for (int n = 0; n < REPORTED_CALLSITES; ++n) {
+			int best = -1;
+			for (int i = 0; i < MAX_CALLSITES; ++i) {
+				if (!reported[i] && callsites[i].samples.load() > 0 &&
+					(best < 0 || callsites[i].samples.load() > callsites[best].samples.load())) {
+					best = i;
+				}
+			}
+			if (best < 0) {
+				return;
+			}
+			reported[best] = true;
+
+			void* address = callsites[best].address.load();
+			const char* symbol = nullptr;
+#if defined(TRACK_ALLOCATIONS) && !defined(_WIN32)
+			Dl_info info;
+			if (dladdr(address, &info) != 0) {
+				symbol = info.dli_sname;
+			}
+#endif
+			fprintf(stderr, "  %8llu samples from %p %s\n", (unsigned long long)callsites[best].samples.load(),
+					address, symbol != nullptr ? symbol : "");
+		}
+	}
+
+	static void printSummary() {
+		if (!ALLOCATION_TRACKING) {
+			return;
+		}
+		State& s = state();
+		uint64_t frames = s.frames.load();
+		fprintf(stderr, "Heap allocations over %llu frames: %llu (%llu bytes), %.1f per frame\n",
+				(unsigned long long)frames, (unsigned long long)s.totalAllocations, (unsigned long long)s.totalBytes,
+				frames > 0 ? double(s.totalAllocations) / frames : 0.0);
+		fprintf(stderr, "Steady-state frames or scopes that allocated: %llu, worst frame: %llu\n",
+				(unsigned long long)s.steadyStateViolations.load(), (unsigned long long)s.peakAllocations);
+
+		int threadCount = trackedThreads();
+		for (int i = 0; i < threadCount; ++i) {
+			printThread(i);
+			fprintf(stderr, ": %llu allocations, %llu frees\n",
+					(unsigned long long)s.threads[i].allocations.load(), (unsigned long long)s.threads[i].frees.load());
+		}
+		printCallsites();
+	}
+};
+
+// Guards a region of the calling thread, e.g. one update path, that must not allocate once warm
+struct AllocationScope {
+	const char* name;
+	uint64_t start;
+
+	explicit AllocationScope(const char* name) : name(name), start(0) {
+		if (ALLOCATION_TRACKING) {
+			start = AllocationTracker::local().allocations.load(std::memory_order_relaxed);
+		}
+	}
+
+	~AllocationScope() {
+		if (!ALLOCATION_TRACKING || !AllocationTracker::inSteadyState()) {
+			return;
+		}
+		uint64_t allocations = AllocationTracker::local().allocations.load(std::memory_order_relaxed) - start;
+		if (allocations == 0) {
+			return;
+		}
+		AllocationTracker::State& s = AllocationTracker::state();
+		s.steadyStateViolations++;
+		if (s.mode != AllocationTracker::MODE_COUNT) {
+			fprintf(stderr, "Steady-state scope '%s' made %llu heap allocations\n", name, (unsigned long long)allocations);
+			if (s.mode == AllocationTracker::MODE_FAIL) {
+				AllocationTracker::printCallsites();
+				abort();
+			}
+		}
+	}
+};
+
+#if defined(TRACK_ALLOCATIONS) && defined(ALLOCATION_TRACKER_IMPLEMENTATION)
+void* operator new(std::size_t size) {
+	AllocationTracker::recordAllocation(size, ALLOCATION_CALLSITE());
+	void* p = std::malloc(size > 0 ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	AllocationTracker::recordAllocation(size, ALLOCATION_CALLSITE());
+	void* p = std::malloc(size > 0 ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	AllocationTracker::recordAllocation(size, ALLOCATION_CALLSITE());
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	AllocationTracker::recordAllocation(size, ALLOCATION_CALLSITE());
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* p) noexcept {
+	if (p != nullptr) {
+		AllocationTracker::recordFree();
+		std::free(p);
+	}
+}
+
+void operator delete[](void* p) noexcept {
+	if (p != nullptr) {
+		AllocationTracker::recordFree();
+		std::free(p);
+	}
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	operator delete[](p);
+}
+#endif
+
+#endif
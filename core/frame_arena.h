@@ -0,0 +1,130 @@
+#ifndef _FRAME_ARENA_H_
+#define _FRAME_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Linear allocator for data that does not outlive the simulation frame it was made in. Every thread
+// owns one, so allocating is a pointer bump without locks and freeing does nothing: the arena is
+// rewound as a whole the first time its thread allocates after endFrame(). Requests that do not fit
+// spill to the heap until then, and the arena grows to cover them, so steady-state frames never
+// reach the general-purpose allocator.
+struct FrameArena {
+	static const size_t INITIAL_CAPACITY = 256 * 1024;
+
+	char* buffer = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+	size_t requested = 0;			// Bytes asked for this frame, spilled ones included
+	std::vector<void*> spilled;		// Heap blocks of the requests that did not fit
+	uint64_t frame = 0;
+
+	// Advanced by the simulation thread once all of a frame's jobs have finished
+	static std::atomic<uint64_t>& currentFrame() {
+		static std::atomic<uint64_t> frame(0);
+		return frame;
+	}
+
+	static void endFrame() {
+		currentFrame().fetch_add(1, std::memory_order_release);
+	}
+
+	// The calling thread's arena, rewound when a frame ended since it was last used
+	static FrameArena& local() {
+		static thread_local FrameArena arena;
+		uint64_t frame = currentFrame().load(std::memory_order_acquire);
+		if (arena.frame != frame) {
+			arena.reset();
+			arena.frame = frame;
+		}
+		return arena;
+	}
+
+	FrameArena() = default;
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	~FrameArena() {
+		release();
+	}
+
+	void* allocate(size_t size, size_t alignment) {
+		requested += size + alignment - 1;
+		size_t offset = (used + alignment - 1) & ~(alignment - 1);
+		if (buffer != nullptr && offset + size <= capacity) {
+			used = offset + size;
+			return buffer + offset;
+		}
+
+		void* block = ::operator new(size);
+		spilled.push_back(block);
+		return block;
+	}
+
+	void reset() {
+		for (void* block : spilled) {
+			::operator delete(block);
+		}
+		spilled.clear();
+
+		if (requested > capacity) {
+			::operator delete(buffer);
+			capacity = requested + requested / 2;
+			if (capacity < INITIAL_CAPACITY) {
+				capacity = INITIAL_CAPACITY;
+			}
+			buffer = static_cast<char*>(::operator new(capacity));
+		}
+		used = 0;
+		requested = 0;
+	}
+
+	void release() {
+		for (void* block : spilled) {
+			::operator delete(block);
+		}
+		spilled.clear();
+		::operator delete(buffer);
+		buffer = nullptr;
+		capacity = 0;
+		used = 0;
+		requested = 0;
+	}
+};
+
+// STL allocator drawing from a frame arena, the calling thread's unless one is given
+template <typename T>
+struct FrameAllocator {
+	typedef T value_type;
+
+	FrameArena* arena;
+
+	FrameAllocator() : arena(&FrameArena::local()) {}
+	explicit FrameAllocator(FrameArena& arena) : arena(&arena) {}
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, size_t) {}
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {
+	return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) {
+	return a.arena != b.arena;
+}
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <core/profiler.h>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops its own jobs at the
+// back (most recently queued, still warm in cache) and steals from the front of the others when
+// it runs dry. Threads outside the pool (the GL context thread) share one extra deque and help
+// execute jobs while they wait, so nothing here may touch OpenGL.
+struct JobSystem {
+	typedef std::function<void()> Job;
+
+	// Ring of jobs that only ever grows, a deque would free and reallocate blocks as it drains
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::vector<Job> ring;
+		size_t head = 0;
+		size_t count = 0;
+
+		void pushBack(Job&& job) {
+			if (count == ring.size()) {
+				std::vector<Job> larger(std::max<size_t>(64, ring.size() * 2));
+				for (size_t i = 0; i < count; ++i) {
+					larger[i] = std::move(ring[(head + i) % ring.size()]);
+				}
+				ring.swap(larger);
+				head = 0;
+			}
+			ring[(head + count) % ring.size()] = std::move(job);
+			count++;
+		}
+
+		void popBack(Job& job) {
+			count--;
+			job = std::move(ring[(head + count) % ring.size()]);
+		}
+
+		void popFront(Job& job) {
+			job = std::move(ring[head]);
+			head = (head + 1) % ring.size();
+			count--;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkerQueue>> queues;	// One per worker, the last one for outside threads
+	std::atomic<bool> running{false};
+	std::atomic<int> queuedJobs{0};
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+
+	// Index of the worker running on this thread, -1 outside the pool
+	static int& currentWorker() {
+		static thread_local int index = -1;
+		return index;
+	}
+
+	// workerCount 0 leaves one hardware thread for the GL context thread
+	void initialize(unsigned int workerCount = 0) {
+		if (workerCount == 0) {
+			unsigned int hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		queues.clear();
+		for (unsigned int i = 0; i <= workerCount; ++i) {
+			queues.emplace_back(new WorkerQueue());
+		}
+
+		running = true;
+		for (unsigned int i = 0; i < workerCount; ++i) {
+			workers.emplace_back(&JobSystem::workerLoop, this, static_cast<int>(i));
+		}
+	}
+
+	void shutdown() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			running = false;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+		queues.clear();
+	}
+
+	int ownQueue() const {
+		int index = currentWorker();
+		return index >= 0 ? index : static_cast<int>(queues.size()) - 1;
+	}
+
+	void submit(Job job) {
+		WorkerQueue& queue = *queues[ownQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.pushBack(std::move(job));
+		}
+		queuedJobs++;
+
+		// Taking the lock orders the increment with a worker that is about to sleep
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_one();
+	}
+
+	bool tryPop(int index, Job& job) {
+		{
+			WorkerQueue& own = *queues[index];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (own.count > 0) {
+				own.popBack(job);
+				return true;
+			}
+		}
+
+		for (size_t k = 1; k < queues.size(); ++k) {
+			WorkerQueue& victim = *queues[(index + k) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.count > 0) {
+				victim.popFront(job);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool runOne() {
+		Job job;
+		if (!tryPop(ownQueue(), job)) {
+			return false;
+		}
+		queuedJobs--;
+		job();
+		return true;
+	}
+
+	// Execute jobs on the calling thread until the counter drops to zero
+	void wait(const std::atomic<int>& counter) {
+		while (counter.load() > 0) {
+			if (!runOne()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Split [0, count) into chunks of at most grainSize and run them across the pool
+	void parallelFor(int count, int grainSize, const std::function<void(int, int)>& body) {
+		if (count <= grainSize || workers.empty()) {
+			body(0, count);
+			return;
+		}
+
+		// Chunks capture one pointer and their range, small enough for std::function to store
+		// without a heap allocation
+		struct Batch {
+			const std::function<void(int, int)>* body;
+			std::atomic<int> remaining;
+		};
+		Batch batch;
+		batch.body = &body;
+		batch.remaining = (count + grainSize - 1) / grainSize;
+		for (int begin = 0; begin < count; begin += grainSize) {
+			int end = std::min(begin + grainSize, count);
+			submit([&batch, begin, end] {
+				(*batch.body)(begin, end);
+				batch.remaining--;
+			});
+		}
+		wait(batch.remaining);
+	}
+
+	void workerLoop(int index) {
+		currentWorker() = index;
+		char name[32];
+		snprintf(name, sizeof(name), "worker %d", index);
+		Profiler::nameThread(name);
+		while (running) {
+			if (runOne()) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [this] { return !running || queuedJobs.load() > 0; });
+		}
+	}
+};
+
+// Stages of a frame declared once with their dependencies and run on the job system every frame.
+// A task only starts after all the tasks it depends on finished, which are always declared first.
+// Every task is profiled under its name.
+struct TaskGraph {
+	struct Task {
+		const char* name;
+		std::function<void()> work;
+		std::vector<int> successors;
+		int dependencyCount;
+	};
+
+	std::vector<Task> tasks;
+	std::unique_ptr<std::atomic<int>[]> pending;	// Unfinished dependencies of each task this run
+	size_t pendingSize = 0;
+	std::atomic<int> remaining{0};
+	JobSystem* jobSystem = nullptr;				// Set for the duration of run()
+
+	int add(const char* name, std::function<void()> work, std::initializer_list<int> dependencies = {}) {
+		int id = static_cast<int>(tasks.size());
+		Task task;
+		task.name = name;
+		task.work = std::move(work);
+		task.dependencyCount = static_cast<int>(dependencies.size());
+		for (int dependency : dependencies) {
+			tasks[dependency].successors.push_back(id);
+		}
+		tasks.push_back(std::move(task));
+		return id;
+	}
+
+	// Run every task once, the calling thread helps until the whole graph is done
+	void run(JobSystem& jobs) {
+		if (pendingSize != tasks.size()) {
+			pending.reset(new std::atomic<int>[tasks.size()]);
+			pendingSize = tasks.size();
+		}
+		for (size_t i = 0; i < tasks.size(); ++i) {
+			pending[i] = tasks[i].dependencyCount;
+		}
+
+		jobSystem = &jobs;
+		remaining = static_cast<int>(tasks.size());
+		for (size_t i = 0; i < tasks.size(); ++i) {
+			if (tasks[i].dependencyCount == 0) {
+				schedule(static_cast<int>(i));
+			}
+		}
+		jobs.wait(remaining);
+	}
+
+	// Captures only the graph and the task id, which std::function stores without allocating
+	void schedule(int id) {
+		jobSystem->submit([this, id] {
+			const Task& task = tasks[id];
+			{
+				ProfileScope profileScope(task.name);
+				task.work();
+			}
+			for (int successor : task.successors) {
+				if (--pending[successor] == 0) {
+					schedule(successor);
+				}
+			}
+			remaining--;
+		});
+	}
+};
+
+#endif
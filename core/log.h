@@ -0,0 +1,215 @@
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+// Non-blocking logging. Messages are formatted on the calling thread straight into a slot of a
+// fixed ring buffer and written out by a background thread, so a log call costs a vsnprintf and
+// never waits on the console. When the ring is full the message is dropped and counted instead.
+// Each call site lets a burst of LOG_BURST messages through and then LOG_MAX_PER_SECOND a second,
+// the rest are counted and the number is reported with the next message that gets through.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+// Calls below this level compile to nothing, their arguments are not evaluated
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define LOG_MAX_PER_SECOND 5
+#define LOG_BURST 32
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(a, b) __attribute__((format(printf, a, b)))
+#else
+#define LOG_PRINTF_FORMAT(a, b)
+#endif
+
+// Rate limit of one call site. Tracks when the site would next be allowed a message at the steady
+// rate; a message is admitted while that time is less than a full burst ahead of now.
+struct LogSite {
+	std::atomic<int64_t> nextArrival{0};		// Microseconds on the steady clock
+	std::atomic<int> suppressed{0};
+
+	bool allow() {
+		const int64_t interval = 1000000 / LOG_MAX_PER_SECOND;
+		int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		int64_t arrival = nextArrival.load(std::memory_order_relaxed);
+		for (;;) {
+			int64_t next = (arrival > now ? arrival : now) + interval;
+			if (next - now > LOG_BURST * interval) {
+				suppressed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			if (nextArrival.compare_exchange_weak(arrival, next, std::memory_order_relaxed)) {
+				return true;
+			}
+		}
+	}
+
+	int takeSuppressed() {
+		return suppressed.exchange(0, std::memory_order_relaxed);
+	}
+};
+
+struct Logger {
+	static const size_t CAPACITY = 1024;		// Messages in flight, a power of two
+	static const size_t MESSAGE_SIZE = 240;
+
+	// Bounded multi-producer ring: a slot's sequence says whose turn it is, producers claim slots
+	// with a compare-and-swap on the write position and the single consumer frees them in order
+	struct Slot {
+		std::atomic<size_t> sequence;
+		int level;
+		char text[MESSAGE_SIZE];
+	};
+
+	Slot slots[CAPACITY];
+	std::atomic<size_t> writePosition{0};
+	size_t readPosition = 0;
+	std::atomic<uint64_t> dropped{0};
+	std::atomic<bool> running{false};
+	std::atomic_flag draining = ATOMIC_FLAG_INIT;	// Only contended when no writer thread runs
+	std::thread writer;
+
+	Logger() {
+		for (size_t i = 0; i < CAPACITY; ++i) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Early returns from main still flush and stop the writer thread
+	~Logger() {
+		shutdown();
+	}
+
+	static Logger& instance() {
+		static Logger logger;
+		return logger;
+	}
+
+	static const char* levelName(int level) {
+		switch (level) {
+			case LOG_LEVEL_DEBUG: return "debug";
+			case LOG_LEVEL_INFO: return "info";
+			case LOG_LEVEL_WARN: return "warn";
+			default: return "error";
+		}
+	}
+
+	void start() {
+		if (running.exchange(true)) {
+			return;
+		}
+		writer = std::thread(&Logger::writerLoop, this);
+	}
+
+	// Writes out everything still queued, later messages are written by the caller's thread
+	void shutdown() {
+		if (!running.exchange(false)) {
+			return;
+		}
+		writer.join();
+		drain();
+	}
+
+	void write(int level, int suppressed, const char* format, ...) LOG_PRINTF_FORMAT(4, 5) {
+		size_t position = writePosition.load(std::memory_order_relaxed);
+		Slot* slot;
+		for (;;) {
+			slot = &slots[position & (CAPACITY - 1)];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+			if (difference == 0) {
+				if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (difference < 0) {
+				// Full, the writer thread is behind
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			} else {
+				position = writePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->level = level;
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(slot->text, MESSAGE_SIZE, format, args);
+		va_end(args);
+		if (suppressed > 0 && length >= 0 && static_cast<size_t>(length) < MESSAGE_SIZE) {
+			snprintf(slot->text + length, MESSAGE_SIZE - length, " (%d similar suppressed)", suppressed);
+		}
+		slot->sequence.store(position + 1, std::memory_order_release);
+
+		if (!running.load(std::memory_order_relaxed)) {
+			drain();
+		}
+	}
+
+	// Consumer side, the writer thread or, while it is not running, whoever logs
+	void drain() {
+		while (draining.test_and_set(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		bool wrote = false;
+		for (;;) {
+			Slot& slot = slots[readPosition & (CAPACITY - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != readPosition + 1) {
+				break;
+			}
+			FILE* stream = slot.level >= LOG_LEVEL_WARN ? stderr : stdout;
+			fprintf(stream, "[%s] %s\n", levelName(slot.level), slot.text);
+			slot.sequence.store(readPosition + CAPACITY, std::memory_order_release);
+			readPosition++;
+			wrote = true;
+		}
+
+		uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+		if (lost > 0) {
+			fprintf(stderr, "[warn] %llu log messages dropped, the log ring was full\n", (unsigned long long)lost);
+			wrote = true;
+		}
+		if (wrote) {
+			fflush(stdout);
+		}
+		draining.clear(std::memory_order_release);
+	}
+
+	void writerLoop() {
+		while (running.load()) {
+			drain();
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+};
+
+#define LOG_AT(level, ...) \
+	do { \
+		if ((level) >= LOG_MIN_LEVEL) { \
+			static LogSite logSite; \
+			if (logSite.allow()) { \
+				Logger::instance().write((level), logSite.takeSuppressed(), __VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif
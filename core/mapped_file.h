@@ -0,0 +1,70 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+// Read-only memory mapping of a whole file. Pages are loaded by the OS on first access instead of
+// being read into a heap buffer, and are shared with the page cache.
+struct MappedFile {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	std::vector<unsigned char> fallback;	// No mmap, read the file into memory instead
+#endif
+
+	bool open(const char* filename) {
+#ifndef _WIN32
+		int fd = ::open(filename, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (mapping == MAP_FAILED) {
+			return false;
+		}
+		data = static_cast<const unsigned char*>(mapping);
+		size = static_cast<size_t>(info.st_size);
+		return true;
+#else
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file) {
+			return false;
+		}
+		fallback.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(fallback.data()), fallback.size());
+		data = fallback.data();
+		size = fallback.size();
+		return true;
+#endif
+	}
+
+	void close() {
+#ifndef _WIN32
+		if (data) {
+			munmap(const_cast<unsigned char*>(data), size);
+		}
+#else
+		std::vector<unsigned char>().swap(fallback);
+#endif
+		data = nullptr;
+		size = 0;
+	}
+};
+
+#endif
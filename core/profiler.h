@@ -0,0 +1,362 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <core/log.h>
+
+// Hierarchical frame profiler. A ProfileScope times a region of the calling thread, scopes nest and
+// each thread records into its own buffer whose lock is only contended while endFrame() collects
+// it. The render thread calls endFrame() once per frame: the events are folded into one row of
+// statistics per scope name for the overlay and, while a capture runs, kept for a Chrome trace
+// (open it in chrome://tracing or ui.perfetto.dev). GPU timings come in through recordGpu().
+struct Profiler {
+	static const int MAX_THREADS = 32;				// Later threads share the last slot
+	static const int MAX_SCOPES = 64;				// Scope names beyond this are not summarised
+	static const size_t EVENTS_PER_THREAD = 4096;	// Reserved once, events past it are dropped
+	static const int GPU_TRACK = MAX_THREADS;		// Thread id of GPU passes in traces
+	static constexpr double SMOOTHING = 0.1;		// Weight of the newest frame in smoothed times
+
+	struct Event {
+		const char* name;
+		int64_t start;		// Nanoseconds on the steady clock
+		int64_t end;
+		int depth;
+		int thread;
+	};
+
+	struct ThreadEvents {
+		std::mutex mutex;
+		std::vector<Event> events;
+		uint64_t dropped = 0;
+		int depth = 0;				// Open scopes, only touched by the owning thread
+		int slot = 0;
+		char name[32] = {};
+	};
+
+	// Timings of one scope name, CPU summed over every thread that ran it during the frame
+	struct ScopeStats {
+		const char* name;
+		int depth;				// Nesting depth it was first seen at
+		double cpuMs;			// Pending for the frame being collected
+		double gpuMs;
+		double smoothedCpuMs;
+		double smoothedGpuMs;
+		double maxCpuMs;
+		double maxGpuMs;
+		double totalCpuMs;		// Since resetTotals()
+		double totalGpuMs;
+		bool hasGpu;
+	};
+
+	struct State {
+		ThreadEvents threads[MAX_THREADS];
+		std::atomic<int> threadCount{0};
+
+		ScopeStats scopes[MAX_SCOPES];
+		int scopeCount = 0;
+		std::vector<Event> collected;		// Reused by every endFrame()
+		bool gpuResolved = false;			// A GPU timing arrived during this frame
+		int64_t lastFrameEnd = 0;
+		double frameMs = 0.0;
+		double smoothedFrameMs = 0.0;
+		double smoothedGpuMs = 0.0;
+		double gpuFrameMs = -1.0;			// GPU passes that came back this frame, negative if none did
+		uint64_t frames = 0;
+		uint64_t totalFrames = 0;			// Since resetTotals()
+		uint64_t totalGpuFrames = 0;		// Of those, the ones GPU timings arrived in
+
+		// Trace capture
+		std::vector<Event> trace;
+		int captureFramesLeft = 0;
+		int capturedFrames = 0;
+		int64_t captureStart = 0;
+		char capturePath[256] = {};
+	};
+
+	static State& state() {
+		static State instance;
+		return instance;
+	}
+
+	static int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static int trackedThreads() {
+		int count = state().threadCount.load();
+		if (count > MAX_THREADS) {
+			count = MAX_THREADS;
+		}
+		return count;
+	}
+
+	static ThreadEvents& local() {
+		static thread_local ThreadEvents* events = nullptr;
+		if (events == nullptr) {
+			int slot = state().threadCount.fetch_add(1);
+			if (slot >= MAX_THREADS) {
+				slot = MAX_THREADS - 1;
+			}
+			events = &state().threads[slot];
+			std::lock_guard<std::mutex> lock(events->mutex);
+			if (events->events.capacity() < EVENTS_PER_THREAD) {
+				events->events.reserve(EVENTS_PER_THREAD);
+			}
+			events->slot = slot;
+		}
+		return *events;
+	}
+
+	// Shown as the track name in traces, threads without a name are listed by slot
+	static void nameThread(const char* name) {
+		ThreadEvents& thread = local();
+		std::lock_guard<std::mutex> lock(thread.mutex);
+		snprintf(thread.name, sizeof(thread.name), "%s", name);
+	}
+
+	static void record(ThreadEvents& thread, const char* name, int64_t start, int64_t end, int depth) {
+		std::lock_guard<std::mutex> lock(thread.mutex);
+		if (thread.events.size() == thread.events.capacity()) {
+			thread.dropped++;
+			return;
+		}
+		Event event = { name, start, end, depth, thread.slot };
+		thread.events.push_back(event);
+	}
+
+	static ScopeStats* findScope(const char* name, int depth) {
+		State& s = state();
+		for (int i = 0; i < s.scopeCount; ++i) {
+			if (s.scopes[i].name == name || strcmp(s.scopes[i].name, name) == 0) {
+				return &s.scopes[i];
+			}
+		}
+		if (s.scopeCount == MAX_SCOPES) {
+			return nullptr;
+		}
+		ScopeStats& scope = s.scopes[s.scopeCount++];
+		memset(&scope, 0, sizeof(scope));
+		scope.name = name;
+		scope.depth = depth;
+		return &scope;
+	}
+
+	// A GPU pass measured by the render thread, start is when it was submitted
+	static void recordGpu(const char* name, int64_t start, int64_t duration) {
+		State& s = state();
+		ScopeStats* scope = findScope(name, 0);
+		if (scope != nullptr) {
+			scope->gpuMs += duration * 1e-6;
+			scope->hasGpu = true;
+		}
+		s.gpuResolved = true;
+		if (s.captureFramesLeft > 0 && s.trace.size() < s.trace.capacity()) {
+			Event event = { name, start, start + duration, 0, GPU_TRACK };
+			s.trace.push_back(event);
+		}
+	}
+
+	// Render thread, once per frame after every GPU timing of the frame was recorded
+	static void endFrame() {
+		State& s = state();
+		int64_t frameEnd = now();
+		if (s.lastFrameEnd != 0) {
+			s.frameMs = (frameEnd - s.lastFrameEnd) * 1e-6;
+			s.smoothedFrameMs += (s.frameMs - s.smoothedFrameMs) * SMOOTHING;
+		}
+		s.lastFrameEnd = frameEnd;
+
+		s.collected.clear();
+		int threadCount = trackedThreads();
+		for (int i = 0; i < threadCount; ++i) {
+			ThreadEvents& thread = s.threads[i];
+			std::lock_guard<std::mutex> lock(thread.mutex);
+			s.collected.insert(s.collected.end(), thread.events.begin(), thread.events.end());
+			thread.events.clear();
+		}
+
+		// Scopes are recorded as they close, parents after their children; in start order new
+		// names are added to the summary beneath their parent
+		std::sort(s.collected.begin(), s.collected.end(), [](const Event& a, const Event& b) {
+			return a.start < b.start;
+		});
+		for (const Event& event : s.collected) {
+			ScopeStats* scope = findScope(event.name, event.depth);
+			if (scope != nullptr) {
+				scope->cpuMs += (event.end - event.start) * 1e-6;
+			}
+		}
+
+		// Scopes that did not run this frame count as zero, so the smoothed time is the cost per
+		// frame. GPU results arrive a frame late and only fold in on frames that had some.
+		double gpuTotal = 0.0;
+		for (int i = 0; i < s.scopeCount; ++i) {
+			ScopeStats& scope = s.scopes[i];
+			scope.smoothedCpuMs += (scope.cpuMs - scope.smoothedCpuMs) * SMOOTHING;
+			scope.totalCpuMs += scope.cpuMs;
+			scope.totalGpuMs += scope.gpuMs;
+			if (scope.cpuMs > scope.maxCpuMs) {
+				scope.maxCpuMs = scope.cpuMs;
+			}
+			if (s.gpuResolved) {
+				scope.smoothedGpuMs += (scope.gpuMs - scope.smoothedGpuMs) * SMOOTHING;
+				if (scope.gpuMs > scope.maxGpuMs) {
+					scope.maxGpuMs = scope.gpuMs;
+				}
+			}
+			gpuTotal += scope.gpuMs;
+			scope.cpuMs = 0.0;
+			scope.gpuMs = 0.0;
+		}
+		s.gpuFrameMs = s.gpuResolved ? gpuTotal : -1.0;
+		if (s.gpuResolved) {
+			s.smoothedGpuMs += (gpuTotal - s.smoothedGpuMs) * SMOOTHING;
+			s.totalGpuFrames++;
+		}
+		s.gpuResolved = false;
+		s.frames++;
+		s.totalFrames++;
+
+		if (s.captureFramesLeft > 0) {
+			for (const Event& event : s.collected) {
+				if (s.trace.size() < s.trace.capacity()) {
+					s.trace.push_back(event);
+				}
+			}
+			s.capturedFrames++;
+			if (--s.captureFramesLeft == 0) {
+				writeTrace();
+			}
+		}
+	}
+
+	// Starts the averages over, e.g. once a benchmark's warm-up frames are done
+	static void resetTotals() {
+		State& s = state();
+		for (int i = 0; i < s.scopeCount; ++i) {
+			s.scopes[i].totalCpuMs = 0.0;
+			s.scopes[i].totalGpuMs = 0.0;
+			s.scopes[i].maxCpuMs = 0.0;
+			s.scopes[i].maxGpuMs = 0.0;
+		}
+		s.totalFrames = 0;
+		s.totalGpuFrames = 0;
+	}
+
+	// Average CPU and GPU time per frame of every scope since resetTotals()
+	static void printTotals() {
+		State& s = state();
+		if (s.totalFrames == 0) {
+			return;
+		}
+		LOG_INFO("  %-24s%10s%10s%10s%10s", "scope", "cpu ms", "max", "gpu ms", "max");
+		for (int i = 0; i < s.scopeCount; ++i) {
+			const ScopeStats& scope = s.scopes[i];
+			double gpuMs = s.totalGpuFrames > 0 ? scope.totalGpuMs / s.totalGpuFrames : 0.0;
+			LOG_INFO("  %*s%-*s%10.3f%10.3f%10.3f%10.3f", scope.depth * 2, "", 24 - scope.depth * 2, scope.name,
+					 scope.totalCpuMs / s.totalFrames, scope.maxCpuMs, gpuMs, scope.maxGpuMs);
+		}
+	}
+
+	// Keeps every event of the next frames and writes them out as trace-event JSON at the end
+	static void startCapture(int frames, const char* path) {
+		State& s = state();
+		if (s.captureFramesLeft > 0) {
+			return;
+		}
+		s.trace.clear();
+		s.trace.reserve(static_cast<size_t>(frames) * 256);
+		s.captureFramesLeft = frames;
+		s.capturedFrames = 0;
+		s.captureStart = now();
+		snprintf(s.capturePath, sizeof(s.capturePath), "%s", path);
+		LOG_INFO("Capturing a trace of %d frames", frames);
+	}
+
+	static bool capturing() {
+		return state().captureFramesLeft > 0;
+	}
+
+	static void writeTrackName(FILE* file, int track, const char* name) {
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", track);
+		writeEscaped(file, name);
+		fprintf(file, "\"}}");
+	}
+
+	static void writeEscaped(FILE* file, const char* text) {
+		for (const char* c = text; *c != '\0'; ++c) {
+			if (*c == '"' || *c == '\\') {
+				fputc('\\', file);
+			}
+			fputc(*c, file);
+		}
+	}
+
+	static void writeTrace() {
+		State& s = state();
+		FILE* file = fopen(s.capturePath, "w");
+		if (file == nullptr) {
+			LOG_ERROR("Failed to open %s for the trace.", s.capturePath);
+			return;
+		}
+
+		fprintf(file, "{\"traceEvents\":[\n");
+		int threadCount = trackedThreads();
+		for (int i = 0; i < threadCount; ++i) {
+			char name[32];
+			std::lock_guard<std::mutex> lock(s.threads[i].mutex);
+			if (s.threads[i].name[0] != '\0') {
+				snprintf(name, sizeof(name), "%s", s.threads[i].name);
+			} else {
+				snprintf(name, sizeof(name), "thread %d", i);
+			}
+			writeTrackName(file, i, name);
+			fprintf(file, ",\n");
+		}
+		writeTrackName(file, GPU_TRACK, "GPU");
+
+		// Complete events in microseconds since the capture started
+		for (const Event& event : s.trace) {
+			fprintf(file, ",\n{\"name\":\"");
+			writeEscaped(file, event.name);
+			fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.thread,
+					(event.start - s.captureStart) * 1e-3, (event.end - event.start) * 1e-3);
+		}
+		fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+		fclose(file);
+
+		LOG_INFO("Trace of %d frames (%zu events) written to %s", s.capturedFrames, s.trace.size(), s.capturePath);
+		s.trace.clear();
+		s.trace.shrink_to_fit();
+	}
+};
+
+// Times the enclosing block on the calling thread under a name that must outlive the profiler,
+// in practice a string literal
+struct ProfileScope {
+	Profiler::ThreadEvents& thread;
+	const char* name;
+	int64_t start;
+	int depth;
+
+	explicit ProfileScope(const char* name) : thread(Profiler::local()), name(name) {
+		depth = thread.depth++;
+		start = Profiler::now();
+	}
+
+	~ProfileScope() {
+		int64_t end = Profiler::now();
+		thread.depth--;
+		Profiler::record(thread, name, start, end, depth);
+	}
+};
+
+#endif
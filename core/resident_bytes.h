@@ -0,0 +1,31 @@
+#ifndef _RESIDENT_BYTES_H_
+#define _RESIDENT_BYTES_H_
+
+#include <cstddef>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Bytes held by a vector, including unused capacity
+template <typename T>
+static size_t residentBytes(const std::vector<T>& v) {
+	return v.capacity() * sizeof(T);
+}
+
+// High-water mark of the process resident set so far, 0 where the platform does not report it
+static double peakResidentMiB() {
+#ifndef _WIN32
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+		return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+		return usage.ru_maxrss / 1024.0;
+#endif
+	}
+#endif
+	return 0.0;
+}
+
+#endif
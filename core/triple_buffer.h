@@ -0,0 +1,74 @@
+#ifndef _TRIPLE_BUFFER_H_
+#define _TRIPLE_BUFFER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// Lock-free single producer, single consumer hand-off of the latest value. The writer fills
+// writeSlot() and publishes it, the reader picks up the most recent publication with update()
+// and keeps reading readSlot() until the next one. Neither side has to wait for the other,
+// publications the reader never saw are overwritten. A reader that must see every publication
+// blocks in waitForUnread() instead of spinning.
+template <typename T>
+struct TripleBuffer {
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;		// Set while the middle slot holds a publication not yet read
+
+	T slots[3];
+	std::atomic<int> middle{1};
+	int writeIndex = 0;
+	int readIndex = 2;
+
+	// Only taken by publish() and blocked readers, never while a slot is accessed
+	std::mutex waitMutex;
+	std::condition_variable published;
+
+	// A slot reused from an earlier publication, every field must be rewritten
+	T& writeSlot() {
+		return slots[writeIndex];
+	}
+
+	void publish() {
+		int previous = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel);
+		writeIndex = previous & INDEX_MASK;
+		wakeReader();
+	}
+
+	// Block until a publication is unread or running is cleared, false in the latter case.
+	// Whoever clears running calls wakeReader() afterwards.
+	bool waitForUnread(const std::atomic<bool>& running) {
+		std::unique_lock<std::mutex> lock(waitMutex);
+		published.wait(lock, [&] { return hasUnread() || !running.load(); });
+		return hasUnread();
+	}
+
+	void wakeReader() {
+		// Taking the lock orders the notification after a waiter's check, so it cannot be missed
+		{
+			std::lock_guard<std::mutex> lock(waitMutex);
+		}
+		published.notify_one();
+	}
+
+	// True while the last publication has not been picked up by the reader
+	bool hasUnread() const {
+		return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+	}
+
+	// Swap in the latest publication, false when nothing new was published
+	bool update() {
+		if (!hasUnread()) {
+			return false;
+		}
+		int previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = previous & INDEX_MASK;
+		return true;
+	}
+
+	const T& readSlot() const {
+		return slots[readIndex];
+	}
+};
+
+#endif
@@ -3,14 +3,35 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <unordered_map>
 #include <unordered_set>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/norm.hpp>
 #include <render/shader.h>
+#include <render/gpu_profiler.h>
+#include <render/gl_counters.h>
+#include <render/gl_resources.h>
+#include <render/debug_font.h>
+#include <core/job_system.h>
+#include <core/triple_buffer.h>
+#include <core/log.h>
+#include <core/profiler.h>
+#include <core/frame_arena.h>
+#include <core/resident_bytes.h>
+#define ALLOCATION_TRACKER_IMPLEMENTATION
+#include <core/alloc_tracker.h>
 #include <vector>
 #include <iostream>
 #include <random>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #define TINYGLTF_IMPLEMENTATION
 #include <tiny_gltf.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -19,6 +40,14 @@
 #include <math.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+#include <scene/settings.h>
+#include <scene/frustum.h>
+#include <scene/clouds.h>
+#include <scene/mountain.h>
+#include <scene/sea.h>
+#include <scene/bot_animation.h>
+#include <scene/gltf_buffers.h>
+#include <scene/gltf_loader.h>
 #include "../Final_Project/Shaders/SkyBox_Shaders.h"
 #include "../Final_Project/Shaders/renderTextures.h"
 #include "../Final_Project/Shaders/DepthShaders.h"
@@ -26,6 +55,7 @@
 #include "../Final_Project/Shaders/debugQuadShaders.h"
 #include "../Final_Project/Shaders/animationShaders.h"
 #include "../Final_Project/Shaders/cloud_particle_rendering.h"
+#include "../Final_Project/Shaders/profilerOverlayShaders.h"
 #include <iomanip>
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
@@ -62,10 +92,6 @@ static float viewAzimuth = 0.0f;
 static float viewPolar = 0.0f;
 static float viewDistance = 300.0f;
 
-static float FoV = 40.0f;
-static float zNear = 1.0f;
-static float zFar = 1500.0f;
-
 // Lighting control
 const glm::vec3 wave500(0.0f, 255.0f, 146.0f);
 const glm::vec3 wave600(255.0f, 190.0f, 0.0f);
@@ -92,26 +118,662 @@ static float playbackSpeed = 2.0f;
 // Helper flag and function to save depth maps for debugging
 static bool saveDepth = true;
 
-// Struct defining a particle to be used in a cloud system.
-struct CloudParticle {
-	glm::vec3 position;
-	glm::vec3 velocity;
-	float size;
-	float alpha;
-	float life;
+// Asset lifetime: CPU copies of geometry are released once uploaded, unless a subsystem keeps them
+static bool keepCpuAssets = false;
+
+// Heap allocation tracking, compiled in with -DTRACK_ALLOCATIONS. Once warmed up, frames and the
+// guarded update paths are expected not to allocate at all.
+static const int ALLOCATION_WARMUP_FRAMES = 120;
+static bool failOnSteadyStateAllocation = false;	// Abort on the first offending frame instead of reporting
+
+// Frame profiler: F1 toggles the overlay, F2 writes a Chrome trace of the next frames and F3
+// starts or stops logging the GL call counters of every frame to CSV
+static bool showProfiler = false;
+static const int TRACE_CAPTURE_FRAMES = 120;
+static const char* TRACE_PATH = "../Final_Project/trace.json";
+static bool countGLCalls = true;		// Wrap the GL entry points, costs one extra indirect call each
+static const char* GL_COUNTERS_PATH = "../Final_Project/gl_counters.csv";
+
+// GPU memory accounting: estimated bytes of every GL object by owner, F4 logs the breakdown and
+// objects still alive at exit are listed as leaks
+static bool trackGpuMemory = true;
+static int gpuMemoryBudgetMB = 0;			// Warn when the estimate goes over, 0 is no budget
+
+// Benchmarking, set from the command line. Headless runs draw into an offscreen framebuffer of a
+// hidden window, or of GLFW's null platform when there is no display server at all.
+static bool headless = false;
+static int benchmarkFrames = 0;				// Measured frames before exiting, 0 runs until the window closes
+static int benchmarkWarmupFrames = 30;		// Drawn first and left out, first-use costs settle in them
+static GLuint sceneFramebuffer = 0;			// Frames are drawn here, 0 is the window
+static int randomSeed = -1;					// Seeds the cloud particles, -1 draws a seed from std::random_device
+static const char* replayPath = nullptr;		// Camera path replayed instead of interactive input
+static const char* recordPath = nullptr;		// Interactive camera path written out
+static const char* reportPath = nullptr;		// JSON summary of a benchmark run
+
+// Stress scene, see StressScene. Sizes come from the command line, the rest is filled in once it is built.
+static int stressPrefabs = 0;				// Building, metro stop and sports centre copies on a grid
+static int stressBots = 0;					// Animated bots besides the two hand-placed ones
+static int stressParticles = 0;				// Cloud particles, 0 keeps the default
+static size_t stressEntities = 0;			// Entities in the static scene
+static double stressGenerationMs = 0.0;
+
+// One line of the resident memory report printed after initialization
+static void reportResidentMemory(const char* subsystem, size_t bytes) {
+	LOG_INFO("  %-16s%.1f KiB", subsystem, bytes / 1024.0);
+}
+
+static void printUsage(const char* program) {
+	LOG_INFO("Usage: %s [--headless] [--frames N] [--warmup N] [--resolution WIDTHxHEIGHT] [--seed N]", program);
+	LOG_INFO("       [--replay PATH_FILE] [--record-path PATH_FILE] [--report JSON_FILE]");
+	LOG_INFO("       [--stress-prefabs N] [--stress-bots N] [--stress-particles N] [--vram-budget MB]");
+}
+
+// False on arguments that are not understood
+static bool parseArguments(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		const char* argument = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (strcmp(argument, "--headless") == 0) {
+			headless = true;
+		} else if (strcmp(argument, "--frames") == 0 && value != nullptr) {
+			benchmarkFrames = atoi(value);
+			i++;
+		} else if (strcmp(argument, "--warmup") == 0 && value != nullptr) {
+			benchmarkWarmupFrames = atoi(value);
+			i++;
+		} else if (strcmp(argument, "--resolution") == 0 && value != nullptr &&
+				   sscanf(value, "%dx%d", &windowWidth, &windowHeight) == 2 && windowWidth > 0 && windowHeight > 0) {
+			i++;
+		} else if (strcmp(argument, "--seed") == 0 && value != nullptr) {
+			randomSeed = atoi(value);
+			i++;
+		} else if (strcmp(argument, "--replay") == 0 && value != nullptr) {
+			replayPath = value;
+			i++;
+		} else if (strcmp(argument, "--record-path") == 0 && value != nullptr) {
+			recordPath = value;
+			i++;
+		} else if (strcmp(argument, "--report") == 0 && value != nullptr) {
+			reportPath = value;
+			i++;
+		} else if (strcmp(argument, "--stress-prefabs") == 0 && value != nullptr) {
+			stressPrefabs = std::max(0, atoi(value));
+			i++;
+		} else if (strcmp(argument, "--stress-bots") == 0 && value != nullptr) {
+			stressBots = std::max(0, atoi(value));
+			i++;
+		} else if (strcmp(argument, "--stress-particles") == 0 && value != nullptr) {
+			stressParticles = std::max(0, atoi(value));
+			i++;
+		} else if (strcmp(argument, "--vram-budget") == 0 && value != nullptr) {
+			gpuMemoryBudgetMB = std::max(0, atoi(value));
+			i++;
+		} else {
+			LOG_ERROR("Unknown or incomplete argument %s", argument);
+			printUsage(argv[0]);
+			return false;
+		}
+	}
+	if (headless && benchmarkFrames <= 0 && replayPath == nullptr) {
+		LOG_ERROR("--headless needs --frames or --replay, nothing could close the window otherwise");
+		return false;
+	}
+	if (replayPath != nullptr && recordPath != nullptr) {
+		LOG_ERROR("--replay and --record-path cannot be combined");
+		return false;
+	}
+	// Benchmarks draw the same scene every run
+	if ((benchmarkFrames > 0 || replayPath != nullptr) && randomSeed < 0) {
+		randomSeed = 1;
+	}
+	return true;
+}
+
+// Nearest-rank percentile of sorted samples
+static float percentile(const std::vector<float>& sorted, float p) {
+	size_t rank = size_t(std::ceil(p / 100.0f * sorted.size()));
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Distribution of per-frame times in milliseconds
+struct FrameTimeStats {
+	size_t count = 0;
+	double total = 0.0;
+	double mean = 0.0;
+	float min = 0.0f, p50 = 0.0f, p95 = 0.0f, p99 = 0.0f, max = 0.0f;
+
+	// Sorts the samples
+	explicit FrameTimeStats(std::vector<float>& samples) {
+		if (samples.empty()) {
+			return;
+		}
+		std::sort(samples.begin(), samples.end());
+		for (float sample : samples) {
+			total += sample;
+		}
+		count = samples.size();
+		mean = total / count;
+		min = samples.front();
+		p50 = percentile(samples, 50.0f);
+		p95 = percentile(samples, 95.0f);
+		p99 = percentile(samples, 99.0f);
+		max = samples.back();
+	}
+
+	void log(const char* label) const {
+		LOG_INFO("%s (ms): mean %.3f, min %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f", label, mean, min, p50, p95, p99, max);
+	}
+
+	void writeJson(FILE* file, const char* name) const {
+		fprintf(file, "  \"%s\": { \"frames\": %zu, \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+					  "\"p99\": %.4f, \"max\": %.4f },\n", name, count, mean, min, p50, p95, p99, max);
+	}
 };
 
-// A struct defining a cloud system of cloud particles.
-struct CloudSystem{
-	std::vector<CloudParticle> particles;
-	GLuint vertexArrayID, vertexBufferID;
-	GLuint textureID, shaderID;
-	GLuint mvpID, cameraRightID, cameraUpID, texSamplerID, alphaID;
+// Frame times and per-pass averages of a run, for comparing builds against each other
+static void writeBenchmarkJson(const char* path, const FrameTimeStats& cpu, const FrameTimeStats& gpu) {
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) {
+		LOG_ERROR("Failed to open %s for the benchmark report.", path);
+		return;
+	}
+	fprintf(file, "{\n");
+	fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n  \"headless\": %s,\n", windowWidth, windowHeight,
+			headless ? "true" : "false");
+	fprintf(file, "  \"warmupFrames\": %d,\n  \"seed\": %d,\n  \"replay\": \"", benchmarkWarmupFrames, randomSeed);
+	Profiler::writeEscaped(file, replayPath != nullptr ? replayPath : "");
+	fprintf(file, "\",\n");
+	fprintf(file, "  \"stress\": { \"prefabs\": %d, \"bots\": %d, \"particles\": %d, \"entities\": %zu, "
+				  "\"generationMs\": %.2f },\n", stressPrefabs, stressBots, stressParticles, stressEntities, stressGenerationMs);
+	fprintf(file, "  \"gpuMemory\": { \"bytes\": %llu, \"peakBytes\": %llu, \"objects\": %llu },\n",
+			(unsigned long long)GLResources::totalBytes(), (unsigned long long)GLResources::peakBytes(),
+			(unsigned long long)GLResources::objectCount());
+	cpu.writeJson(file, "cpuFrameMs");
+	gpu.writeJson(file, "gpuFrameMs");
+
+	const Profiler::State& profile = Profiler::state();
+	fprintf(file, "  \"passes\": [\n");
+	for (int i = 0; i < profile.scopeCount; ++i) {
+		const Profiler::ScopeStats& scope = profile.scopes[i];
+		double frames = profile.totalFrames > 0 ? double(profile.totalFrames) : 1.0;
+		double gpuFrames = profile.totalGpuFrames > 0 ? double(profile.totalGpuFrames) : 1.0;
+		fprintf(file, "    { \"name\": \"%s\", \"depth\": %d, \"cpuMeanMs\": %.4f, \"cpuMaxMs\": %.4f, "
+					  "\"gpuMeanMs\": %.4f, \"gpuMaxMs\": %.4f }%s\n", scope.name, scope.depth,
+				scope.totalCpuMs / frames, scope.maxCpuMs, scope.totalGpuMs / gpuFrames, scope.maxGpuMs,
+				i + 1 < profile.scopeCount ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	fclose(file);
+	LOG_INFO("Benchmark report written to %s", path);
+}
+
+static void reportBenchmark(std::vector<float>& cpuFrameTimes, std::vector<float>& gpuFrameTimes) {
+	if (cpuFrameTimes.empty()) {
+		return;
+	}
+	FrameTimeStats cpu(cpuFrameTimes);
+	FrameTimeStats gpu(gpuFrameTimes);
+	LOG_INFO("Benchmark: %zu frames at %dx%d%s in %.2f s, %.1f FPS", cpu.count, windowWidth, windowHeight,
+			 headless ? " headless" : "", cpu.total / 1000.0, 1000.0 / cpu.mean);
+	if (stressPrefabs > 0 || stressBots > 0 || stressParticles > 0) {
+		LOG_INFO("Stress scene: %d prefabs (%zu entities), %d bots, %d particles, generated in %.1f ms",
+				 stressPrefabs, stressEntities, stressBots, stressParticles, stressGenerationMs);
+	}
+	cpu.log("Frame time");
+	gpu.log("GPU frame time");
+	Profiler::printTotals();
+	if (reportPath != nullptr) {
+		writeBenchmarkJson(reportPath, cpu, gpu);
+	}
+}
+
+// Camera and light keyframes over simulated time, one per line of a text file:
+//   time  eye.x eye.y eye.z  lookat.x lookat.y lookat.z  light.x light.y light.z
+// Lines starting with # are skipped. Poses between keys are interpolated linearly and the last key
+// is held. --record-path writes the interactively driven camera in the same format.
+struct CameraPath {
+	static constexpr float RECORD_INTERVAL = 0.1f;		// Seconds between recorded keys
+
+	struct Key {
+		float time;
+		glm::vec3 eye;
+		glm::vec3 lookat;
+		glm::vec3 light;
+	};
+
+	std::vector<Key> keys;
+	FILE* recording = nullptr;
+	float lastRecorded = -1.0f;
+
+	bool load(const char* path) {
+		FILE* file = fopen(path, "r");
+		if (file == nullptr) {
+			LOG_ERROR("Failed to open camera path %s", path);
+			return false;
+		}
+		char line[256];
+		int lineNumber = 0;
+		while (fgets(line, sizeof(line), file) != nullptr) {
+			lineNumber++;
+			Key key;
+			if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+				continue;
+			}
+			if (sscanf(line, "%f %f %f %f %f %f %f %f %f %f", &key.time, &key.eye.x, &key.eye.y, &key.eye.z,
+					   &key.lookat.x, &key.lookat.y, &key.lookat.z, &key.light.x, &key.light.y, &key.light.z) != 10) {
+				LOG_ERROR("%s:%d is not a camera key", path, lineNumber);
+				fclose(file);
+				return false;
+			}
+			if (!keys.empty() && key.time < keys.back().time) {
+				LOG_ERROR("%s:%d goes back in time", path, lineNumber);
+				fclose(file);
+				return false;
+			}
+			keys.push_back(key);
+		}
+		fclose(file);
+		if (keys.empty()) {
+			LOG_ERROR("Camera path %s has no keys", path);
+			return false;
+		}
+		LOG_INFO("Replaying %zu camera keys over %.2f s from %s", keys.size(), duration(), path);
+		return true;
+	}
+
+	float duration() const {
+		return keys.empty() ? 0.0f : keys.back().time;
+	}
+
+	Key sample(float time) const {
+		size_t next = 0;
+		while (next < keys.size() && keys[next].time <= time) {
+			next++;
+		}
+		if (next == 0) {
+			return keys.front();
+		}
+		if (next == keys.size()) {
+			return keys.back();
+		}
+		const Key& a = keys[next - 1];
+		const Key& b = keys[next];
+		float t = (time - a.time) / (b.time - a.time);
+		Key key;
+		key.time = time;
+		key.eye = glm::mix(a.eye, b.eye, t);
+		key.lookat = glm::mix(a.lookat, b.lookat, t);
+		key.light = glm::mix(a.light, b.light, t);
+		return key;
+	}
+
+	bool startRecording(const char* path) {
+		recording = fopen(path, "w");
+		if (recording == nullptr) {
+			LOG_ERROR("Failed to open %s to record the camera path", path);
+			return false;
+		}
+		fprintf(recording, "# time  eye.x eye.y eye.z  lookat.x lookat.y lookat.z  light.x light.y light.z\n");
+		LOG_INFO("Recording the camera path to %s", path);
+		return true;
+	}
+
+	// Writes a key when RECORD_INTERVAL has passed since the last one
+	void record(float time, const glm::vec3& eye, const glm::vec3& target, const glm::vec3& light) {
+		if (recording == nullptr || (lastRecorded >= 0.0f && time - lastRecorded < RECORD_INTERVAL)) {
+			return;
+		}
+		lastRecorded = time;
+		fprintf(recording, "%.3f  %.3f %.3f %.3f  %.3f %.3f %.3f  %.3f %.3f %.3f\n", time, eye.x, eye.y, eye.z,
+				target.x, target.y, target.z, light.x, light.y, light.z);
+	}
+
+	void stopRecording() {
+		if (recording != nullptr) {
+			fclose(recording);
+			recording = nullptr;
+		}
+	}
+};
+
+// Static scene objects stored as packed component arrays. Entity i is entry i of every array, so the
+// systems below walk contiguous memory and never touch the structs that built the geometry.
+// Entities may hang off a parent entity; world matrices, normal matrices and bounds are cached and
+// only recomputed when an entity or one of its ancestors is marked dirty.
+struct Scene {
+	enum Flags : uint8_t {
+		FLAG_VISIBLE = 1 << 0,			// Written by cull() every frame
+		FLAG_CASTS_SHADOW = 1 << 1,
+		FLAG_DOUBLE_SIDED = 1 << 2,		// Drawn with face culling disabled
+		FLAG_TRANSFORM_DIRTY = 1 << 3,	// Local transform changed since the last updateTransforms()
+	};
+
+	static const GLuint TRANSFORM_BINDING = 1;		// Uniform block binding point of ObjectTransform
+	static const uint32_t NO_MESH = 0xFFFFFFFF;		// Anchor entity that only carries a transform
+	static const int NO_PARENT = -1;
+
+	// A draw range of a VAO laid out for the lighting shader (0 position, 1 normal, 2 uv)
+	struct Mesh {
+		GLuint vao;
+		GLenum mode;
+		GLsizei count;
+		GLenum indexType;			// 0 for glDrawArrays
+		size_t offset;				// Bytes into the index buffer, or the first vertex
+	};
+
+	struct Material {
+		GLuint texture;
+	};
+
+	// Components
+	std::vector<glm::mat4> localTransforms;
+	std::vector<int32_t> parents;		// Always a lower index than the child, NO_PARENT for roots
+	std::vector<glm::vec4> localBounds;
+	std::vector<glm::mat4> transforms;	// Cached world matrices
+	std::vector<glm::vec4> bounds;		// World space bounding sphere, xyz center and w radius
+	std::vector<uint32_t> meshes;
+	std::vector<uint32_t> materials;
+	std::vector<uint8_t> flags;
+
+	// Resources the components refer to by handle
+	std::vector<Mesh> meshTable;
+	std::vector<Material> materialTable;
+
+	// Model and normal matrix of every entity, one ObjectTransform block each, mirrored on the GPU
+	std::vector<glm::vec4> transformBlocks;
+	GLuint transformBufferID = 0;
+	GLsizeiptr transformStride = 0;		// Bytes per block, rounded up to the offset alignment
+	GLsizeiptr transformCapacity = 0;
+
+	// Every static object shares one lighting and one depth program
+	GLuint litProgramID;
+	GLuint depthProgramID;
+	GLuint viewProjectionID;
+	GLuint LSM_ID;
+	GLuint lightPositionID;
+	GLuint lightIntensityID;
+	GLuint textureSamplerID;
+	GLuint shadowMapTextureID;
+	GLuint lightSpaceMatrixID;
+
+	void initialize() {
+		GLOwnerScope owner("scene");
+		litProgramID = LoadShadersFromString(sceneLightingVertexShader, lightingFragmentShader);
+		depthProgramID = LoadShadersFromString(sceneDepthVertexShader, depthFragmentShader);
+		if (litProgramID == 0 || depthProgramID == 0) {
+			LOG_ERROR("Failed to load scene shaders.");
+		}
+		bindTransformBlock(litProgramID);
+		bindTransformBlock(depthProgramID);
+
+		viewProjectionID = glGetUniformLocation(litProgramID, "viewProjection");
+		LSM_ID = glGetUniformLocation(litProgramID, "lightSpaceMatrix");
+		lightPositionID = glGetUniformLocation(litProgramID, "lightPosition");
+		lightIntensityID = glGetUniformLocation(litProgramID, "lightIntensity");
+		textureSamplerID = glGetUniformLocation(litProgramID, "textureSampler");
+		shadowMapTextureID = glGetUniformLocation(litProgramID, "shadowMap");
+
+		lightSpaceMatrixID = glGetUniformLocation(depthProgramID, "lightSpaceMatrix");
+
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		GLsizeiptr blockSize = 2 * sizeof(glm::mat4);
+		transformStride = ((blockSize + alignment - 1) / alignment) * alignment;
+		glGenBuffers(1, &transformBufferID);
+	}
+
+	static void bindTransformBlock(GLuint programID) {
+		GLuint blockIndex = glGetUniformBlockIndex(programID, "ObjectTransform");
+		if (blockIndex == GL_INVALID_INDEX) {
+			LOG_ERROR("ObjectTransform uniform block not found in program %u", programID);
+			return;
+		}
+		glUniformBlockBinding(programID, blockIndex, TRANSFORM_BINDING);
+	}
+
+	// Record the attribute layout of the lighting shader in the currently bound VAO
+	static void bindLitAttributes(GLuint vertexBufferID, GLuint normalBufferID, GLuint uvBufferID, GLuint indexBufferID) {
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+		glEnableVertexAttribArray(1);
+		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+		glEnableVertexAttribArray(2);
+		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+		if (indexBufferID != 0) {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
+		}
+	}
+
+	uint32_t addMesh(GLuint vao, GLenum mode, GLsizei count, GLenum indexType, size_t offset) {
+		Mesh mesh = { vao, mode, count, indexType, offset };
+		meshTable.push_back(mesh);
+		return static_cast<uint32_t>(meshTable.size() - 1);
+	}
+
+	uint32_t addMaterial(GLuint texture) {
+		for (size_t i = 0; i < materialTable.size(); ++i) {
+			if (materialTable[i].texture == texture) {
+				return static_cast<uint32_t>(i);
+			}
+		}
+		Material material = { texture };
+		materialTable.push_back(material);
+		return static_cast<uint32_t>(materialTable.size() - 1);
+	}
+
+	// transform is relative to the parent, entityBounds is a bounding sphere in model space and an
+	// infinite radius is never culled
+	uint32_t addEntity(const glm::mat4& transform, const glm::vec4& entityBounds, uint32_t mesh, uint32_t material,
+					   uint8_t entityFlags, int32_t parent = NO_PARENT) {
+		uint32_t entity = reserveEntities(1);
+		setEntity(entity, transform, entityBounds, mesh, material, entityFlags, parent);
+		return entity;
+	}
+
+	// Room for count entities at the end, returns the first. They are filled in with setEntity(),
+	// which different threads may call for different entities.
+	uint32_t reserveEntities(size_t count) {
+		uint32_t first = static_cast<uint32_t>(transforms.size());
+		size_t size = transforms.size() + count;
+		localTransforms.resize(size);
+		parents.resize(size, NO_PARENT);
+		localBounds.resize(size);
+		transforms.resize(size);
+		bounds.resize(size);
+		meshes.resize(size, NO_MESH);
+		materials.resize(size, 0);
+		flags.resize(size, 0);
+		return first;
+	}
+
+	void setEntity(uint32_t entity, const glm::mat4& transform, const glm::vec4& entityBounds, uint32_t mesh,
+				   uint32_t material, uint8_t entityFlags, int32_t parent = NO_PARENT) {
+		localTransforms[entity] = transform;
+		parents[entity] = parent;
+		localBounds[entity] = entityBounds;
+		transforms[entity] = transform;
+		bounds[entity] = entityBounds;
+		meshes[entity] = mesh;
+		materials[entity] = material;
+		flags[entity] = entityFlags | FLAG_TRANSFORM_DIRTY;
+	}
+
+	// Transform-only entity other entities can be parented to
+	uint32_t addAnchor(const glm::mat4& transform, int32_t parent = NO_PARENT) {
+		return addEntity(transform, glm::vec4(0.0f), NO_MESH, 0, 0, parent);
+	}
+
+	void setLocalTransform(uint32_t entity, const glm::mat4& transform) {
+		localTransforms[entity] = transform;
+		flags[entity] |= FLAG_TRANSFORM_DIRTY;
+	}
+
+	// Parents precede their children, so one pass in index order sees every parent already updated.
+	// Blocks that changed are uploaded with a single buffer write.
+	void updateTransforms() {
+		size_t blockVec4s = transformStride / sizeof(glm::vec4);
+		if (transformBlocks.size() != transforms.size() * blockVec4s) {
+			transformBlocks.resize(transforms.size() * blockVec4s);
+		}
+
+		size_t firstDirty = transforms.size();
+		size_t lastDirty = 0;
+		for (size_t i = 0; i < transforms.size(); ++i) {
+			int32_t parent = parents[i];
+			if (parent != NO_PARENT && (flags[parent] & FLAG_TRANSFORM_DIRTY)) {
+				flags[i] |= FLAG_TRANSFORM_DIRTY;
+			}
+			if (!(flags[i] & FLAG_TRANSFORM_DIRTY)) {
+				continue;
+			}
+
+			if (parent == NO_PARENT) {
+				transforms[i] = localTransforms[i];
+			} else {
+				transforms[i] = transforms[parent] * localTransforms[i];
+			}
+			const glm::mat4& world = transforms[i];
+			float maxScale = std::max(glm::length(glm::vec3(world[0])),
+									  std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+			bounds[i] = glm::vec4(glm::vec3(world * glm::vec4(glm::vec3(localBounds[i]), 1.0f)), localBounds[i].w * maxScale);
+
+			glm::mat4 normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(world))));
+			glm::vec4* block = &transformBlocks[i * blockVec4s];
+			for (int c = 0; c < 4; ++c) {
+				block[c] = world[c];
+				block[4 + c] = normalMatrix[c];
+			}
+
+			firstDirty = std::min(firstDirty, i);
+			lastDirty = i;
+		}
+
+		if (firstDirty > lastDirty) {
+			return;
+		}
+		for (size_t i = firstDirty; i <= lastDirty; ++i) {
+			flags[i] &= ~FLAG_TRANSFORM_DIRTY;
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, transformBufferID);
+		GLsizeiptr required = static_cast<GLsizeiptr>(transforms.size()) * transformStride;
+		if (required > transformCapacity) {
+			transformCapacity = required;
+			glBufferData(GL_UNIFORM_BUFFER, transformCapacity, transformBlocks.data(), GL_DYNAMIC_DRAW);
+		} else {
+			glBufferSubData(GL_UNIFORM_BUFFER, firstDirty * transformStride, (lastDirty - firstDirty + 1) * transformStride,
+							&transformBlocks[firstDirty * blockVec4s]);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void cull(const glm::mat4& vp) {
+		Frustum frustum = Frustum::fromMatrix(vp);
+		for (size_t i = 0; i < bounds.size(); ++i) {
+			if (meshes[i] != NO_MESH && frustum.intersectsSphere(glm::vec3(bounds[i]), bounds[i].w)) {
+				flags[i] |= FLAG_VISIBLE;
+			} else {
+				flags[i] &= ~FLAG_VISIBLE;
+			}
+		}
+	}
+
+	void bindTransform(size_t entity) const {
+		glBindBufferRange(GL_UNIFORM_BUFFER, TRANSFORM_BINDING, transformBufferID, entity * transformStride, 2 * sizeof(glm::mat4));
+	}
+
+	void draw(const Mesh& mesh) {
+		if (mesh.indexType != 0) {
+			glDrawElements(mesh.mode, mesh.count, mesh.indexType, BUFFER_OFFSET(mesh.offset));
+		} else {
+			glDrawArrays(mesh.mode, static_cast<GLint>(mesh.offset), mesh.count);
+		}
+	}
+
+	void submitShadows(const glm::mat4& lightSpaceMatrix) {
+		Frustum frustum = Frustum::fromMatrix(lightSpaceMatrix);
+		glUseProgram(depthProgramID);
+		glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
+
+		GLuint boundVAO = 0;
+		for (size_t i = 0; i < transforms.size(); ++i) {
+			if (!(flags[i] & FLAG_CASTS_SHADOW) || !frustum.intersectsSphere(glm::vec3(bounds[i]), bounds[i].w)) {
+				continue;
+			}
+			const Mesh& mesh = meshTable[meshes[i]];
+			if (mesh.vao != boundVAO) {
+				glBindVertexArray(mesh.vao);
+				boundVAO = mesh.vao;
+			}
+			bindTransform(i);
+			draw(mesh);
+		}
+		glBindVertexArray(0);
+	}
+
+	// Expects the shadow map on texture unit 1
+	void submitLit(const glm::mat4& vp, const glm::mat4& lightSpaceMatrix) {
+		glUseProgram(litProgramID);
+		glUniformMatrix4fv(viewProjectionID, 1, GL_FALSE, &vp[0][0]);
+		glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
+		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
+		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
+		glUniform1i(shadowMapTextureID, 1);
+		glUniform1i(textureSamplerID, 0);
+		glActiveTexture(GL_TEXTURE0);
+
+		GLuint boundVAO = 0;
+		GLuint boundTexture = 0;
+		for (size_t i = 0; i < transforms.size(); ++i) {
+			if (!(flags[i] & FLAG_VISIBLE)) {
+				continue;
+			}
+			const Mesh& mesh = meshTable[meshes[i]];
+			GLuint texture = materialTable[materials[i]].texture;
+			if (mesh.vao != boundVAO) {
+				glBindVertexArray(mesh.vao);
+				boundVAO = mesh.vao;
+			}
+			if (texture != boundTexture) {
+				glBindTexture(GL_TEXTURE_2D, texture);
+				boundTexture = texture;
+			}
+			bindTransform(i);
+
+			if (flags[i] & FLAG_DOUBLE_SIDED) {
+				glDisable(GL_CULL_FACE);
+				draw(mesh);
+				glEnable(GL_CULL_FACE);
+			} else {
+				draw(mesh);
+			}
+		}
+		glBindVertexArray(0);
+	}
+
+	void cleanup() {
+		glDeleteBuffers(1, &transformBufferID);
+		glDeleteProgram(litProgramID);
+		glDeleteProgram(depthProgramID);
+	}
+};
+
+// Model space bounds of the canonical [-1, 1] box most scene geometry is built from
+static const glm::vec4 UNIT_BOX_BOUNDS(0.0f, 0.0f, 0.0f, 1.7320508f);
 
-	const int NUM_PARTICLES = 2000;
-	const float CLOUD_HEIGHT_MIN = 150.0f; // Adjust based on mountain height
-	const float CLOUD_HEIGHT_MAX = 200.0f;
-	const float CLOUD_RADIUS = 300.0f;     // How far clouds spread from center
+// A struct defining a cloud system of cloud particles, simulated by CloudSimulation.
+struct CloudSystem : CloudSimulation {
+	GLVertexArray vertexArrayID;
+	GLBuffer vertexBufferID;
+	GLTexture textureID;
+	GLProgram shaderID;
+	GLuint mvpID, cameraRightID, cameraUpID, texSamplerID, alphaID;
 
     const GLfloat vertices[12] = {
     	-0.5f, -0.5f, 0.0f,
@@ -121,7 +783,8 @@ struct CloudSystem{
     };
 
 	void initialize() {
-		shaderID = LoadShadersFromString(cloudVertexShader, cloudFragmentShader);
+		GLOwnerScope owner("clouds");
+		shaderID.reset(LoadShadersFromString(cloudVertexShader, cloudFragmentShader));
 
 		// Get uniform locations
 		mvpID = glGetUniformLocation(shaderID, "MVP");
@@ -130,104 +793,21 @@ struct CloudSystem{
 		texSamplerID = glGetUniformLocation(shaderID, "textureSampler");
 		alphaID = glGetUniformLocation(shaderID, "particleAlpha");
 
-		glGenVertexArrays(1, &vertexArrayID);
+		vertexArrayID.create();
 		glBindVertexArray(vertexArrayID);
 
-		glGenBuffers(1, &vertexBufferID);
+		vertexBufferID.create();
 		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
 		//TODO add a cloud texture.
-		textureID = LoadTextureTileBox("../Final_Project/Textures/Cloud.png");
-
-		initializeParticles();
-	}
-
-	void initializeParticles() {
-		particles.clear();
-		particles.reserve(NUM_PARTICLES);
-
-		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
-		std::uniform_real_distribution<float> radiusDist(0.0f, CLOUD_RADIUS);
-		std::uniform_real_distribution<float> heightDist(CLOUD_HEIGHT_MIN, CLOUD_HEIGHT_MAX);
-		std::uniform_real_distribution<float> sizeDist(20.0f, 40.0F);
-		std::uniform_real_distribution<float> lifeDist(5.0f, 10.0f );
-
-		// Sets up each particle to be used in our cloud effect, each particle is generated with a degree of randomness.
-		for(int i = 0; i < NUM_PARTICLES; i++) {
-			float angle = angleDist(gen);
-			float radius = radiusDist(gen);
-			float height = heightDist(gen);
-
-			CloudParticle particle;
-			particle.position = glm::vec3(
-				180.0f + radius * cos(angle),
-				height,
-				-100.0f + radius * sin(angle)
-				);
-
-			particle.velocity = glm::vec3(
-				cos(angle) * 2.0f,
-				0.0f,
-				sin(angle) * 2.0f
-				);
-
-			particle.size = sizeDist(gen);
-			particle.alpha = 0.3f;
-			particle.life = lifeDist(gen);
-
-			particles.push_back(particle);
-		}
-	}
-
-	void update(float deltaTime) {
-		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
-		std::uniform_real_distribution<float> radiusDist(0.0f, CLOUD_RADIUS);
-		std::uniform_real_distribution<float> heightDist(CLOUD_HEIGHT_MIN, CLOUD_HEIGHT_MAX);
-		std::uniform_real_distribution<float> sizeDist(20.0f, 40.0F);
-		std::uniform_real_distribution<float> lifeDist(5.0f, 10.0f );
-
-		// Iterate though each element in the container.
-		for(auto& particle : particles) {
-			particle.life -= deltaTime;
-
-			if (particle.life <= 0.0f) {
-				//Reset the particle to new random state.
-				float angle = angleDist(gen);
-				float radius = radiusDist(gen);
-				float height = heightDist(gen);
-
-				particle.position = glm::vec3(
-				180.0f + radius * cos(angle),
-				height,
-				-100.0f + radius * sin(angle)
-				);
-
-				particle.velocity = glm::vec3(
-					cos(angle) * 2.0f,
-					0.0f,
-					sin(angle) * 2.0f
-					);
-
-				particle.size = sizeDist(gen);
-				particle.alpha = 0.3f;
-				particle.life = lifeDist(gen);
-			}
-			else {
-				// update particle position
-				particle.position += particle.velocity * deltaTime;
+		textureID.reset(LoadTextureTileBox("../Final_Project/Textures/Cloud.png"));
 
-				// adjust the particle's alpha based on life.
-				particle.alpha = std::min(0.3f, particle.life * 0.1f);
-			}
-		}
+		initializeParticles(randomSeed);
 	}
 
-	void render(const glm::mat4& ViewProjection, const glm::vec3& cameraPos, const glm::vec3& lookat = glm::vec3(0.0f), const glm::vec3& up = glm::vec3(0.0f, 1.0f, 0.0f)) {
+	void render(const std::vector<glm::mat4>& drawMVPs, const std::vector<float>& drawAlphas,
+				const glm::vec3& cameraPos, const glm::vec3& lookat = glm::vec3(0.0f), const glm::vec3& up = glm::vec3(0.0f, 1.0f, 0.0f)) {
 		glUseProgram(shaderID);
 
 		//Enable blending to achieve transparent effect.
@@ -250,20 +830,10 @@ struct CloudSystem{
 		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-		// Sort particles by distance to camera (back to front)
-		std::sort(particles.begin(), particles.end(),
-			[cameraPos](const CloudParticle& a, const CloudParticle& b) {
-				return glm::length2(a.position - cameraPos) > glm::length2(b.position - cameraPos);
-			});
-
-		// Render each particle
-		for (const auto& particle : particles) {
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), particle.position);
-			model = glm::scale(model, glm::vec3(particle.size));
-
-			glm::mat4 MVP = ViewProjection * model;
-			glUniformMatrix4fv(mvpID, 1, GL_FALSE, &MVP[0][0]);
-			glUniform1f(alphaID, particle.alpha);
+		// Render each particle from the draw list
+		for (size_t i = 0; i < drawMVPs.size(); ++i) {
+			glUniformMatrix4fv(mvpID, 1, GL_FALSE, &drawMVPs[i][0][0]);
+			glUniform1f(alphaID, drawAlphas[i]);
 
 			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 		}
@@ -275,23 +845,22 @@ struct CloudSystem{
 	}
 
 	void cleanup() {
-		glDeleteVertexArrays(1, &vertexArrayID);
-		glDeleteVertexArrays(1, &vertexBufferID);
-		glDeleteTextures(1, &textureID);
-		glDeleteProgram(shaderID);
+		vertexArrayID.reset();
+		vertexBufferID.reset();
+		textureID.reset();
+		shaderID.reset();
 	}
 };
 
-// Struct defining the mountain surrounding the scene.
-struct Mountain {
+// Struct defining the mountain surrounding the scene, the mesh is built by MountainGeometry.
+struct Mountain : MountainGeometry {
     glm::vec3 position;
     glm::vec3 scale;
 	float rotationAngle = glm::radians(90.0f);        // Rotation angle in degrees (converted to radians)
 	glm::vec3 rotationAxis = glm::vec3(0.0f, 1.0f, 0.0f); // Rotation around Y-axis
 
-    std::vector<GLfloat> vertex_buffer_data;
-    std::vector<GLfloat> normal_buffer_data;
-    std::vector<GLfloat> uv_buffer_data;
+    GLsizei vertexCount = 0;
+    bool keepCpuGeometry = false;   // Set before initialize() by users of the CPU mesh, e.g. collision
 
     // OpenGL buffers and IDs
     glm::mat4 modelMatrix;
@@ -301,145 +870,8 @@ struct Mountain {
     GLuint uvBufferID;
     GLuint textureID;
 
-    // Shader variables
-    GLuint mvpMatrixID;
-    GLuint modelMatrixID;
-    GLuint viewMatrixID;
-    GLuint normalMatrixID;
-    GLuint lightPositionID;
-    GLuint lightIntensityID;
-    GLuint textureSamplerID;
-    GLuint programID;
-    GLuint depthShaderID;
-    GLuint shadowMapTextureID;
-    GLuint lightSpaceMatrixID;
-    GLuint LSM_ID;
-
-    // Mountain generation parameters
-    const int SEGMENTS = 20;  // Number of segments per edge
-    const float BASE_HEIGHT = 0.15f;
-    const float MAX_HEIGHT = 2.0f;
-
-    float perlinNoise(float x, float y) {
-        // Simple noise function for height variation
-        return sin(x * 0.1f) * cos(y * 0.1f) * 0.5f +
-               sin(x * 0.2f + y * 0.3f) * 0.25f;
-    }
-
-    float getHeight(float x, float z, float edgeDistance) {
-        // Create height variation that smoothly decreases as we move away from the edge
-        float noise = perlinNoise(x * 10.0f, z * 10.0f);
-        float height = MAX_HEIGHT * (1.0f - edgeDistance) * (0.8f + 0.2f * noise);
-        return std::max(BASE_HEIGHT, height);
-    }
-
-    void generateMountainGeometry() {
-        // Clear existing data
-        vertex_buffer_data.clear();
-        normal_buffer_data.clear();
-        uv_buffer_data.clear();
-
-        std::vector<std::vector<glm::vec3>> vertices;
-        std::vector<std::vector<float>> heights;
-
-        // Generate grid of vertices
-        for (int i = 0; i <= SEGMENTS; i++) {
-            std::vector<glm::vec3> row;
-            std::vector<float> heightRow;
-            float z = -1.0f + (2.0f * i / SEGMENTS);
-
-            for (int j = 0; j <= SEGMENTS; j++) {
-                float x = -1.0f + (2.0f * j / SEGMENTS);
-
-                // Calculate distance from edges
-                float distFromLeft = abs(x + 1.0f);
-                float distFromRight = abs(x - 1.0f);
-                float distFromBack = abs(z - 1.0f);
-
-                // Find minimum distance to any edge
-                float edgeDistance = std::min({distFromLeft, distFromRight, distFromBack});
-                edgeDistance = std::min(1.0f, edgeDistance * 2.0f);  // Scale distance for sharper falloff
-
-                // Generate height based on edge distance and noise
-                float height = getHeight(x, z, edgeDistance);
-
-                // Keep base height for points not near edges
-                if (edgeDistance > 0.8f) {
-                    height = BASE_HEIGHT;
-                }
-
-                // Store vertex and height
-                row.push_back(glm::vec3(x, height, z));
-                heightRow.push_back(height);
-            }
-            vertices.push_back(row);
-            heights.push_back(heightRow);
-        }
-
-        // Generate triangles
-        for (int i = 0; i < SEGMENTS; i++) {
-            for (int j = 0; j < SEGMENTS; j++) {
-                glm::vec3 v1 = vertices[i][j];
-                glm::vec3 v2 = vertices[i+1][j];
-                glm::vec3 v3 = vertices[i][j+1];
-                glm::vec3 v4 = vertices[i+1][j+1];
-
-                // Calculate normals
-                glm::vec3 normal1 = glm::normalize(glm::cross(v2 - v1, v3 - v1));
-                glm::vec3 normal2 = glm::normalize(glm::cross(v4 - v2, v3 - v2));
-
-                // First triangle
-                vertex_buffer_data.insert(vertex_buffer_data.end(), {
-                    v1.x, v1.y, v1.z,
-                    v2.x, v2.y, v2.z,
-                    v3.x, v3.y, v3.z
-                });
-
-                // Second triangle
-                vertex_buffer_data.insert(vertex_buffer_data.end(), {
-                    v2.x, v2.y, v2.z,
-                    v4.x, v4.y, v4.z,
-                    v3.x, v3.y, v3.z
-                });
-
-                // Normals for first triangle
-                normal_buffer_data.insert(normal_buffer_data.end(), {
-                    normal1.x, normal1.y, normal1.z,
-                    normal1.x, normal1.y, normal1.z,
-                    normal1.x, normal1.y, normal1.z
-                });
-
-                // Normals for second triangle
-                normal_buffer_data.insert(normal_buffer_data.end(), {
-                    normal2.x, normal2.y, normal2.z,
-                    normal2.x, normal2.y, normal2.z,
-                    normal2.x, normal2.y, normal2.z
-                });
-
-                // UV coordinates
-                float texU1 = static_cast<float>(j) / SEGMENTS;
-                float texU2 = static_cast<float>(j + 1) / SEGMENTS;
-                float texV1 = static_cast<float>(i) / SEGMENTS;
-                float texV2 = static_cast<float>(i + 1) / SEGMENTS;
-
-                // UVs for first triangle
-                uv_buffer_data.insert(uv_buffer_data.end(), {
-                	texU1, texV1,
-					texU1, texV2,
-					texU2, texV1
-                });
-
-                // UVs for second triangle
-                uv_buffer_data.insert(uv_buffer_data.end(), {
-                	texU1, texV2,
-                	texU2, texV2,
-                	texU2, texV1
-                });
-            }
-        }
-    }
-
     void initialize(glm::vec3 position, glm::vec3 scale) {
+        GLOwnerScope owner("mountain");
         this->position = position;
         this->scale = scale;
 
@@ -473,82 +905,25 @@ struct Mountain {
         glBufferData(GL_ARRAY_BUFFER, uv_buffer_data.size() * sizeof(GLfloat),
                     uv_buffer_data.data(), GL_STATIC_DRAW);
 
-        // Load shaders
-        programID = LoadShadersFromString(lightingVertexShader, lightingFragmentShader);
-        depthShaderID = LoadShadersFromString(depthVertexShader, depthFragmentShader);
+        vertexCount = static_cast<GLsizei>(vertex_buffer_data.size() / 3);
+        if (!keepCpuGeometry && !keepCpuAssets) {
+            std::vector<GLfloat>().swap(vertex_buffer_data);
+            std::vector<GLfloat>().swap(normal_buffer_data);
+            std::vector<GLfloat>().swap(uv_buffer_data);
+        }
 
-        // Get uniform locations
-        mvpMatrixID = glGetUniformLocation(programID, "MVP");
-        modelMatrixID = glGetUniformLocation(programID, "modelMatrix");
-        normalMatrixID = glGetUniformLocation(programID, "normalMatrix");
-        lightPositionID = glGetUniformLocation(programID, "lightPosition");
-        lightIntensityID = glGetUniformLocation(programID, "lightIntensity");
-        textureSamplerID = glGetUniformLocation(programID, "textureSampler");
-        shadowMapTextureID = glGetUniformLocation(programID, "shadowMap");
-        LSM_ID = glGetUniformLocation(programID, "lightSpaceMatrix");
+        Scene::bindLitAttributes(vertexBufferID, normalBufferID, uvBufferID, 0);
+        glBindVertexArray(0);
 
         // Load mountain texture
         textureID = LoadTextureTileBox("../Final_Project/Textures/mountain_texture2.jpg");
     }
 
-    void renderWithLight(glm::mat4 cameraMatrix, glm::mat4 lightSpaceMatrix) {
-        glUseProgram(programID);
-        glBindVertexArray(vertexArrayID);
-
-        // Enable vertex attributes
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-        // Set uniforms
-        glm::mat4 mvp = cameraMatrix * modelMatrix;
-        glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-        glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-        glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-        glUniformMatrix3fv(normalMatrixID, 1, GL_FALSE, &normalMatrix[0][0]);
-
-        glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-        glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-        glUniform1i(shadowMapTextureID, 1);
-
-        // Bind texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glUniform1i(textureSamplerID, 0);
-
-        // Draw triangles
-        glDrawArrays(GL_TRIANGLES, 0, vertex_buffer_data.size() / 3);
-
-        // Disable vertex attributes
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(2);
-    }
-
-    void renderShadow(glm::mat4 lightSpaceMatrix) {
-        glUseProgram(depthShaderID);
-        glBindVertexArray(vertexArrayID);
-
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-        glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-        glDrawArrays(GL_TRIANGLES, 0, vertex_buffer_data.size() / 3);
-
-        glDisableVertexAttribArray(0);
+    // Heights stay within [0.15, 2] over the [-1, 1] footprint
+    void addToScene(Scene &scene) {
+        scene.addEntity(modelMatrix, glm::vec4(0.0f, 1.0f, 0.0f, 1.7320508f),
+                        scene.addMesh(vertexArrayID, GL_TRIANGLES, vertexCount, 0, 0),
+                        scene.addMaterial(textureID), Scene::FLAG_CASTS_SHADOW);
     }
 
     void cleanup() {
@@ -557,8 +932,6 @@ struct Mountain {
         glDeleteBuffers(1, &uvBufferID);
         glDeleteVertexArrays(1, &vertexArrayID);
         glDeleteTextures(1, &textureID);
-        glDeleteProgram(programID);
-        glDeleteProgram(depthShaderID);
     }
 };
 
@@ -788,28 +1161,12 @@ struct metro_stop {
 	GLuint vertexArrayID;
 	GLuint vertexBufferID;
 	GLuint indexBufferID;
-	GLuint colorBufferID;
 	GLuint normalBufferID;
 	GLuint uvBufferID;
 	GLuint textureID, textureID2;
 
-
-	// Shader variable IDs
-	GLuint mvpMatrixID;
-	GLuint textureSamplerID;
-	GLuint lightPositionID;
-	GLuint lightIntensityID;
-	GLuint lightSpaceMatrixID;
-	GLuint normalMatrixID;
-	GLuint modelMatrixID;
-	GLuint modelMatrixDepthID;
-	GLuint LSM_ID;
-	GLuint shadowMapTextureID;
-
-	GLuint programID2;
-	GLuint depthShaderID;
-
 	void initialize(glm::vec3 position, glm::vec3 scale, float rotationAngle) {
+		GLOwnerScope owner("metro stops");
 		// Define scale of the building geometry
 		this->position = position;
 		this->scale = scale;
@@ -850,163 +1207,35 @@ struct metro_stop {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_buffer_data), index_buffer_data, GL_STATIC_DRAW);
 
-		programID2 = LoadShadersFromString(lightingVertexShader,lightingFragmentShader );
-		if (programID2 == 0)
-		{
-			std::cerr << "lighting shaders failed to load shaders." << std::endl;
-		}
-
-		depthShaderID = LoadShadersFromString(depthVertexShader,depthFragmentShader );
-		if (depthShaderID == 0)
-		{
-			std::cerr << "Depth shaders ailed to load shaders." << std::endl;
-		}
-
-		//Light rendering shader uniforms
-		mvpMatrixID = glGetUniformLocation(programID2, "MVP");
-		lightPositionID = glGetUniformLocation(programID2, "lightPosition");
-		lightIntensityID = glGetUniformLocation(programID2, "lightIntensity");
-		modelMatrixID = glGetUniformLocation(programID2, "modelMatrix");
-		normalMatrixID = glGetUniformLocation(programID2, "normalMatrix");
-		LSM_ID = glGetUniformLocation(programID2, "lightSpaceMatrix");
-		shadowMapTextureID = glGetUniformLocation(programID2, "shadowMap");
-		textureSamplerID = glGetUniformLocation(programID2,"textureSampler");
-
-
-
-
-		//Depth rendering shader uniforms
-		modelMatrixDepthID = glGetUniformLocation(depthShaderID, "model");
-		lightSpaceMatrixID = glGetUniformLocation(depthShaderID, "lightSpaceMatrix");
+		Scene::bindLitAttributes(vertexBufferID, normalBufferID, uvBufferID, indexBufferID);
+		glBindVertexArray(0);
 
 		textureID = LoadTextureTileBox(textureLocation.c_str());
 		textureID2 = LoadTextureTileBox(textureLocation2.c_str());
 	}
 
-	void renderWithLight(glm::mat4 cameraMatrix, glm::mat4 lightSpaceMatrix) {
-		glUseProgram(programID2);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glm::mat4 mvp = cameraMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-		glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-
-		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-		glUniformMatrix3fv(normalMatrixID, 1, GL_FALSE, &normalMatrix[0][0]);
-		glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-
-		// Set light data
-		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-
-		glUniform1i(shadowMapTextureID, 1);
-
-		glEnable(GL_DEPTH_TEST);
-		glDisable(GL_CULL_FACE);
-
-
-		//Set textureSampler to use texture unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glUniform1i(textureSamplerID, 0);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			18,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glBindTexture(GL_TEXTURE_2D, textureID2);
-		glUniform1i(textureSamplerID, 0);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			12,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)(18 * sizeof(GLuint))           // element array buffer offset
-		);
-
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glUniform1i(textureSamplerID, 0);
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			30,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)(30 * sizeof(GLuint))           // element array buffer offset
-		);
-
-		glEnable(GL_CULL_FACE);
-
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-	}
-
-	void renderShadow(glm::mat4 lightSpaceMatrix) {
-		glUseProgram(depthShaderID);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glUniformMatrix4fv(modelMatrixDepthID, 1, GL_FALSE, &modelMatrix[0][0]);
-		glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			30,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-	}
+	// Three textured ranges drawn double sided, only the first two cast shadows
+	void addToScene(Scene &scene) {
+		uint8_t flags = Scene::FLAG_DOUBLE_SIDED;
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 18, GL_UNSIGNED_INT, 0),
+						scene.addMaterial(textureID), flags | Scene::FLAG_CASTS_SHADOW);
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 12, GL_UNSIGNED_INT, 18 * sizeof(GLuint)),
+						scene.addMaterial(textureID2), flags | Scene::FLAG_CASTS_SHADOW);
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 30, GL_UNSIGNED_INT, 30 * sizeof(GLuint)),
+						scene.addMaterial(textureID), flags);
+	}
 
 	void cleanup() {
 		glDeleteBuffers(1, &vertexBufferID);
-		glDeleteBuffers(1, &colorBufferID);
+		glDeleteBuffers(1, &normalBufferID);
 		glDeleteBuffers(1, &indexBufferID);
 		glDeleteVertexArrays(1, &vertexArrayID);
 		glDeleteBuffers(1, &uvBufferID);
 		glDeleteTextures(1, &textureID);
-		glDeleteProgram(programID2);
+		glDeleteTextures(1, &textureID2);
 	}
 };
 
@@ -1155,29 +1384,12 @@ struct sports_center {
 	GLuint vertexArrayID;
 	GLuint vertexBufferID;
 	GLuint indexBufferID;
-	GLuint colorBufferID;
 	GLuint normalBufferID;
 	GLuint uvBufferID;
 	GLuint textureID, textureID2;
 
-
-	// Shader variable IDs
-	GLuint mvpMatrixID;
-	GLuint textureSamplerID;
-	GLuint lightPositionID;
-	GLuint lightIntensityID;
-	GLuint lightSpaceMatrixID;
-	GLuint normalMatrixID;
-	GLuint modelMatrixID;
-	GLuint modelMatrixDepthID;
-	GLuint LSM_ID;
-	GLuint shadowMapTextureID;
-
-	GLuint programID;
-	GLuint programID2;
-	GLuint depthShaderID;
-
 	void initialize(glm::vec3 position, glm::vec3 scale) {
+		GLOwnerScope owner("sports centres");
 		// Define scale of the building geometry
 		this->position = position;
 		this->scale = scale;
@@ -1216,152 +1428,41 @@ struct sports_center {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_buffer_data), index_buffer_data, GL_STATIC_DRAW);
 
-		// Create and compile our GLSL program from the shaders
-		programID2 = LoadShadersFromString(lightingVertexShader,lightingFragmentShader );
-		if (programID2 == 0)
-		{
-			std::cerr << "lighting shaders failed to load shaders." << std::endl;
-		}
-
-		depthShaderID = LoadShadersFromString(depthVertexShader,depthFragmentShader );
-		if (depthShaderID == 0)
-		{
-			std::cerr << "Depth shaders ailed to load shaders." << std::endl;
-		}
-
-		//Light rendering shader uniforms
-		mvpMatrixID = glGetUniformLocation(programID2, "MVP");
-		lightPositionID = glGetUniformLocation(programID2, "lightPosition");
-		lightIntensityID = glGetUniformLocation(programID2, "lightIntensity");
-		modelMatrixID = glGetUniformLocation(programID2, "modelMatrix");
-		normalMatrixID = glGetUniformLocation(programID2, "normalMatrix");
-		LSM_ID = glGetUniformLocation(programID2, "lightSpaceMatrix");
-		shadowMapTextureID = glGetUniformLocation(programID2, "shadowMap");
-		textureSamplerID = glGetUniformLocation(programID2,"textureSampler");
-
-		//Depth rendering shader uniforms
-		modelMatrixDepthID = glGetUniformLocation(depthShaderID, "model");
-		lightSpaceMatrixID = glGetUniformLocation(depthShaderID, "lightSpaceMatrix");
+		Scene::bindLitAttributes(vertexBufferID, normalBufferID, uvBufferID, indexBufferID);
+		glBindVertexArray(0);
 
 		textureID = LoadTextureTileBox(textureLocation.c_str());
 		textureID2 = LoadTextureTileBox(textureLocation2.c_str());
 	}
 
-	void renderWithLight(glm::mat4 cameraMatrix, glm::mat4 lightSpaceMatrix) {
-		glUseProgram(programID2);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glm::mat4 mvp = cameraMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-		glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-
-		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-		glUniformMatrix3fv(normalMatrixID, 1, GL_FALSE, &normalMatrix[0][0]);
-		glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-
-		// Set light data
-		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-
-		glUniform1i(shadowMapTextureID, 1);
-
-
-		//Set textureSampler to use texture unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glUniform1i(textureSamplerID, 0);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			24,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glBindTexture(GL_TEXTURE_2D, textureID2);
-		glUniform1i(textureSamplerID, 0);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			12,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)(24 * sizeof(GLuint))           // element array buffer offset
-		);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-	}
-
-	void renderShadow(glm::mat4 lightSpaceMatrix) {
-		glUseProgram(depthShaderID);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glUniformMatrix4fv(modelMatrixDepthID, 1, GL_FALSE, &modelMatrix[0][0]);
-		glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			36,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+	// Walls, then the court texture on the remaining two faces
+	void addToScene(Scene &scene) {
+		uint8_t flags = Scene::FLAG_CASTS_SHADOW;
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 24, GL_UNSIGNED_INT, 0),
+						scene.addMaterial(textureID), flags);
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 12, GL_UNSIGNED_INT, 24 * sizeof(GLuint)),
+						scene.addMaterial(textureID2), flags);
 	}
 
 	void cleanup() {
 		glDeleteBuffers(1, &vertexBufferID);
-		glDeleteBuffers(1, &colorBufferID);
+		glDeleteBuffers(1, &normalBufferID);
 		glDeleteBuffers(1, &indexBufferID);
 		glDeleteVertexArrays(1, &vertexArrayID);
 		glDeleteBuffers(1, &uvBufferID);
 		glDeleteTextures(1, &textureID);
-		glDeleteProgram(programID2);
+		glDeleteTextures(1, &textureID2);
 	}
 };
 
 // Standard skybox struct.
 struct skybox {
- GLuint skyboxVAO, skyboxVBO;
-    GLuint cubemapTexture;
-    GLuint programID;
+ GLVertexArray skyboxVAO;
+    GLBuffer skyboxVBO;
+    GLTexture cubemapTexture;
+    GLProgram programID;
     GLuint viewLoc, projectionLoc;
 
 
@@ -1421,7 +1522,7 @@ struct skybox {
 				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
 				stbi_image_free(data);
 			} else {
-				std::cerr << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
+				LOG_ERROR("Cubemap texture failed to load at path: %s", faces[i].c_str());
 				stbi_image_free(data);
 			}
 		}
@@ -1438,10 +1539,11 @@ struct skybox {
 	}
 
     skybox(std::vector<std::string> faces) {
-        cubemapTexture = loadCubemap(faces);
+        GLOwnerScope owner("skybox");
+        cubemapTexture.reset(loadCubemap(faces));
 
-        glGenVertexArrays(1, &skyboxVAO);
-        glGenBuffers(1, &skyboxVBO);
+        skyboxVAO.create();
+        skyboxVBO.create();
 
         glBindVertexArray(skyboxVAO);
 
@@ -1453,10 +1555,10 @@ struct skybox {
 
 		glBindVertexArray(0);  // Unbind VAO
 
-		programID = LoadShadersFromString(SkyboxVertexShader, SkyboxFragmentShader);
+		programID.reset(LoadShadersFromString(SkyboxVertexShader, SkyboxFragmentShader));
 		if (programID == 0)
 		{
-			std::cerr << "Failed to load shaders." << std::endl;
+			LOG_ERROR("Failed to load shaders.");
 		}
         viewLoc = glGetUniformLocation(programID, "view");
         projectionLoc = glGetUniformLocation(programID, "projection");
@@ -1470,7 +1572,7 @@ struct skybox {
 		glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(glm::mat4(glm::mat3(view))));
 		glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
-		if (viewLoc == -1 || projectionLoc == -1) { std::cerr << "Error: Could not find 'view' or 'projection' uniforms in the shader." << std::endl; }
+		if (viewLoc == -1 || projectionLoc == -1) { LOG_ERROR("Could not find 'view' or 'projection' uniforms in the shader."); }
 
 		glBindVertexArray(skyboxVAO);
 		glActiveTexture(GL_TEXTURE0);
@@ -1482,6 +1584,13 @@ struct skybox {
 
 		glDepthFunc(GL_LESS);
 	}
+
+	void cleanup() {
+		skyboxVAO.reset();
+		skyboxVBO.reset();
+		cubemapTexture.reset();
+		programID.reset();
+	}
 };
 
 // A struct drawing world attributes, road textures, footpath textures etc.
@@ -1641,24 +1750,8 @@ struct world_attributes{
 	GLuint uvBufferID;
 	GLuint TextureID, roadTextureID;
 
-
-	// Shader variable IDs
-	GLuint mvpMatrixID;
-	GLuint textureSamplerID;
-	GLuint lightPositionID;
-	GLuint lightIntensityID;
-	GLuint lightSpaceMatrixID;
-	GLuint normalMatrixID;
-	GLuint modelMatrixID;
-	GLuint modelMatrixDepthID;
-	GLuint LSM_ID;
-	GLuint shadowMapTextureID;
-
-	GLuint programID;
-	GLuint programID2;
-	GLuint depthShaderID;
-
 	void initialize(glm::vec3 position, glm::vec3 scale) {
+        GLOwnerScope owner("roads");
         this->position = position;
         this->scale = scale;
 
@@ -1693,173 +1786,51 @@ struct world_attributes{
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_buffer_data), index_buffer_data, GL_STATIC_DRAW);
 
-        depthShaderID = LoadShadersFromString(depthVertexShader, depthFragmentShader);
-        programID = LoadShadersFromString(lightingVertexShader, lightingFragmentShader);
+        Scene::bindLitAttributes(vertexBufferID, normalBufferID, uvBufferID, indexBufferID);
+        glBindVertexArray(0);
+
         TextureID = LoadTextureTileBox("../Final_Project/Textures/footpath_text.jpg");
 	    roadTextureID = LoadTextureTileBox("../Final_Project/Textures/Road_text.jpg");
 
-        if (programID == 0 || depthShaderID == 0) {
-            std::cerr << "Failed to load shaders." << std::endl;
-        }
         if (TextureID == 0) {
-            std::cerr << "Failed to load texture." << std::endl;
+            LOG_ERROR("Failed to load texture.");
         }
-
-        mvpMatrixID = glGetUniformLocation(programID, "MVP");
-        modelMatrixID = glGetUniformLocation(programID, "modelMatrix");
-        normalMatrixID = glGetUniformLocation(programID, "normalMatrix");
-    	LSM_ID = glGetUniformLocation(programID, "lightSpaceMatrix");
-
-        lightPositionID = glGetUniformLocation(programID, "lightPosition");
-        lightIntensityID = glGetUniformLocation(programID, "lightIntensity");
-        textureSamplerID = glGetUniformLocation(programID, "textureSampler");
-    	shadowMapTextureID = glGetUniformLocation(programID, "shadowMap");
-
-
-    	modelMatrixDepthID = glGetUniformLocation(depthShaderID, "model");
-    	lightSpaceMatrixID = glGetUniformLocation(depthShaderID, "lightSpaceMatrix");
     }
 
-	void renderShadow(glm::mat4 lightSpaceMatrix) {
-	    	glUseProgram(depthShaderID);
-
-	    	glBindVertexArray(vertexArrayID);
-
-	    	glEnableVertexAttribArray(0);
-	    	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-	    	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	    	glEnableVertexAttribArray(1);
-	    	glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-	    	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-	    	glEnableVertexAttribArray(2);
-	    	glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-	    	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	    	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-	    	glUniformMatrix4fv(modelMatrixDepthID, 1, GL_FALSE, &modelMatrix[0][0]);
-	    	glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-	    	// Draw the box
-	    	glDrawElements(
-				GL_TRIANGLES,      // mode
-				42,    			   // number of indices
-				GL_UNSIGNED_INT,   // type
-				(void*)0           // element array buffer offset
-			);
-
-	    	glDisableVertexAttribArray(0);
-	    	glDisableVertexAttribArray(1);
-	    	glDisableVertexAttribArray(2);
-	    }
-
-	void renderWithLight(glm::mat4 cameraMatrix, glm::mat4 lightSpaceMatrix, glm::vec3 lightIntensity, glm::vec3 lightPosition) {
-	    	glUseProgram(programID);
-	    	glBindVertexArray(vertexArrayID);
-
-	    	glEnableVertexAttribArray(0);
-	    	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-	    	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	    	glEnableVertexAttribArray(1);
-	    	glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-	    	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	    	glEnableVertexAttribArray(2);
-	    	glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-	    	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-	    	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-	    	glm::mat4 mvp = cameraMatrix * modelMatrix;
-	    	glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-	    	glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-
-	    	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-	    	glUniformMatrix3fv(normalMatrixID, 1, GL_FALSE, &normalMatrix[0][0]);
-	    	glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-
-
-	    	// Set light data
-	    	glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-	    	glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-	    	// Bind shadow map texture
-	    	glUniform1i(shadowMapTextureID, 1);
-
-
-	    	//Set textureSampler to use texture unit 0
-	    	glActiveTexture(GL_TEXTURE0);
-	    	glBindTexture(GL_TEXTURE_2D, TextureID);
-	    	glUniform1i(textureSamplerID, 0);
-
-	    	// Draw the footpaths
-	    	glDrawElements(
-				GL_TRIANGLES,      // mode
-				30,    			   // number of indices
-				GL_UNSIGNED_INT,   // type
-				(void*)0           // element array buffer offset
-			);
-
-			glBindTexture(GL_TEXTURE_2D, roadTextureID);
-			glUniform1i(textureSamplerID, 0);
-
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			6,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)(30 * sizeof(GLuint))           // element array buffer offset
-		);
-
-		glBindTexture(GL_TEXTURE_2D, TextureID);
-		glUniform1i(textureSamplerID, 0);
-
-		glDrawElements(
-		GL_TRIANGLES,      // mode
-		6,    			   // number of indices
-		GL_UNSIGNED_INT,   // type
-		(void*)(36 * sizeof(GLuint))           // element array buffer offset
-		);
-
-	    	glDisableVertexAttribArray(0);
-	    	glDisableVertexAttribArray(1);
-	    	glDisableVertexAttribArray(2);
-	    }
+	// Footpaths, the central road, then the last footpath
+	void addToScene(Scene &scene) {
+		uint8_t flags = Scene::FLAG_CASTS_SHADOW;
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 30, GL_UNSIGNED_INT, 0),
+						scene.addMaterial(TextureID), flags);
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 6, GL_UNSIGNED_INT, 30 * sizeof(GLuint)),
+						scene.addMaterial(roadTextureID), flags);
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 6, GL_UNSIGNED_INT, 36 * sizeof(GLuint)),
+						scene.addMaterial(TextureID), flags);
+	}
 
 	void cleanup() {
 	    	glDeleteBuffers(1, &vertexBufferID);
+	    	glDeleteBuffers(1, &normalBufferID);
 	    	glDeleteBuffers(1, &indexBufferID);
 	    	glDeleteVertexArrays(1, &vertexArrayID);
 	    	glDeleteBuffers(1, &uvBufferID);
 	    	glDeleteTextures(1, &TextureID);
-	    	glDeleteProgram(programID);
+	    	glDeleteTextures(1, &roadTextureID);
 	    }
 
 };
 
 // Struct to set up the main features of the scene, the sea, cliff and plateau.
-struct world_setup {
+struct world_setup : SeaSimulation {
 	glm::vec3 position;
 	glm::vec3 scale;
 
-	struct SeaVertex {
-		glm::vec3 position;
-		glm::vec2 texCoord;
-		glm::vec3 normal;
-	};
-
-	std::vector<SeaVertex> seaVertices;
-	std::vector<GLuint> seaIndices;
+	GLsizei seaIndexCount = 0;
 	GLuint seaVAO, seaVBO, seaEBO;
-	float seaTime = 0.0f;
-
-	const int SEA_GRID_SIZE = 64;
-	const float SEA_EXTEND_OUT = 2000.0f;
-	const float SEA_EXTEND_SIDE = 3000.0f;
-	const float CLIFF_BASE_X = 0.0f;
-	const float TEXTURE_REPEAT = 50.0f;
+	float uploadedSeaTime = -1.0f;		// Wave time of the vertices in seaVBO
 
 
 	GLfloat vertex_buffer_data[24] = {
@@ -1918,25 +1889,8 @@ struct world_setup {
 	GLuint normalBufferID;
 	GLuint TextureID, TextureID2, TextureID3;
 
-
-	// Shader variable IDs
-	GLuint normalMatrixID;
-	GLuint textureSamplerID;
-	GLuint mvpMatrixID;
-	GLuint modelMatrixID;
-	GLuint lightPositionID;
-	GLuint lightIntensityID;
-	GLuint programID2;
-	GLuint depthShaderID;
-
-
-	GLuint simpleDepthShader;
-	GLuint lightSpaceMatrixID;
-	GLuint modelMatrixDepthID;
-	GLuint shadowMapTextureID;
-	GLuint LSM_ID;
-
 	void intialize(glm::vec3 position, glm::vec3 scale) {
+		GLOwnerScope owner("cliff and sea");
 		this->position = position;
 		this->scale = scale;
 
@@ -1971,209 +1925,19 @@ struct world_setup {
 		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(normal_buffer_data), normal_buffer_data, GL_STATIC_DRAW);
 
-		programID2 = LoadShadersFromString(lightingVertexShader, lightingFragmentShader);
-		if (programID2 == 0)
-		{
-			std::cerr << "Failed to load shaders." << std::endl;
-		}
-		else {
-			std::cerr << "loaded lighting shaders." << std::endl;
-		}
-
-		depthShaderID = LoadShadersFromString(depthVertexShader, depthFragmentShader);
-		if (programID2 == 0)
-		{
-			std::cerr << "Failed to load shaders." << std::endl;
-		}
-		else {
-			std::cerr << "loaded lighting shaders." << std::endl;
-		}
-		modelMatrixDepthID = glGetUniformLocation(depthShaderID, "model");
-		lightSpaceMatrixID = glGetUniformLocation(depthShaderID, "lightSpaceMatrix");
-
-		shadowMapTextureID = glGetUniformLocation(programID2, "shadowMap");
-		LSM_ID = glGetUniformLocation(programID2, "lightSpaceMatrix");
-		mvpMatrixID = glGetUniformLocation(programID2, "MVP");
-		lightPositionID = glGetUniformLocation(programID2, "lightPosition");
-		lightIntensityID = glGetUniformLocation(programID2, "lightIntensity");
-		modelMatrixID = glGetUniformLocation(programID2, "modelMatrix");
-		normalMatrixID = glGetUniformLocation(programID2, "normalMatrix");
-
+		Scene::bindLitAttributes(vertexBufferID, normalBufferID, uvBufferID, indexBufferID);
+		glBindVertexArray(0);
 
 		TextureID = LoadTextureTileBox("../Final_Project/Textures/Cliff_face.jpg");
 		TextureID2 = LoadTextureTileBox("../Final_Project/Textures/grass_texture.jpg");
 		TextureID3 = LoadTextureTileBox("../Final_Project/Textures/Ocean_Texture.jpg");
 
-		textureSamplerID = glGetUniformLocation(programID2, "textureSampler");
-
-		if ( mvpMatrixID== -1 || textureSamplerID == -1  ) {
-			std::cout << "Error loading shaders." << std::endl;
-		}
         //creates data to be used in the creation and rendering of the sea.
 		initializeCliffSea();
 	}
 
-	void renderWithLight(glm::mat4 cameraMatrix, glm::mat4 lightSpaceMatrix) {
-		static float lastTime = glfwGetTime();
-		float currentTime = glfwGetTime();
-		float deltaTime = currentTime - lastTime;
-		lastTime = currentTime;
-
-		updateCliffSea(deltaTime);
-
-		glUseProgram(programID2);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glm::mat4 mvp = cameraMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-		glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-
-		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-		glUniformMatrix3fv(normalMatrixID, 1, GL_FALSE, &normalMatrix[0][0]);
-		glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-
-
-		// Set light data
-		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-		// Bind shadow map texture
-		glUniform1i(shadowMapTextureID, 1);
-
-
-		//Set textureSampler to use texture unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, TextureID);
-		glUniform1i(textureSamplerID, 0);
-
-		// Draw the cliff face
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			6,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		// set texture and draw Plateau with Texture2
-		glBindTexture(GL_TEXTURE_2D, TextureID2);
-		glUniform1i(textureSamplerID, 0);
-		glDrawElements(
-			GL_TRIANGLES,
-			6,
-			GL_UNSIGNED_INT,
-			(void*)(6 * sizeof(GLuint)));
-
-		// Render the new animated sea mesh
-		glBindTexture(GL_TEXTURE_2D, TextureID3);
-		glUniform1i(textureSamplerID, 0);
-		renderCliffSea(cameraMatrix, lightSpaceMatrix);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-	}
-
-	void renderShadow(glm::mat4 lightSpaceMatrix) {
-		glUseProgram(depthShaderID);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glUniformMatrix4fv(modelMatrixDepthID, 1, GL_FALSE, &modelMatrix[0][0]);
-		glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			12,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
-	}
-
 	void initializeCliffSea() {
-    seaVertices.clear();
-    seaIndices.clear();
-
-    // Calculate grid spacings
-    float gridSpacingOut = SEA_EXTEND_OUT / (SEA_GRID_SIZE - 1);
-    float gridSpacingSide = SEA_EXTEND_SIDE / (SEA_GRID_SIZE - 1);
-
-    // Generate vertices with higher density near cliff
-    for (int z = 0; z < SEA_GRID_SIZE; z++) {
-        for (int x = 0; x < SEA_GRID_SIZE; x++) {
-            SeaVertex vertex;
-
-            // Use exponential distribution for x-coordinates (outward from cliff)
-            float xProgress = static_cast<float>(x) / (SEA_GRID_SIZE - 1);
-            float xPos = CLIFF_BASE_X - SEA_EXTEND_OUT * (1.0f - exp(-3.0f *(1.0f - xProgress)));
-
-            // Use a wider range for z-coordinates (lateral spread)
-            float zProgress = static_cast<float>(z) / (SEA_GRID_SIZE - 1);
-            // Center the z-coordinate range around the cliff
-            float zPos = -SEA_EXTEND_SIDE/2 + zProgress * SEA_EXTEND_SIDE;
-
-            vertex.position = glm::vec3(xPos, -0.15f, zPos);
-
-            // Calculate texture coordinates with more detail near cliff
-            vertex.texCoord.x = (1.0f - xProgress) * TEXTURE_REPEAT;
-            vertex.texCoord.y = zProgress * TEXTURE_REPEAT;
-
-            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
-
-            seaVertices.push_back(vertex);
-        }
-    }
-
-    // Generate indices for triangle strips
-    for (int z = 0; z < SEA_GRID_SIZE - 1; z++) {
-        for (int x = 0; x < SEA_GRID_SIZE - 1; x++) {
-            GLuint topLeft = z * SEA_GRID_SIZE + x;
-            GLuint topRight = topLeft + 1;
-            GLuint bottomLeft = (z + 1) * SEA_GRID_SIZE + x;
-            GLuint bottomRight = bottomLeft + 1;
-
-            seaIndices.push_back(topLeft);
-            seaIndices.push_back(bottomLeft);
-            seaIndices.push_back(topRight);
-
-            seaIndices.push_back(topRight);
-            seaIndices.push_back(bottomLeft);
-            seaIndices.push_back(bottomRight);
-        }
-    }
+    generateCliffSea();
 
     // Create and set up OpenGL buffers
     glGenVertexArrays(1, &seaVAO);
@@ -2186,6 +1950,10 @@ struct world_setup {
     glGenBuffers(1, &seaEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, seaEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, seaIndices.size() * sizeof(GLuint), seaIndices.data(), GL_STATIC_DRAW);
+    seaIndexCount = static_cast<GLsizei>(seaIndices.size());
+    if (!keepCpuAssets) {
+        std::vector<uint32_t>().swap(seaIndices);
+    }
 
     // Set up vertex attributes
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SeaVertex), (void*)offsetof(SeaVertex, position));
@@ -2200,128 +1968,41 @@ struct world_setup {
     glBindVertexArray(0);
 }
 
-	void updateCliffSea(float deltaTime) {
-    seaTime += deltaTime;
-
-    for (size_t i = 0; i < seaVertices.size(); i++) {
-        SeaVertex& vertex = seaVertices[i];
-
-        // Calculate distance from cliff base for wave scaling
-        float distFromCliff = abs(vertex.position.x - CLIFF_BASE_X);
-        float waveScale = exp(-distFromCliff / 500.0f); // Waves diminish with distance
-
-        // Calculate distance from center for lateral wave scaling
-        float distFromCenter = abs(vertex.position.z);
-        float lateralScale = exp(-distFromCenter / 1000.0f); // Waves diminish with lateral distance
-
-        // Combine both scaling factors
-        float combinedScale = waveScale * (0.7f + 0.3f * lateralScale);
-
-        // Composite wave function
-        float x = vertex.position.x;
-        float z = vertex.position.z;
-        float height = 0.0f;
-
-        // Base wave formation parameters
-        const float BASE_SEA_LEVEL = -0.15f;
-        const float MAX_WAVE_HEIGHT = 0.1f;
-
-        // Function to create a shaped wave peak
-        auto createWavePeak = [](float phase, float peakWidth = 1.0f) {
-            // Create sharper peaks using power and smoothstep
-            float base = sin(phase);
-            float shaped = base * base * base * base;  // Sharpen peaks
-            return shaped * glm::smoothstep(0.0f, 1.0f, 0.5f + base * 0.5f);
-        };
-
-        // Create multiple wave groups moving at different speeds and directions
-        // Wave Group 1 - Large primary waves
-        {
-            float waveLength = 80.0f;
-            float speed = 0.4f;
-            float direction = 0.8f;  // Angle relative to cliff
-            float phase = (x * direction + z * (1.0f - direction)) / waveLength + seaTime * speed;
-            height += createWavePeak(phase) * 0.08f;
-        }
-
-        // Wave Group 2 - Medium waves at different angle
-        {
-            float waveLength = 60.0f;
-            float speed = 0.3f;
-            float direction = 0.6f;
-            float phase = (x * direction - z * (1.0f - direction)) / waveLength + seaTime * speed;
-            height += createWavePeak(phase, 1.5f) * 0.06f;
-        }
-
-        // Wave Group 3 - Smaller, faster waves
-        {
-            float waveLength = 40.0f;
-            float speed = 0.5f;
-            float direction = 0.4f;
-            float phase = (x * direction + z * (1.0f - direction)) / waveLength + seaTime * speed;
-            height += createWavePeak(phase, 2.0f) * 0.04f;
-        }
-
-        // Add subtle surface variation
-        height += sin(x * 0.05f + z * 0.05f + seaTime * 0.8f) * 0.01f;
-
-        // Apply scaling and ensure waves stay within bounds
-        height *= waveScale;
-        height = glm::clamp(height, -MAX_WAVE_HEIGHT, MAX_WAVE_HEIGHT);
-        vertex.position.y = BASE_SEA_LEVEL + height;
-
-        // Calculate wave normal based on the final wave shape
-        float heightScale = height / MAX_WAVE_HEIGHT; // Normalize height for normal calculation
-        float dx = heightScale * waveScale * 0.4f;   // Scale normal based on wave height and distance
-        float dz = heightScale * waveScale * 0.3f;
-        vertex.normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
-
-        // Scale waves based on combined distance factor
-        height *= combinedScale;
-
-        // Clamp the height to prevent waves from going above cliff base
-        height = glm::clamp(height, -MAX_WAVE_HEIGHT, MAX_WAVE_HEIGHT);
-        vertex.position.y = BASE_SEA_LEVEL + height;
-
-        // Calculate normal based on wave height gradients
-        float Dx = cos(x * 0.01f + z * 0.01f + seaTime * 0.5f) * 0.015f * combinedScale;
-        float Dz = cos(z * 0.02f + seaTime * 0.8f) * 0.02f * combinedScale;
-        vertex.normal = glm::normalize(glm::vec3(-Dx, 1.0f, -Dz));
+	// Render thread side, vertices come from the scene snapshot
+	void uploadCliffSea(const std::vector<SeaVertex>& vertices, float waveTime) {
+    if (waveTime == uploadedSeaTime) {
+        return;
     }
-
-    // Update buffer
+    uploadedSeaTime = waveTime;
     glBindBuffer(GL_ARRAY_BUFFER, seaVBO);
-    glBufferData(GL_ARRAY_BUFFER, seaVertices.size() * sizeof(SeaVertex), seaVertices.data(), GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SeaVertex), vertices.data(), GL_DYNAMIC_DRAW);
 }
 
-	void renderCliffSea(glm::mat4 cameraMatrix, glm::mat4 lightSpaceMatrix) {
-    glUseProgram(programID2);
-    glBindVertexArray(seaVAO);
-
-    glm::mat4 mvp = cameraMatrix * modelMatrix;
-    glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-    glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-
-    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-    glUniformMatrix3fv(normalMatrixID, 1, GL_FALSE, &normalMatrix[0][0]);
-    glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-    glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-    glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-    glUniform1i(shadowMapTextureID, 1);
-
-    glDrawElements(GL_TRIANGLES, seaIndices.size(), GL_UNSIGNED_INT, (void*)0);
-
-    glBindVertexArray(0);
-}
+	// The sea is never culled and, as before, does not cast shadows
+	void addToScene(Scene &scene) {
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0),
+						scene.addMaterial(TextureID), Scene::FLAG_CASTS_SHADOW);
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 6, GL_UNSIGNED_INT, 6 * sizeof(GLuint)),
+						scene.addMaterial(TextureID2), Scene::FLAG_CASTS_SHADOW);
+		scene.addEntity(modelMatrix, glm::vec4(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::infinity()),
+						scene.addMesh(seaVAO, GL_TRIANGLES, seaIndexCount, GL_UNSIGNED_INT, 0),
+						scene.addMaterial(TextureID3), 0);
+	}
 
 	void cleanup() {
 		glDeleteBuffers(1, &vertexBufferID);
+		glDeleteBuffers(1, &normalBufferID);
 		glDeleteBuffers(1, &indexBufferID);
 		glDeleteVertexArrays(1, &vertexArrayID);
 		glDeleteBuffers(1, &uvBufferID);
 		glDeleteTextures(1, &TextureID);
-		glDeleteProgram(programID2);
+		glDeleteTextures(1, &TextureID2);
+		glDeleteTextures(1, &TextureID3);
+		glDeleteBuffers(1, &seaVBO);
+		glDeleteBuffers(1, &seaEBO);
+		glDeleteVertexArrays(1, &seaVAO);
 	}
 };
 
@@ -2468,28 +2149,12 @@ struct Building {
 	GLuint vertexArrayID;
 	GLuint vertexBufferID;
 	GLuint indexBufferID;
-	GLuint colorBufferID;
 	GLuint normalBufferID;
 	GLuint uvBufferID;
 	GLuint textureID, heliTextureID;
 
-
-	// Shader variable IDs
-	GLuint mvpMatrixID;
-	GLuint textureSamplerID;
-	GLuint lightPositionID;
-	GLuint lightIntensityID;
-	GLuint lightSpaceMatrixID;
-	GLuint normalMatrixID;
-	GLuint modelMatrixID;
-	GLuint modelMatrixDepthID;
-	GLuint LSM_ID;
-	GLuint shadowMapTextureID;
-
-	GLuint programID2;
-	GLuint depthShaderID;
-
 	void initialize(glm::vec3 position, glm::vec3 scale, std::string textureLocation) {
+		GLOwnerScope owner("buildings");
 		// Define scale of the building geometry
 		this->position = position;
 		this->scale = scale;
@@ -2528,156 +2193,49 @@ struct Building {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_buffer_data), index_buffer_data, GL_STATIC_DRAW);
 
-		// Create and compile our GLSL program from the shaders
-		programID2 = LoadShadersFromString(lightingVertexShader,lightingFragmentShader );
-		if (programID2 == 0)
-		{
-			std::cerr << "lighting shaders failed to load shaders." << std::endl;
-		}
-
-		depthShaderID = LoadShadersFromString(depthVertexShader,depthFragmentShader );
-		if (depthShaderID == 0)
-		{
-			std::cerr << "Depth shaders ailed to load shaders." << std::endl;
-		}
-
-		//Light rendering shader uniforms
-		mvpMatrixID = glGetUniformLocation(programID2, "MVP");
-		lightPositionID = glGetUniformLocation(programID2, "lightPosition");
-		lightIntensityID = glGetUniformLocation(programID2, "lightIntensity");
-		modelMatrixID = glGetUniformLocation(programID2, "modelMatrix");
-		normalMatrixID = glGetUniformLocation(programID2, "normalMatrix");
-		LSM_ID = glGetUniformLocation(programID2, "lightSpaceMatrix");
-		shadowMapTextureID = glGetUniformLocation(programID2, "shadowMap");
-
-		//Depth rendering shader uniforms
-		modelMatrixDepthID = glGetUniformLocation(depthShaderID, "model");
-		lightSpaceMatrixID = glGetUniformLocation(depthShaderID, "lightSpaceMatrix");
+		Scene::bindLitAttributes(vertexBufferID, normalBufferID, uvBufferID, indexBufferID);
+		glBindVertexArray(0);
 
 		textureID = LoadTextureTileBox(textureLocation.c_str()); // Load the selected texture, assuming LoadTextureTileBox accepts std::string
 		heliTextureID = LoadTextureTileBox("../Final_Project/Textures/helicopter.png");
-
-		textureSamplerID = glGetUniformLocation(programID2,"textureSampler");
-	}
-
-	void renderWithLight(glm::mat4 cameraMatrix, glm::mat4 lightSpaceMatrix) {
-		glUseProgram(programID2);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glm::mat4 mvp = cameraMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-		glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &modelMatrix[0][0]);
-
-		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
-		glUniformMatrix3fv(normalMatrixID, 1, GL_FALSE, &normalMatrix[0][0]);
-		glUniformMatrix4fv(LSM_ID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-
-		// Set light data
-		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
-
-		glUniform1i(shadowMapTextureID, 1);
-
-
-		//Set textureSampler to use texture unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glUniform1i(textureSamplerID, 0);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			24,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glBindTexture(GL_TEXTURE_2D, heliTextureID);
-		glUniform1i(textureSamplerID, 0);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			12,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)(24 * sizeof(GLuint))          // element array buffer offset
-		);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
 	}
 
-	void renderShadow(glm::mat4 lightSpaceMatrix) {
-		glUseProgram(depthShaderID);
-
-		glBindVertexArray(vertexArrayID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		glUniformMatrix4fv(modelMatrixDepthID, 1, GL_FALSE, &modelMatrix[0][0]);
-		glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
-
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			36,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+	// Walls with the building texture, roof and floor with the helicopter pad
+	void addToScene(Scene &scene) {
+		uint8_t flags = Scene::FLAG_CASTS_SHADOW;
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 24, GL_UNSIGNED_INT, 0),
+						scene.addMaterial(textureID), flags);
+		scene.addEntity(modelMatrix, UNIT_BOX_BOUNDS,
+						scene.addMesh(vertexArrayID, GL_TRIANGLES, 12, GL_UNSIGNED_INT, 24 * sizeof(GLuint)),
+						scene.addMaterial(heliTextureID), flags);
 	}
 
 	void cleanup() {
 		glDeleteBuffers(1, &vertexBufferID);
-		glDeleteBuffers(1, &colorBufferID);
+		glDeleteBuffers(1, &normalBufferID);
 		glDeleteBuffers(1, &indexBufferID);
 		glDeleteVertexArrays(1, &vertexArrayID);
 		glDeleteBuffers(1, &uvBufferID);
 		glDeleteTextures(1, &textureID);
-		glDeleteProgram(programID2);
+		glDeleteTextures(1, &heliTextureID);
 	}
 };
 
 // FBO object used in the shadow mapping process.
 struct Lighting_Shadows {
-	GLuint FBO;
-	GLuint depthTexture;
+	GLFramebuffer FBO;
+	GLTexture depthTexture;
 	GLuint depthShader;
+
+	// Depth of the static casters, rendered once and copied into depthTexture every frame
+	// before the skinned casters are drawn in their current pose
+	GLFramebuffer staticFBO;
+	GLTexture staticDepthTexture;
+	int mapWidth = 0, mapHeight = 0;
 	GLuint lightSpaceMatrixID;
 
-	GLuint programID;
+	GLProgram programID;
 	GLuint FragPositionLightSpaceID;
 	GLuint normalMatrixID;
 	GLuint mvpMatrixID;
@@ -2690,15 +2248,16 @@ struct Lighting_Shadows {
 	// ID for shadowmap texture
 	GLuint shadowMapLocation;
 
-	GLuint simpleDepthShader;
+	GLProgram simpleDepthShader;
 
 	void initialize() {
+		GLOwnerScope owner("shadow map");
 
 		// Generate and bind the framebuffer.
-		glGenFramebuffers(1, &FBO);
+		FBO.create();
 
 		// Generate the depth texture
-		glGenTextures(1, &depthTexture);
+		depthTexture.create();
 		glBindTexture(GL_TEXTURE_2D, depthTexture);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, shadowMapWidth, shadowMapHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -2712,54 +2271,79 @@ struct Lighting_Shadows {
 
 		// Ensure framebuffer completeness
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-			std::cerr << "Error: Framebuffer is not complete!" << std::endl;
+			LOG_ERROR("Framebuffer is not complete!");
 		} else {
-			std::cout << "Framebuffer is complete!" << std::endl;
+			LOG_DEBUG("Framebuffer is complete!");
 		}
 
 		// Verify depth texture attachment
 		GLint attachedTexture;
 		glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &attachedTexture);
 		if (attachedTexture == (GLint)depthTexture) {
-			std::cout << "Depth texture is correctly attached to the framebuffer!" << std::endl;
+			LOG_DEBUG("Depth texture is correctly attached to the framebuffer!");
 		} else {
-			std::cerr << "Error: Depth texture is not correctly attached to the framebuffer!" << std::endl;
+			LOG_ERROR("Depth texture is not correctly attached to the framebuffer!");
 		}
 
 		// Disable colour buffer for this depth only FBO
 		glDrawBuffer(GL_NONE);
 		glReadBuffer(GL_NONE);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 
 		// Check if the framebuffer is complete
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-			std::cerr << "Error: Framebuffer is not complete!" << std::endl;
+			LOG_ERROR("Framebuffer is not complete!");
 		}
 
-		simpleDepthShader = LoadShadersFromString(depthVertexShader, depthFragmentShader);
+		initializeStaticDepth(shadowMapWidth, shadowMapHeight);
+
+		simpleDepthShader.reset(LoadShadersFromString(depthVertexShader, depthFragmentShader));
 
 		if (simpleDepthShader == 0)
 		{
-			std::cerr << "Failed to load shaders." << std::endl;
+			LOG_ERROR("Failed to load shaders.");
 		}
 
 		lightSpaceMatrixID = glGetUniformLocation(simpleDepthShader, "lightSpaceMatrix");
 		modelMatrixID = glGetUniformLocation(simpleDepthShader, "model");
 
 		// pass shadowMapTexture to the shader
-		programID = LoadShadersFromString(lightingVertexShader, lightingFragmentShader);
+		programID.reset(LoadShadersFromString(lightingVertexShader, lightingFragmentShader));
 
 		if(programID == 0) {
-			std::cerr << "Failed to load shaders." << std::endl;
+			LOG_ERROR("Failed to load shaders.");
+		}
+	}
+
+	// A second depth-only target of the same size and format, so it can be blitted into FBO
+	void initializeStaticDepth(int width, int height) {
+		mapWidth = width;
+		mapHeight = height;
+
+		staticDepthTexture.create();
+		glBindTexture(GL_TEXTURE_2D, staticDepthTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		staticFBO.create();
+		glBindFramebuffer(GL_FRAMEBUFFER, staticFBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, staticDepthTexture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("Static shadow framebuffer is not complete!");
 		}
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 	}
 
 	void initializeOrtho() {
+		GLOwnerScope owner("shadow map");
 		// Generate and bind the framebuffer.
-		glGenFramebuffers(1, &FBO);
+		FBO.create();
 
 		// Generate the depth texture
-		glGenTextures(1, &depthTexture);
+		depthTexture.create();
 		glBindTexture(GL_TEXTURE_2D, depthTexture);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 2048, 2048, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -2773,45 +2357,47 @@ struct Lighting_Shadows {
 
 		// Ensure framebuffer completeness
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-			std::cerr << "Error: Framebuffer is not complete!" << std::endl;
+			LOG_ERROR("Framebuffer is not complete!");
 		} else {
-			std::cout << "Framebuffer is complete!" << std::endl;
+			LOG_DEBUG("Framebuffer is complete!");
 		}
 
 		// Verify depth texture attachment
 		GLint attachedTexture;
 		glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &attachedTexture);
 		if (attachedTexture == (GLint)depthTexture) {
-			std::cout << "Depth texture is correctly attached to the framebuffer!" << std::endl;
+			LOG_DEBUG("Depth texture is correctly attached to the framebuffer!");
 		} else {
-			std::cerr << "Error: Depth texture is not correctly attached to the framebuffer!" << std::endl;
+			LOG_ERROR("Depth texture is not correctly attached to the framebuffer!");
 		}
 
 		// Disable colour buffer for this depth only FBO
 		glDrawBuffer(GL_NONE);
 		glReadBuffer(GL_NONE);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 
 		// Check if the framebuffer is complete
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-			std::cerr << "Error: Framebuffer is not complete!" << std::endl;
+			LOG_ERROR("Framebuffer is not complete!");
 		}
 
-		simpleDepthShader = LoadShadersFromString(depthVertexShader, depthFragmentShader);
+		initializeStaticDepth(2048, 2048);
+
+		simpleDepthShader.reset(LoadShadersFromString(depthVertexShader, depthFragmentShader));
 
 		if (simpleDepthShader == 0)
 		{
-			std::cerr << "Failed to load shaders." << std::endl;
+			LOG_ERROR("Failed to load shaders.");
 		}
 
 		lightSpaceMatrixID = glGetUniformLocation(simpleDepthShader, "lightSpaceMatrix");
 		modelMatrixID = glGetUniformLocation(simpleDepthShader, "model");
 
 		// pass shadowMapTexture to the shader
-		programID = LoadShadersFromString(lightingVertexShader, lightingFragmentShader);
+		programID.reset(LoadShadersFromString(lightingVertexShader, lightingFragmentShader));
 
 		if(programID == 0) {
-			std::cerr << "Failed to load shaders." << std::endl;
+			LOG_ERROR("Failed to load shaders.");
 		}
 
 		shadowMapLocation = glGetUniformLocation(programID, "shadowMap");
@@ -2830,6 +2416,29 @@ struct Lighting_Shadows {
 		glEnable(GL_DEPTH_TEST);
 	}
 
+	// Static casters drawn after this land in the static depth, once
+	void beginStaticPass() {
+		glBindFramebuffer(GL_FRAMEBUFFER, staticFBO);
+		glViewport(0, 0, mapWidth, mapHeight);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	// Restores the static depth into the shadow map, moving casters drawn after this go on top
+	void beginDynamicPass() {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+		glBlitFramebuffer(0, 0, mapWidth, mapHeight, 0, 0, mapWidth, mapHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glViewport(0, 0, mapWidth, mapHeight);
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	void endPass() {
+		glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+		glViewport(0, 0, windowWidth, windowHeight);
+	}
+
 	// Render scene as normal with shadow mapping (using depth map)
 	void lightingMapPass(glm::mat4 cameraMatrix) {
 		float near_plane = 1.0f, far_plane = 500.5f;
@@ -2859,544 +2468,310 @@ struct Lighting_Shadows {
 		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
 		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
 	}
+
+	void cleanup() {
+		FBO.reset();
+		depthTexture.reset();
+		staticFBO.reset();
+		staticDepthTexture.reset();
+		simpleDepthShader.reset();
+		programID.reset();
+	}
 };
 
-// glTF parser and animator similar to lab 4 used to take gltf files and render them in the scene.
-struct MyBot {
-	// Shader variable IDs
-	GLuint mvpMatrixID;
-	GLuint jointMatricesID;
-	GLuint lightPositionID;
-	GLuint lightIntensityID;
-	GLuint programID;
-	glm::vec3 position;
-	glm::vec3 scale;
+// Colour and depth attachments headless frames are drawn into, nothing is presented
+struct OffscreenTarget {
+	GLFramebuffer framebufferID;
+	GLRenderbuffer colorBufferID;
+	GLRenderbuffer depthBufferID;
 
-	const int MAX_JOINTS = 128;  // Maximum number of joints supported
+	bool initialize(int width, int height) {
+		GLOwnerScope owner("offscreen target");
+		framebufferID.create();
+		glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
 
-	tinygltf::Model model;
+		colorBufferID.create();
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBufferID);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBufferID);
 
-	// Each VAO corresponds to each mesh primitive in the GLTF model
-	struct PrimitiveObject {
-		GLuint vao;
-		std::map<int, GLuint> vbos;
-	};
-	std::vector<PrimitiveObject> primitiveObjects;
-
-	// Skinning
-	struct SkinObject {
-		// Transforms the geometry into the space of the respective joint
-		std::vector<glm::mat4> inverseBindMatrices;
-
-		// Transforms the geometry following the movement of the joints
-		std::vector<glm::mat4> globalJointTransforms;
-
-		// Combined transforms
-		std::vector<glm::mat4> jointMatrices;
-	};
-	std::vector<SkinObject> skinObjects;
+		depthBufferID.create();
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBufferID);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBufferID);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
-	// Animation
-	struct SamplerObject {
-		std::vector<float> input;
-		std::vector<glm::vec4> output;
-		int interpolation;
-	};
-	struct ChannelObject {
-		int sampler;
-		std::string targetPath;
-		int targetNode;
-	};
-	struct AnimationObject {
-		std::vector<SamplerObject> samplers;	// Animation data
-	};
-	std::vector<AnimationObject> animationObjects;
-
-	glm::mat4 getNodeTransform(const tinygltf::Node& node) {
-		glm::mat4 transform(1.0f);
-
-		if (node.matrix.size() == 16) {
-			transform = glm::make_mat4(node.matrix.data());
-		} else {
-			if (node.translation.size() == 3) {
-				transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
-			}
-			if (node.rotation.size() == 4) {
-				glm::quat q(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
-				transform *= glm::mat4_cast(q);
-			}
-			if (node.scale.size() == 3) {
-				transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
-			}
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG_ERROR("Offscreen framebuffer is not complete.");
+			return false;
 		}
-		return transform;
+		glViewport(0, 0, width, height);
+		return true;
 	}
 
-	void computeLocalNodeTransform(const tinygltf::Model& model,
-		int nodeIndex,
-		std::vector<glm::mat4> &localTransforms)
-	{
-		const tinygltf::Node& node = model.nodes[nodeIndex];
-
-		glm::mat4 localTransform = glm::mat4(1.0f); // Start with the identity matrix
-
-		// Step 1: Check for the `matrix` property
-		if (!node.matrix.empty()) {
-			// Use the provided matrix directly if it exists
-			localTransform = glm::make_mat4(node.matrix.data());
-		} else {
-			// Step 2: Apply translation, rotation, and scale
-			glm::vec3 translation(0.0f);
-			glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
-			glm::vec3 scale(1.0f);
-
-			if (!node.translation.empty()) {
-				translation = glm::vec3(node.translation[0], node.translation[1], node.translation[2]);
-			}
-
-			if (!node.rotation.empty()) {
-				rotation = glm::quat(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
-			}
-
-			if (!node.scale.empty()) {
-				scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
-			}
-
-			// Step 3: Combine translation, rotation, and scale into a single transform
-			localTransform = glm::translate(glm::mat4(1.0f), translation) *
-							 glm::mat4_cast(rotation) *
-							 glm::scale(glm::mat4(1.0f), scale);
-		}
-
-		// Step 4: Store the computed local transform
-		localTransforms[nodeIndex] = localTransform;
+	void cleanup() {
+		framebufferID.reset();
+		colorBufferID.reset();
+		depthBufferID.reset();
 	}
+};
 
+// Ring of joint palettes in a single uniform buffer. Each palette stores the top three rows of every
+// joint matrix (a mat3x4 in the shader, 48 bytes instead of 64) and is bound per draw with glBindBufferRange.
+// The buffer is orphaned when the ring wraps, so writes never wait on draws still reading older palettes.
+struct JointPaletteRing {
+	static const GLuint BINDING = 0;        // Uniform block binding point of the JointPalette block
+	static const int MAX_JOINTS = BotAnimation::MAX_PALETTE_JOINTS;
+	static const int SLOTS = 64;            // Palettes written before the buffer is orphaned
 
-	void computeGlobalNodeTransform(const tinygltf::Model& model,
-		const std::vector<glm::mat4> &localTransforms,
-		int nodeIndex, const glm::mat4& parentTransform,
-		std::vector<glm::mat4> &globalTransforms)
-	{
-		if (nodeIndex < 0 || nodeIndex >= model.nodes.size() ||
-			nodeIndex >= localTransforms.size() ||
-			nodeIndex >= globalTransforms.size()) {
-			return; // Or handle error appropriately
-			}
-
-		// Step 1: Compute the global transform for the current node
-		glm::mat4 globalTransform = parentTransform * localTransforms[nodeIndex];
-		globalTransforms[nodeIndex] = globalTransform;
+	GLuint bufferID = 0;
+	GLsizeiptr paletteSize = 0;             // Bytes of one palette, rounded up to the offset alignment
+	GLsizeiptr capacity = 0;
+	GLintptr head = 0;
 
-		// Step 2: Iterate over the children of the current node
-		const tinygltf::Node& node = model.nodes[nodeIndex];
-		for (int childIndex : node.children) {
-			// Recursively compute global transforms for child nodes
-			computeGlobalNodeTransform(model, localTransforms, childIndex, globalTransform, globalTransforms);
-		}
+	void initialize() {
+		GLOwnerScope owner("joint palettes");
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+		GLsizeiptr blockSize = MAX_JOINTS * 3 * sizeof(glm::vec4);
+		paletteSize = ((blockSize + alignment - 1) / alignment) * alignment;
+		capacity = paletteSize * SLOTS;
+
+		glGenBuffers(1, &bufferID);
+		glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+		glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
 
-	std::vector<SkinObject> prepareSkinning(const tinygltf::Model &model) {
-		std::vector<SkinObject> skinObjects;
-
-		// In our Blender exporter, the default number of joints that may influence a vertex is set to 4, just for convenient implementation in shaders.
-
-		for (size_t i = 0; i < model.skins.size(); i++) {
-			SkinObject skinObject;
-
-			const tinygltf::Skin &skin = model.skins[i];
-
-			// Read inverseBindMatrices
-			const tinygltf::Accessor &accessor = model.accessors[skin.inverseBindMatrices];
-			assert(accessor.type == TINYGLTF_TYPE_MAT4);
-			const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-			const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-			const float *ptr = reinterpret_cast<const float *>(
-            	buffer.data.data() + accessor.byteOffset + bufferView.byteOffset);
-
-			skinObject.inverseBindMatrices.resize(accessor.count);
-			for (size_t j = 0; j < accessor.count; j++) {
-				float m[16];
-				memcpy(m, ptr + j * 16, 16 * sizeof(float));
-				skinObject.inverseBindMatrices[j] = glm::make_mat4(m);
-			}
-
-			assert(skin.joints.size() == accessor.count);
-
-			skinObject.globalJointTransforms.resize(skin.joints.size());
-			skinObject.jointMatrices.resize(skin.joints.size());
-
-			// ----------------------------------------------
-			// TODO: your code here to compute joint matrices
-			// Initialize local transforms for all nodes
-			std::vector<glm::mat4> localTransforms(model.nodes.size(), glm::mat4(1.0f));
-
-			// Compute local transforms for joints
-			for (int jointIndex : skin.joints) {
-				computeLocalNodeTransform(model, jointIndex, localTransforms);
-			}
-
-			// Initialize joint matrices for bind pose
-			for (size_t j = 0; j < skin.joints.size(); j++) {
-				int jointIndex = skin.joints[j];
-				skinObject.globalJointTransforms[j] = localTransforms[jointIndex];
-				skinObject.jointMatrices[j] = skinObject.globalJointTransforms[j] * skinObject.inverseBindMatrices[j];
-			}
-			// ----------------------------------------------
-			skinObjects.push_back(skinObject);
+	// Connect a program's JointPalette block to the ring's binding point
+	static void bindProgram(GLuint programID) {
+		GLuint blockIndex = glGetUniformBlockIndex(programID, "JointPalette");
+		if (blockIndex == GL_INVALID_INDEX) {
+			LOG_ERROR("JointPalette uniform block not found in program %u", programID);
+			return;
 		}
-		return skinObjects;
+		glUniformBlockBinding(programID, blockIndex, BINDING);
 	}
 
-	int findKeyframeIndex(const std::vector<float>& times, float animationTime)
-	{
-		int left = 0;
-		int right = times.size() - 1;
-
-		while (left <= right) {
-			int mid = (left + right) / 2;
-
-			if (mid + 1 < times.size() && times[mid] <= animationTime && animationTime < times[mid + 1]) {
-				return mid;
-			}
-			else if (times[mid] > animationTime) {
-				right = mid - 1;
-			}
-			else { // animationTime >= times[mid + 1]
-				left = mid + 1;
-			}
+	// Write a palette into the next slot and return its offset for bind()
+	GLintptr upload(const std::vector<glm::mat4>& jointMatrices) {
+		if (head + paletteSize > capacity) {
+			// Orphan the storage; the driver hands us fresh memory while older draws finish
+			glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+			glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+			head = 0;
 		}
 
-		// Target not found
-		return times.size() - 2;
-	}
-
-	std::vector<AnimationObject> prepareAnimation(const tinygltf::Model &model)
-	{
-		std::vector<AnimationObject> animationObjects;
-		for (const auto &anim : model.animations) {
-			AnimationObject animationObject;
-
-			for (const auto &sampler : anim.samplers) {
-				SamplerObject samplerObject;
-
-				const tinygltf::Accessor &inputAccessor = model.accessors[sampler.input];
-				const tinygltf::BufferView &inputBufferView = model.bufferViews[inputAccessor.bufferView];
-				const tinygltf::Buffer &inputBuffer = model.buffers[inputBufferView.buffer];
-
-				assert(inputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-				assert(inputAccessor.type == TINYGLTF_TYPE_SCALAR);
-
-				// Input (time) values
-				samplerObject.input.resize(inputAccessor.count);
-
-				const unsigned char *inputPtr = &inputBuffer.data[inputBufferView.byteOffset + inputAccessor.byteOffset];
-				const float *inputBuf = reinterpret_cast<const float*>(inputPtr);
-
-				// Read input (time) values
-				int stride = inputAccessor.ByteStride(inputBufferView);
-				for (size_t i = 0; i < inputAccessor.count; ++i) {
-					samplerObject.input[i] = *reinterpret_cast<const float*>(inputPtr + i * stride);
-				}
-
-				const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
-				const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
-				const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
-
-				assert(outputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-
-				const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
-				const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
-
-				int outputStride = outputAccessor.ByteStride(outputBufferView);
-
-				// Output values
-				samplerObject.output.resize(outputAccessor.count);
-
-				for (size_t i = 0; i < outputAccessor.count; ++i) {
-
-					if (outputAccessor.type == TINYGLTF_TYPE_VEC3) {
-						memcpy(&samplerObject.output[i], outputPtr + i * 3 * sizeof(float), 3 * sizeof(float));
-					} else if (outputAccessor.type == TINYGLTF_TYPE_VEC4) {
-						memcpy(&samplerObject.output[i], outputPtr + i * 4 * sizeof(float), 4 * sizeof(float));
-					} else {
-						std::cout << "Unsupport accessor type ..." << std::endl;
-					}
-
-				}
+		GLintptr offset = head;
+		head += paletteSize;
 
-				animationObject.samplers.push_back(samplerObject);
-			}
-
-			animationObjects.push_back(animationObject);
+		size_t numJoints = std::min(jointMatrices.size(), static_cast<size_t>(MAX_JOINTS));
+		if (numJoints == 0) {
+			return offset;
 		}
-		return animationObjects;
-	}
-
-	void updateAnimation(
-		const tinygltf::Model &model,
-		const tinygltf::Animation &anim,
-		const AnimationObject &animationObject,
-		float time,
-		std::vector<glm::mat4> &nodeTransforms)
-	{
-		// There are many channels so we have to accumulate the transforms
-		for (const auto &channel : anim.channels) {
-
-			int targetNodeIndex = channel.target_node;
-			const auto &sampler = anim.samplers[channel.sampler];
-
-			// Access output (value) data for the channel
-			const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
-			const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
-			const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
-
-			// Calculate current animation time (wrap if necessary)
-			const std::vector<float> &times = animationObject.samplers[channel.sampler].input;
-			float animationTime = fmod(time, times.back());
-			int keyframeIndex = findKeyframeIndex(times, animationTime);
-
-			const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
-			const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
-			int nextKeyframeIndex = keyframeIndex + 1;
-
-			// Get the previous and next keyframe times
-			float previousTime = times[keyframeIndex];
-			float nextTime = times[nextKeyframeIndex];
-			float t = (animationTime - previousTime) / (nextTime - previousTime);
-
-
-			if (channel.target_path == "translation") {
-				glm::vec3 translation0, translation1;
-				memcpy(&translation0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-				memcpy(&translation1, outputPtr + nextKeyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-				glm::vec3 translation;
-				if (sampler.interpolation == "LINEAR") {
-					// Perform linear interpolation
-					translation = glm::mix(translation0, translation1, t);
-				} else if (sampler.interpolation == "STEP") {
-					// Use the current keyframe's value
-					translation = translation0;
-				}
-				else {
-					std::cout << "Unsupport interpolation type ..." << std::endl;
-				}
-
-				nodeTransforms[targetNodeIndex] = glm::translate(nodeTransforms[targetNodeIndex], translation);
-			} else if (channel.target_path == "rotation") {
-				glm::quat rotation0, rotation1;
-				memcpy(&rotation0, outputPtr + keyframeIndex * 4 * sizeof(float), 4 * sizeof(float));
-				memcpy(&rotation1, outputPtr + nextKeyframeIndex * 4 * sizeof(float), 4 * sizeof(float));
-				glm::quat rotation;
-				if (sampler.interpolation == "LINEAR") {
-					// Perform spherical linear interpolation (slerp) for smooth rotation
-					rotation = glm::slerp(rotation0, rotation1, t);
-				}
-				else if (sampler.interpolation == "STEP") {
-					rotation = rotation0;
-				}
-				else {
-					std::cout << "Unsupport interpolation type ..." << std::endl;
-					return;
-				}
-
-				nodeTransforms[targetNodeIndex] *= glm::mat4_cast(rotation);
-			} else if (channel.target_path == "scale") {
-				glm::vec3 scale0, scale1;
-				memcpy(&scale0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-				memcpy(&scale1, outputPtr + nextKeyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
-				glm::vec3 scale;
-				if (sampler.interpolation == "LINEAR") {
-					// Perform linear interpolation for smooth scaling transitions
-					scale = glm::mix(scale0, scale1, t);
-				}
 
-				else if (sampler.interpolation == "STEP") {
-					scale = scale0;
-				}
-				else {
-					std::cout << "Unsupported interpolation type ..." << std::endl;
-					return;
-				}
-				nodeTransforms[targetNodeIndex] = glm::scale(nodeTransforms[targetNodeIndex], scale);
-			}
+		glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+		GLsizeiptr writeSize = numJoints * 3 * sizeof(glm::vec4);
+		glm::vec4* rows = static_cast<glm::vec4*>(glMapBufferRange(GL_UNIFORM_BUFFER, offset, writeSize,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if (rows) {
+			BotAnimation::packJointPalette(jointMatrices, numJoints, rows);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
 		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		return offset;
 	}
 
-	void updateSkinning(const tinygltf::Model &model, const std::vector<glm::mat4> &nodeTransforms) {
-		for (size_t skinIndex = 0; skinIndex < skinObjects.size(); ++skinIndex) {
-			SkinObject &skinObject = skinObjects[skinIndex];
-			const tinygltf::Skin &skin = model.skins[skinIndex]; // Access the corresponding skin
-
-			size_t numJoints = skin.joints.size();
-			skinObject.jointMatrices.resize(numJoints);
-
-			for (size_t i = 0; i < numJoints; ++i) {
-				int jointIndex = skin.joints[i];
-
-				// Validate joint index
-				if (jointIndex < 0 || jointIndex >= static_cast<int>(nodeTransforms.size())) {
-					std::cerr << "Invalid joint index: " << jointIndex << std::endl;
-					continue;
-				}
-
-				// Populate globalJointTransforms using nodeTransforms
-				skinObject.globalJointTransforms[i] = nodeTransforms[jointIndex];
-
-				// Combine with the inverse bind matrix to compute joint matrix
-				skinObject.jointMatrices[i] =
-					skinObject.globalJointTransforms[i] *
-					skinObject.inverseBindMatrices[i];
-			}
-		}
+	void bind(GLintptr offset) const {
+		glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, bufferID, offset, MAX_JOINTS * 3 * sizeof(glm::vec4));
 	}
 
-
-	std::vector<int> computeNodeParents(const tinygltf::Model& model) {
-		std::vector<int> nodeParents(model.nodes.size(), -1); // Initialize with -1 (root nodes)
-
-		for (size_t i = 0; i < model.nodes.size(); ++i) {
-			const tinygltf::Node& node = model.nodes[i];
-			for (int childIndex : node.children) {
-				nodeParents[childIndex] = i; // Set the parent of the child
-			}
-		}
-
-		return nodeParents;
+	void cleanup() {
+		glDeleteBuffers(1, &bufferID);
 	}
+};
+static JointPaletteRing jointPaletteRing;
 
-// Complete skeletal animation update function with missing edge cases handled
-void update(float time) {
-    // Early return if no animations or models exist
-    if (model.animations.empty() || model.skins.empty()) {
-        return;
-    }
+// glTF parser and animator similar to lab 4 used to take gltf files and render them in the scene.
+struct MyBot : BotAnimation {
+	// Shader variable IDs
+	GLuint mvpMatrixID;
+	GLuint lightPositionID;
+	GLuint lightIntensityID;
+	GLuint programID;
+	GLuint skinningProgramID;
+	GLuint depthShaderID;
+	GLuint modelMatrixDepthID;
+	GLuint lightSpaceMatrixID;
+	glm::mat4 modelMatrix;		// Cached, only rebuilt by setTransform()
 
-    // Handle animation and skin data
-    const tinygltf::Animation& animation = model.animations[0];
-    const AnimationObject& animationObject = animationObjects[0];
-    const tinygltf::Skin& skin = model.skins[0];
+	// Offset of this frame's joint palette in jointPaletteRing
+	GLintptr jointPaletteOffset = 0;
 
-    // Step 1: Initialize and compute local transforms for all nodes
-    std::vector<glm::mat4> nodeTransforms(model.nodes.size(), glm::mat4(1.0f));
-    updateAnimation(model, animation, animationObject, time, nodeTransforms);
+	// Only used to upload the model, animation reads animationData. Buffers held in the .glb or .bin
+	// files are mapped instead of copied into it and unmapped after upload. Set this before
+	// initialize() to have tinygltf load every buffer and image into the model and keep them.
+	tinygltf::Model model;
+	bool keepCpuModel = false;
 
-    // Step 2: Compute parent relationships once
-    std::vector<int> nodeParents = computeNodeParents(model);
+	// Each VAO corresponds to each mesh primitive in the GLTF model
+	struct PrimitiveObject {
+		GLuint vao;
 
-    // Step 3: Process each skin object
-    for (SkinObject& skinObject : skinObjects) {
-        const size_t numJoints = skin.joints.size();
+		// Skinned positions and normals written by transform feedback, drawn as a static mesh
+		GLuint skinnedVAO;
+		GLuint skinnedVBO;
+		GLsizei vertexCount;
+		GLuint indexBufferID;
+	};
+	std::vector<PrimitiveObject> primitiveObjects;
 
-        // Validate joint data
-        if (skinObject.globalJointTransforms.size() != numJoints ||
-            skinObject.inverseBindMatrices.size() != numJoints) {
-            // Handle error or resize vectors
-            skinObject.globalJointTransforms.resize(numJoints);
-            skinObject.inverseBindMatrices.resize(numJoints);
-        }
+	// Crowd instances draw from another bot's programs, buffers and source VAOs and must not delete them
+	bool sharesResources = false;
 
-        // Compute global transforms using parent hierarchy
-        for (size_t i = 0; i < numJoints; ++i) {
-            const int jointIndex = skin.joints[i];
-
-            // Validate joint index
-            if (jointIndex < 0 || jointIndex >= static_cast<int>(model.nodes.size())) {
-                continue;  // Skip invalid joint
-            }
-
-            const int parentIndex = nodeParents[jointIndex];
-
-            if (parentIndex == -1) {
-                skinObject.globalJointTransforms[i] = nodeTransforms[jointIndex];
-            } else {
-                // Find parent's transform index in the joints array
-                int parentTransformIndex = -1;
-                for (size_t j = 0; j < numJoints; ++j) {
-                    if (skin.joints[j] == parentIndex) {
-                        parentTransformIndex = j;
-                        break;
-                    }
-                }
-
-                if (parentTransformIndex != -1) {
-                    skinObject.globalJointTransforms[i] =
-                        skinObject.globalJointTransforms[parentTransformIndex] *
-                        nodeTransforms[jointIndex];
-                } else {
-                    // Parent isn't in joint list, use local transform
-                    skinObject.globalJointTransforms[i] = nodeTransforms[jointIndex];
-                }
-            }
-        }
+	// One GPU buffer per glTF bufferView (0 where the view is not vertex or index data),
+	// created once per model and shared by the VAOs of every primitive
+	std::vector<GLuint> bufferViewVBOs;
 
-        // Step 4: Compute final joint matrices for GPU skinning
-        skinObject.jointMatrices.resize(numJoints);
-        for (size_t i = 0; i < numJoints; ++i) {
-            skinObject.jointMatrices[i] =
-                skinObject.globalJointTransforms[i] *
-                skinObject.inverseBindMatrices[i];
-        }
-    }
-}
+	// Flattened at load time so a draw is a bind and a glDrawElements, in scene order.
+	// nodeIndex refers to the node owning the mesh, skinned meshes ignore its transform.
+	struct DrawRecord {
+		GLuint vao;
+		GLenum mode;
+		GLsizei count;
+		GLenum indexType;
+		size_t indexOffset;
+		int nodeIndex;
+	};
+	std::vector<DrawRecord> drawRecords;
 
-	bool loadModel(tinygltf::Model &model, const char *filename) {
-		tinygltf::TinyGLTF loader;
+	// With mapBuffers the BIN chunk and external .bin files stay in the page cache and buffers points
+	// at them until buffers.release(), tinygltf only parses the JSON
+	bool loadModel(tinygltf::Model &model, GltfBuffers &buffers, const char *filename, bool mapBuffers) {
 		std::string err;
 		std::string warn;
 
-		bool res = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+		auto loadStart = std::chrono::steady_clock::now();
+		bool res = loadGltf(model, buffers, filename, mapBuffers, err, warn);
 		if (!warn.empty()) {
-			std::cout << "WARN: " << warn << std::endl;
+			LOG_WARN("%s", warn.c_str());
 		}
 
 		if (!err.empty()) {
-			std::cout << "ERR: " << err << std::endl;
+			LOG_ERROR("%s", err.c_str());
 		}
 
 		if (!res)
-			std::cout << "Failed to load glTF: " << filename << std::endl;
+			LOG_ERROR("Failed to load glTF: %s", filename);
 		else
-			std::cout << "Loaded glTF: " << filename << std::endl;
+			LOG_INFO("Loaded glTF: %s in %.1f ms, peak RSS %.1f MiB", filename,
+					 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count(),
+					 peakResidentMiB());
 
 		return res;
 	}
 
-	void initialize(glm::vec3 position, glm::vec3 scale) {
+	// Not synchronised with the simulation thread, move characters before it starts or from it
+	void setTransform(glm::vec3 position, glm::vec3 scale) {
 		this->position = position;
 		this->scale = scale;
+		modelMatrix = glm::mat4(1.0f);
+		modelMatrix = glm::translate(modelMatrix, position);
+		modelMatrix = glm::scale(modelMatrix, scale);
+	}
+
+	void initialize(glm::vec3 position, glm::vec3 scale) {
+		GLOwnerScope owner("bots");
+		setTransform(position, scale);
 		// Modify your path if needed
-		if (!loadModel(model, "../Final_Project/model/bot/bot.gltf")) {
+		GltfBuffers buffers;
+		if (!loadModel(model, buffers, modelPath.c_str(), !keepCpuModel && !keepCpuAssets)) {
 			return;
 		}
 
 		// Prepare buffers for rendering
-		primitiveObjects = bindModel(model);
+		primitiveObjects = bindModel(model, buffers);
 
-		// Prepare joint matrices
-		skinObjects = prepareSkinning(model);
+		prepareAnimationData(model, buffers);
 
-		// Prepare animation data
-		animationObjects = prepareAnimation(model);
+		// Everything read from the buffers is on the GPU or in animationData, drop the mapped pages
+		buffers.release();
 
 		// Create and compile our GLSL program from the shaders
-		programID = LoadShadersFromString(animationVertexShader, animationFragmentShader);
+		programID = LoadShadersFromString(skinnedMeshVertexShader, animationFragmentShader);
 		if (programID == 0)
 		{
-			std::cerr << "Failed to load shaders." << std::endl;
+			LOG_ERROR("Failed to load shaders.");
 		}
 
+		const char *skinningVaryings[] = { "skinnedPosition", "skinnedNormal" };
+		skinningProgramID = LoadTransformFeedbackShaderFromString(skinningVertexShader, skinningVaryings, 2);
+		if (skinningProgramID == 0)
+		{
+			LOG_ERROR("Failed to load skinning shader.");
+		}
+		JointPaletteRing::bindProgram(skinningProgramID);
+
+		depthShaderID = LoadShadersFromString(depthVertexShader, depthFragmentShader);
+		if (depthShaderID == 0)
+		{
+			LOG_ERROR("Depth shaders failed to load shaders.");
+		}
+		modelMatrixDepthID = glGetUniformLocation(depthShaderID, "model");
+		lightSpaceMatrixID = glGetUniformLocation(depthShaderID, "lightSpaceMatrix");
+
 		// Get a handle for GLSL variables
 		mvpMatrixID = glGetUniformLocation(programID, "MVP");
 		lightPositionID = glGetUniformLocation(programID, "lightPosition");
 		lightIntensityID = glGetUniformLocation(programID, "lightIntensity");
-		jointMatricesID = glGetUniformLocation(programID, "jointMatrices");
+
+		if (!keepCpuModel && !keepCpuAssets) {
+			releaseModelData();
+		}
 	}
 
-	void bindMesh(std::vector<PrimitiveObject> &primitiveObjects,
-				tinygltf::Model &model, tinygltf::Mesh &mesh) {
+	// Everything read from buffers has been uploaded or copied into animationData
+	void releaseModelData() {
+		std::vector<tinygltf::Buffer>().swap(model.buffers);
+		std::vector<tinygltf::Image>().swap(model.images);
+	}
+
+	// GL half, shares the source's programs, vertex buffers and source VAOs. Only the skinning
+	// output is per instance, since every instance has its own pose.
+	void uploadInstance(const MyBot &source) {
+		GLOwnerScope owner("crowd");
+		sharesResources = true;
+		programID = source.programID;
+		skinningProgramID = source.skinningProgramID;
+		depthShaderID = source.depthShaderID;
+		mvpMatrixID = source.mvpMatrixID;
+		lightPositionID = source.lightPositionID;
+		lightIntensityID = source.lightIntensityID;
+		modelMatrixDepthID = source.modelMatrixDepthID;
+		lightSpaceMatrixID = source.lightSpaceMatrixID;
+
+		primitiveObjects = source.primitiveObjects;
+		drawRecords = source.drawRecords;
+		for (size_t i = 0; i < primitiveObjects.size(); ++i) {
+			createSkinnedTarget(primitiveObjects[i]);
+			drawRecords[i].vao = primitiveObjects[i].skinnedVAO;
+		}
+	}
 
-		std::map<int, GLuint> vbos;
+	size_t residentBytes() const {
+		size_t bytes = BotAnimation::residentBytes();
+		for (const tinygltf::Buffer &buffer : model.buffers) {
+			bytes += ::residentBytes(buffer.data);
+		}
+		for (const tinygltf::Image &image : model.images) {
+			bytes += ::residentBytes(image.image);
+		}
+		return bytes;
+	}
+
+	void bindBufferViews(tinygltf::Model &model, const GltfBuffers &buffers) {
+		bufferViewVBOs.assign(model.bufferViews.size(), 0);
 		for (size_t i = 0; i < model.bufferViews.size(); ++i) {
 			const tinygltf::BufferView &bufferView = model.bufferViews[i];
 
@@ -3406,26 +2781,29 @@ void update(float time) {
 				// The bufferView with target == 0 in our model refers to
 				// the skinning weights, for 25 joints, each 4x4 matrix (16 floats), totaling to 400 floats or 1600 bytes.
 				// So it is considered safe to skip the warning.
-				//std::cout << "WARN: bufferView.target is zero" << std::endl;
+				//LOG_WARN("bufferView.target is zero");
 				continue;
 			}
 
-			const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+			// Straight from the mapped file when the buffer was mapped, the driver copies it
 			GLuint vbo;
 			glGenBuffers(1, &vbo);
 			glBindBuffer(target, vbo);
-			glBufferData(target, bufferView.byteLength,
-						&buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
+			glBufferData(target, bufferView.byteLength, buffers.view(model, static_cast<int>(i)), GL_STATIC_DRAW);
 
-			vbos[i] = vbo;
+			bufferViewVBOs[i] = vbo;
 		}
+	}
+
+	void bindMesh(std::vector<PrimitiveObject> &primitiveObjects,
+				tinygltf::Model &model, tinygltf::Mesh &mesh, int nodeIndex) {
 
 		// Each mesh can contain several primitives (or parts), each we need to
 		// bind to an OpenGL vertex array object
 		for (size_t i = 0; i < mesh.primitives.size(); ++i) {
 
-			tinygltf::Primitive primitive = mesh.primitives[i];
-			tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
+			const tinygltf::Primitive &primitive = mesh.primitives[i];
+			const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
 
 			GLuint vao;
 			glGenVertexArrays(1, &vao);
@@ -3435,7 +2813,7 @@ void update(float time) {
 				tinygltf::Accessor accessor = model.accessors[attrib.second];
 				int byteStride =
 					accessor.ByteStride(model.bufferViews[accessor.bufferView]);
-				glBindBuffer(GL_ARRAY_BUFFER, vbos[accessor.bufferView]);
+				glBindBuffer(GL_ARRAY_BUFFER, bufferViewVBOs[accessor.bufferView]);
 
 				int size = 1;
 				if (accessor.type != TINYGLTF_TYPE_SCALAR) {
@@ -3454,137 +2832,563 @@ void update(float time) {
 										accessor.normalized ? GL_TRUE : GL_FALSE,
 										byteStride, BUFFER_OFFSET(accessor.byteOffset));
 				} else {
-					std::cout << "vaa missing: " << attrib.first << std::endl;
+					LOG_WARN("vaa missing: %s", attrib.first.c_str());
 				}
 			}
 
+			GLsizei vertexCount = 0;
+			auto positionAttrib = primitive.attributes.find("POSITION");
+			if (positionAttrib != primitive.attributes.end()) {
+				vertexCount = static_cast<GLsizei>(model.accessors[positionAttrib->second].count);
+			}
+
 			// Record VAO for later use
 			PrimitiveObject primitiveObject;
 			primitiveObject.vao = vao;
-			primitiveObject.vbos = vbos;
+			primitiveObject.vertexCount = vertexCount;
+			primitiveObject.indexBufferID = bufferViewVBOs[indexAccessor.bufferView];
+			createSkinnedTarget(primitiveObject);
+
+			DrawRecord drawRecord;
+			drawRecord.vao = primitiveObject.skinnedVAO;
+			drawRecord.mode = primitive.mode;
+			drawRecord.count = static_cast<GLsizei>(indexAccessor.count);
+			drawRecord.indexType = indexAccessor.componentType;
+			drawRecord.indexOffset = indexAccessor.byteOffset;
+			drawRecord.nodeIndex = nodeIndex;
+			drawRecords.push_back(drawRecord);
 			primitiveObjects.push_back(primitiveObject);
 
 			glBindVertexArray(0);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 		}
 	}
 
+	// Output buffer of the skinning stage and the VAO drawing it: interleaved position and normal
+	// per vertex, indexed by the primitive's index buffer
+	void createSkinnedTarget(PrimitiveObject &primitiveObject) {
+		glGenVertexArrays(1, &primitiveObject.skinnedVAO);
+		glBindVertexArray(primitiveObject.skinnedVAO);
+
+		glGenBuffers(1, &primitiveObject.skinnedVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, primitiveObject.skinnedVBO);
+		glBufferData(GL_ARRAY_BUFFER, primitiveObject.vertexCount * 6 * sizeof(GLfloat), NULL, GL_DYNAMIC_COPY);
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+		// The index buffer is part of the VAO state, drawing needs no further binds
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitiveObject.indexBufferID);
+		glBindVertexArray(0);
+	}
+
 	void bindModelNodes(std::vector<PrimitiveObject> &primitiveObjects,
 						tinygltf::Model &model,
-						tinygltf::Node &node) {
+						int nodeIndex) {
+		tinygltf::Node &node = model.nodes[nodeIndex];
 		// Bind buffers for the current mesh at the node
 		if ((node.mesh >= 0) && (node.mesh < model.meshes.size())) {
-			bindMesh(primitiveObjects, model, model.meshes[node.mesh]);
+			bindMesh(primitiveObjects, model, model.meshes[node.mesh], nodeIndex);
 		}
 
 		// Recursive into children nodes
 		for (size_t i = 0; i < node.children.size(); i++) {
 			assert((node.children[i] >= 0) && (node.children[i] < model.nodes.size()));
-			bindModelNodes(primitiveObjects, model, model.nodes[node.children[i]]);
+			bindModelNodes(primitiveObjects, model, node.children[i]);
 		}
 	}
 
-	std::vector<PrimitiveObject> bindModel(tinygltf::Model &model) {
+	std::vector<PrimitiveObject> bindModel(tinygltf::Model &model, const GltfBuffers &buffers) {
 		std::vector<PrimitiveObject> primitiveObjects;
 
+		// Upload the buffer views once, every mesh references them
+		bindBufferViews(model, buffers);
+		drawRecords.clear();
+
 		const tinygltf::Scene &scene = model.scenes[model.defaultScene];
 		for (size_t i = 0; i < scene.nodes.size(); ++i) {
 			assert((scene.nodes[i] >= 0) && (scene.nodes[i] < model.nodes.size()));
-			bindModelNodes(primitiveObjects, model, model.nodes[scene.nodes[i]]);
+			bindModelNodes(primitiveObjects, model, scene.nodes[i]);
 		}
 
 		return primitiveObjects;
 	}
 
-	void drawMesh(const std::vector<PrimitiveObject> &primitiveObjects,
-				tinygltf::Model &model, tinygltf::Mesh &mesh) {
+	void drawModel() {
+		for (const DrawRecord &drawRecord : drawRecords) {
+			glBindVertexArray(drawRecord.vao);
+			glDrawElements(drawRecord.mode, drawRecord.count, drawRecord.indexType,
+						BUFFER_OFFSET(drawRecord.indexOffset));
+		}
+		glBindVertexArray(0);
+	}
 
-		for (size_t i = 0; i < mesh.primitives.size(); ++i)
-		{
-			GLuint vao = primitiveObjects[i].vao;
-			std::map<int, GLuint> vbos = primitiveObjects[i].vbos;
+	// Write the current pose into the palette ring once per frame, every pass that draws
+	// the bot this frame binds the same range
+	void uploadJointPalette(const RenderState &state) {
+		if (state.jointMatrices.empty() || (!state.inCameraView && !state.inShadowView)) {
+			return;
+		}
+		jointPaletteOffset = jointPaletteRing.upload(state.jointMatrices);
+	}
 
-			glBindVertexArray(vao);
+	// Skin every vertex once with transform feedback, all passes this frame draw the result
+	void skinVertices(const RenderState &state) {
+		if (state.jointMatrices.empty() || (!state.inCameraView && !state.inShadowView)) {
+			return;
+		}
 
-			tinygltf::Primitive primitive = mesh.primitives[i];
-			tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
+		glUseProgram(skinningProgramID);
+		jointPaletteRing.bind(jointPaletteOffset);
+		glEnable(GL_RASTERIZER_DISCARD);
 
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbos.at(indexAccessor.bufferView));
+		for (const PrimitiveObject &primitiveObject : primitiveObjects) {
+			glBindVertexArray(primitiveObject.vao);
+			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, primitiveObject.skinnedVBO);
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS, 0, primitiveObject.vertexCount);
+			glEndTransformFeedback();
+		}
 
-			glDrawElements(primitive.mode, indexAccessor.count,
-						indexAccessor.componentType,
-						BUFFER_OFFSET(indexAccessor.byteOffset));
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+		glDisable(GL_RASTERIZER_DISCARD);
+		glBindVertexArray(0);
+	}
 
-			glBindVertexArray(0);
+	void renderShadow(glm::mat4 lightSpaceMatrix, const RenderState &state) {
+		if (!state.inShadowView) {
+			return;
 		}
+		glUseProgram(depthShaderID);
+
+		glUniformMatrix4fv(modelMatrixDepthID, 1, GL_FALSE, &modelMatrix[0][0]);
+		glUniformMatrix4fv(lightSpaceMatrixID, 1, GL_FALSE, &lightSpaceMatrix[0][0]);
+
+		drawModel();
 	}
 
-	void drawModelNodes(const std::vector<PrimitiveObject>& primitiveObjects,
-						tinygltf::Model &model, tinygltf::Node &node) {
-		// Draw the mesh at the node, and recursively do so for children nodes
-		if ((node.mesh >= 0) && (node.mesh < model.meshes.size())) {
-			drawMesh(primitiveObjects, model, model.meshes[node.mesh]);
+	void render(glm::mat4 cameraMatrix, const RenderState &state) {
+		if (!state.inCameraView) {
+			return;
 		}
-		for (size_t i = 0; i < node.children.size(); i++) {
-			drawModelNodes(primitiveObjects, model, model.nodes[node.children[i]]);
+		glUseProgram(programID);
+
+		// Set camera
+		glm::mat4 mvp = cameraMatrix * modelMatrix;
+		glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
+
+		// Set light data
+		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
+		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
+
+		// Draw the GLTF model
+		drawModel();
+	}
+
+	void cleanup() {
+		for (const PrimitiveObject &primitiveObject : primitiveObjects) {
+			glDeleteVertexArrays(1, &primitiveObject.skinnedVAO);
+			glDeleteBuffers(1, &primitiveObject.skinnedVBO);
+			if (!sharesResources) {
+				glDeleteVertexArrays(1, &primitiveObject.vao);
+			}
+		}
+		if (sharesResources) {
+			return;
+		}
+		for (GLuint vbo : bufferViewVBOs) {
+			if (vbo != 0) {
+				glDeleteBuffers(1, &vbo);
+			}
 		}
+		glDeleteProgram(programID);
+		glDeleteProgram(skinningProgramID);
+		glDeleteProgram(depthShaderID);
 	}
-	void drawModel(const std::vector<PrimitiveObject>& primitiveObjects,
-				tinygltf::Model &model) {
-		// Draw all nodes
-		const tinygltf::Scene &scene = model.scenes[model.defaultScene];
-		for (size_t i = 0; i < scene.nodes.size(); ++i) {
-			drawModelNodes(primitiveObjects, model, model.nodes[scene.nodes[i]]);
+};
+
+// Frame statistics drawn over the scene: every profiled scope with its smoothed CPU and GPU time,
+// indented by nesting depth, then the GL calls each render pass made in the last frame. Bars are
+// one 60 Hz frame wide, the upper one CPU and the lower one GPU.
+struct ProfilerOverlay {
+	static constexpr float MARGIN = 10.0f;
+	static constexpr float LINE_HEIGHT = 12.0f;
+	static constexpr float INDENT = 8.0f;
+	static constexpr float BAR_X = 240.0f;			// After the 38 columns of a timing line
+	static constexpr float BAR_WIDTH = 160.0f;
+	static constexpr float PANEL_WIDTH = 420.0f;
+	static constexpr double BUDGET_MS = 1000.0 / 60.0;
+	static const int PALETTE_SIZE = 8;
+	static const int FLOATS_PER_VERTEX = 8;		// Pixel position, texture coordinate, colour
+	static const int MAX_CHARACTERS = 8192;
+
+	GLuint vertexArrayID, vertexBufferID;
+	GLuint programID, screenSizeID, fontSamplerID;
+	GLuint fontTextureID;
+	std::vector<float> vertices;		// Rebuilt every frame, keeps its capacity
+	GLsizeiptr bufferCapacity = 0;
+
+	static glm::vec3 paletteColor(int row) {
+		static const glm::vec3 palette[PALETTE_SIZE] = {
+			glm::vec3(0.90f, 0.30f, 0.25f), glm::vec3(0.95f, 0.60f, 0.20f), glm::vec3(0.95f, 0.90f, 0.30f),
+			glm::vec3(0.40f, 0.85f, 0.35f), glm::vec3(0.30f, 0.80f, 0.85f), glm::vec3(0.35f, 0.50f, 0.95f),
+			glm::vec3(0.70f, 0.40f, 0.90f), glm::vec3(0.95f, 0.45f, 0.75f),
+		};
+		return palette[row % PALETTE_SIZE];
+	}
+
+	void initialize() {
+		GLOwnerScope owner("profiler overlay");
+		programID = LoadShadersFromString(profilerOverlayVertexShader, profilerOverlayFragmentShader);
+		if (programID == 0) {
+			LOG_ERROR("Failed to load profiler overlay shaders.");
 		}
+		screenSizeID = glGetUniformLocation(programID, "screenSize");
+		fontSamplerID = glGetUniformLocation(programID, "fontAtlas");
+
+		// Glyphs side by side in a single-channel atlas
+		const int atlasWidth = DEBUG_FONT_COUNT * DEBUG_FONT_WIDTH;
+		std::vector<uint8_t> atlas(atlasWidth * DEBUG_FONT_HEIGHT, 0);
+		for (int glyph = 0; glyph < DEBUG_FONT_COUNT; ++glyph) {
+			for (int y = 0; y < DEBUG_FONT_HEIGHT; ++y) {
+				for (int x = 0; x < DEBUG_FONT_WIDTH; ++x) {
+					if (DEBUG_FONT[glyph][y] & (1 << (DEBUG_FONT_WIDTH - 1 - x))) {
+						atlas[y * atlasWidth + glyph * DEBUG_FONT_WIDTH + x] = 255;
+					}
+				}
+			}
+		}
+		glGenTextures(1, &fontTextureID);
+		glBindTexture(GL_TEXTURE_2D, fontTextureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, DEBUG_FONT_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glGenVertexArrays(1, &vertexArrayID);
+		glBindVertexArray(vertexArrayID);
+		glGenBuffers(1, &vertexBufferID);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), 0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), BUFFER_OFFSET(2 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), BUFFER_OFFSET(4 * sizeof(float)));
+		glBindVertexArray(0);
+
+		vertices.reserve(MAX_CHARACTERS * 6 * FLOATS_PER_VERTEX);
 	}
 
-	void render(glm::mat4 cameraMatrix) {
-		glUseProgram(programID);
+	// Texture coordinates below zero draw a solid quad
+	void addQuad(float x, float y, float width, float height, const glm::vec4& color,
+				 float u0 = -1.0f, float v0 = 0.0f, float u1 = -1.0f, float v1 = 0.0f) {
+		const float corners[6][4] = {
+			{ x, y, u0, v0 }, { x, y + height, u0, v1 }, { x + width, y + height, u1, v1 },
+			{ x, y, u0, v0 }, { x + width, y + height, u1, v1 }, { x + width, y, u1, v0 },
+		};
+		for (const float* corner : corners) {
+			vertices.insert(vertices.end(), corner, corner + 4);
+			vertices.push_back(color.r);
+			vertices.push_back(color.g);
+			vertices.push_back(color.b);
+			vertices.push_back(color.a);
+		}
+	}
 
-		glm::mat4 modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, position);
-		modelMatrix = glm::scale(modelMatrix, scale);
-		// Set camera
-		glm::mat4 mvp = cameraMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
+	void addText(float x, float y, const char* text, const glm::vec4& color) {
+		const float glyphU = 1.0f / DEBUG_FONT_COUNT;
+		for (const char* c = text; *c != '\0'; ++c, x += DEBUG_FONT_WIDTH) {
+			int glyph = *c - DEBUG_FONT_FIRST;
+			if (glyph <= 0 || glyph >= DEBUG_FONT_COUNT) {
+				continue;
+			}
+			addQuad(x, y, float(DEBUG_FONT_WIDTH), float(DEBUG_FONT_HEIGHT), color,
+					glyph * glyphU, 0.0f, (glyph + 1) * glyphU, 1.0f);
+		}
+	}
 
-		// -----------------------------------------------------------------
-		// TODO: Set animation data for linear blend skinning in shader
-		// -----------------------------------------------------------------
-		// For each mesh that needs to be skinned
-		for (size_t i = 0; i < skinObjects.size(); ++i) {
-			const SkinObject& skin = skinObjects[i];
+	// Bars run past the panel by up to another frame when a scope is over budget
+	float barWidth(double ms) {
+		float width = float(ms / BUDGET_MS) * BAR_WIDTH;
+		return width < 2.0f * BAR_WIDTH ? width : 2.0f * BAR_WIDTH;
+	}
 
-			// Validate number of joints doesn't exceed shader limit
-			size_t numJoints = std::min(skin.jointMatrices.size(),
-									   static_cast<size_t>(MAX_JOINTS));
+	void addTimingLine(float y, const char* name, int depth, double cpuMs, double gpuMs, const glm::vec3& color) {
+		char line[64];
+		snprintf(line, sizeof(line), "%*s%-*.*s%7.2f%7.2f", depth * 2, "", 24 - depth * 2, 24 - depth * 2, name, cpuMs, gpuMs);
+		addText(MARGIN, y, line, glm::vec4(1.0f));
 
-			// Pass joint matrices to shader
-			glUniformMatrix4fv(jointMatricesID,
-							  numJoints,  // number of matrices
-							  GL_FALSE,   // don't transpose
-							  glm::value_ptr(skin.jointMatrices[0])); // pointer to first matrix
+		float barHeight = (LINE_HEIGHT - 2.0f) * 0.5f;
+		float x = BAR_X + depth * INDENT;
+		addQuad(x, y, barWidth(cpuMs), barHeight, glm::vec4(color, 0.9f));
+		if (gpuMs > 0.0) {
+			addQuad(x, y + barHeight, barWidth(gpuMs), barHeight, glm::vec4(color * 0.5f, 0.9f));
 		}
-		// -----------------------------------------------------------------
+	}
 
-		// Set light data
-		glUniform3fv(lightPositionID, 1, &lightPosition[0]);
-		glUniform3fv(lightIntensityID, 1, &lightIntensity[0]);
+	void addCounterLine(float y, const char* name, const GLCounters::Counts& c, const glm::vec4& color) {
+		char line[96];
+		snprintf(line, sizeof(line), "%-16.16s%6llu%5llu%5llu%5llu%5llu%6llu%9.1f%6llu%6llu", name,
+				 (unsigned long long)c.drawCalls, (unsigned long long)c.programBinds, (unsigned long long)c.textureBinds,
+				 (unsigned long long)c.vertexArrayBinds, (unsigned long long)c.bufferBinds, (unsigned long long)c.uniformCalls,
+				 c.uploadBytes / 1024.0, (unsigned long long)c.stateChanges, (unsigned long long)c.redundantBinds);
+		addText(MARGIN, y, line, color);
+	}
 
-		// Draw the GLTF model
-		drawModel(primitiveObjects, model);
+	static bool active(const GLCounters::Counts& c) {
+		return c.drawCalls + c.programBinds + c.textureBinds + c.vertexArrayBinds + c.bufferBinds +
+			   c.uniformCalls + c.stateChanges + c.uploadCalls > 0;
+	}
+
+	void render(int width, int height) {
+		const Profiler::State& profile = Profiler::state();
+		const GLCounters::State& calls = GLCounters::state();
+		int counterLines = 0;
+		for (int i = 0; i < calls.sectionCount; ++i) {
+			counterLines += active(calls.sections[i].last) ? 1 : 0;
+		}
+		int lines = 2 + profile.scopeCount + 1 + 2 + counterLines;
+
+		vertices.clear();
+		addQuad(MARGIN - 4.0f, MARGIN - 4.0f, PANEL_WIDTH + 8.0f, lines * LINE_HEIGHT + 8.0f, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+
+		const glm::vec4 headerColor(0.7f, 0.7f, 0.7f, 1.0f);
+		float y = MARGIN;
+		addText(MARGIN, y, "scope                    cpu ms gpu ms", headerColor);
+		y += LINE_HEIGHT;
+		addTimingLine(y, "frame", 0, profile.smoothedFrameMs, profile.smoothedGpuMs, glm::vec3(1.0f));
+		for (int i = 0; i < profile.scopeCount; ++i) {
+			const Profiler::ScopeStats& scope = profile.scopes[i];
+			y += LINE_HEIGHT;
+			addTimingLine(y, scope.name, scope.depth, scope.smoothedCpuMs, scope.smoothedGpuMs, paletteColor(i));
+		}
+
+		y += 2.0f * LINE_HEIGHT;
+		addText(MARGIN, y, "pass             draws prog  tex  vao  buf  unif    KB up state redun", headerColor);
+		for (int i = 0; i < calls.sectionCount; ++i) {
+			if (active(calls.sections[i].last)) {
+				y += LINE_HEIGHT;
+				addCounterLine(y, calls.sections[i].name, calls.sections[i].last, glm::vec4(1.0f));
+			}
+		}
+		y += LINE_HEIGHT;
+		addCounterLine(y, "total", calls.total, glm::vec4(1.0f, 1.0f, 0.6f, 1.0f));
+
+		GLsizeiptr size = vertices.size() * sizeof(float);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+		if (size > bufferCapacity) {
+			glBufferData(GL_ARRAY_BUFFER, size, vertices.data(), GL_DYNAMIC_DRAW);
+			bufferCapacity = size;
+		} else {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices.data());
+		}
+
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_CULL_FACE);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		glUseProgram(programID);
+		glUniform2f(screenSizeID, float(width), float(height));
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, fontTextureID);
+		glUniform1i(fontSamplerID, 0);
+		glBindVertexArray(vertexArrayID);
+		glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size() / FLOATS_PER_VERTEX));
+		glBindVertexArray(0);
+
+		glDisable(GL_BLEND);
+		glEnable(GL_CULL_FACE);
+		glEnable(GL_DEPTH_TEST);
 	}
 
 	void cleanup() {
+		glDeleteBuffers(1, &vertexBufferID);
+		glDeleteVertexArrays(1, &vertexArrayID);
+		glDeleteTextures(1, &fontTextureID);
 		glDeleteProgram(programID);
 	}
 };
 
-int main(void)
+// Procedural load test scaled from the command line: copies of the building, metro stop and sports
+// centre prefabs on a grid around the plateau, and a crowd of bots. Placement and the CPU copies
+// run across the job system, GL objects are then created on the calling thread. The layout is a
+// hash of the copy's index, so it is the same on every run whatever thread places it.
+struct StressScene {
+	static constexpr float CELL_SIZE = 140.0f;		// Fits the widest prefab, the sports centre
+	static constexpr float BOT_SPACING = 12.0f;
+	static constexpr float BOT_HEIGHT = 22.0f;		// On the plateau, as the hand-placed bots stand on the roofs
+	static const int CROWD_PHASES = 8;				// Distinct poses evaluated per frame for the whole crowd
+	static const int PREFAB_GRAIN = 256;
+	static const int CROWD_GRAIN = 16;
+	const glm::vec3 CENTER = glm::vec3(80.0f, 0.0f, -100.0f);	// Middle of the plateau
+
+	// The entities one prefab added to the scene and where it stands
+	struct Prefab {
+		uint32_t firstEntity;
+		uint32_t entityCount;
+		glm::vec3 position;
+	};
+	std::vector<Prefab> prefabs;
+	std::vector<MyBot> crowd;
+
+	static uint32_t hashIndex(uint32_t x) {
+		x ^= x >> 16;
+		x *= 0x7feb352d;
+		x ^= x >> 15;
+		x *= 0x846ca68b;
+		x ^= x >> 16;
+		return x;
+	}
+
+	// Adds the object to the scene as usual and remembers its entities as a prefab to copy
+	template <typename T>
+	void addPrefab(Scene& scene, T& object) {
+		uint32_t first = static_cast<uint32_t>(scene.transforms.size());
+		object.addToScene(scene);
+		Prefab prefab = { first, static_cast<uint32_t>(scene.transforms.size()) - first, object.position };
+		prefabs.push_back(prefab);
+	}
+
+	void generatePrefabs(Scene& scene, JobSystem& jobs, int count) {
+		if (count <= 0 || prefabs.empty()) {
+			return;
+		}
+
+		// The prefab of every copy is known up front, so where its entities start is a prefix sum
+		std::vector<uint32_t> choices(count);
+		std::vector<uint32_t> offsets(count);
+		uint32_t entityCount = 0;
+		for (int i = 0; i < count; ++i) {
+			choices[i] = hashIndex(i) % prefabs.size();
+			offsets[i] = entityCount;
+			entityCount += prefabs[choices[i]].entityCount;
+		}
+		uint32_t first = scene.reserveEntities(entityCount);
+
+		int side = static_cast<int>(std::ceil(std::sqrt(double(count))));
+		float extent = (side - 1) * 0.5f * CELL_SIZE;
+		jobs.parallelFor(count, PREFAB_GRAIN, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i) {
+				const Prefab& prefab = prefabs[choices[i]];
+				glm::vec3 cell(CENTER.x + (i % side) * CELL_SIZE - extent, 0.0f, CENTER.z + (i / side) * CELL_SIZE - extent);
+				float turn = float((hashIndex(i) >> 8) % 4) * float(M_PI) * 0.5f;
+				glm::mat4 placement = glm::translate(glm::mat4(1.0f), cell) *
+									  glm::rotate(glm::mat4(1.0f), turn, glm::vec3(0.0f, 1.0f, 0.0f)) *
+									  glm::translate(glm::mat4(1.0f), -glm::vec3(prefab.position.x, 0.0f, prefab.position.z));
+
+				// Roots are moved by the placement, children follow their parent's copy
+				uint32_t copy = first + offsets[i];
+				for (uint32_t e = 0; e < prefab.entityCount; ++e) {
+					uint32_t source = prefab.firstEntity + e;
+					int32_t parent = scene.parents[source];
+					glm::mat4 transform = scene.localTransforms[source];
+					if (parent == Scene::NO_PARENT) {
+						transform = placement * transform;
+					} else if (uint32_t(parent) >= prefab.firstEntity) {
+						parent = static_cast<int32_t>(copy + (parent - prefab.firstEntity));
+					}
+					uint8_t entityFlags = scene.flags[source] & ~(Scene::FLAG_VISIBLE | Scene::FLAG_TRANSFORM_DIRTY);
+					scene.setEntity(copy + e, transform, scene.localBounds[source], scene.meshes[source],
+									scene.materials[source], entityFlags, parent);
+				}
+			}
+		});
+	}
+
+	// Instances of an initialized bot on a grid in the middle of the plateau
+	void generateCrowd(const MyBot& source, JobSystem& jobs, int count) {
+		if (count <= 0) {
+			return;
+		}
+		crowd.resize(count);
+
+		int side = static_cast<int>(std::ceil(std::sqrt(double(count))));
+		float extent = (side - 1) * 0.5f * BOT_SPACING;
+		jobs.parallelFor(count, CROWD_GRAIN, [&](int begin, int end) {
+			for (int i = begin; i < end; ++i) {
+				MyBot& member = crowd[i];
+				member.copyInstance(source);
+				member.setTransform(glm::vec3(CENTER.x + (i % side) * BOT_SPACING - extent, BOT_HEIGHT,
+											  CENTER.z + (i / side) * BOT_SPACING - extent), source.scale);
+				// Members on the same phase share one pose cache entry
+				member.phaseOffset = (hashIndex(i) % CROWD_PHASES) * 0.25f;
+			}
+		});
+
+		for (MyBot& member : crowd) {
+			member.uploadInstance(source);
+		}
+	}
+
+	void cleanup() {
+		for (MyBot& member : crowd) {
+			member.cleanup();
+		}
+	}
+};
+
+// Camera as left by the input callbacks, handed from the render thread to the simulation thread
+struct CameraInput {
+	glm::vec3 eyeCenter;
+	glm::vec3 lookat;
+	glm::vec3 up;
+};
+
+// Everything the render thread draws from, published by the simulation thread once per frame
+struct SceneSnapshot {
+	glm::vec3 eyeCenter;
+	glm::vec3 lookat;
+	glm::vec3 up;
+	glm::mat4 viewMatrix;
+	glm::mat4 vp;
+
+	std::vector<MyBot::RenderState> bots;
+	std::vector<glm::mat4> cloudMVPs;
+	std::vector<float> cloudAlphas;
+	std::vector<world_setup::SeaVertex> seaVertices;
+	float seaTime;
+};
+
+int main(int argc, char** argv)
 {
+	// Log messages are written out by a background thread from here on
+	Logger::instance().start();
+	if (!parseArguments(argc, argv)) {
+		return -1;
+	}
+
+	// A replay runs until the end of its path unless told how many frames to draw
+	CameraPath cameraPath;
+	if (replayPath != nullptr) {
+		if (!cameraPath.load(replayPath)) {
+			return -1;
+		}
+		if (benchmarkFrames <= 0) {
+			benchmarkFrames = int(std::ceil(cameraPath.duration() / SIMULATION_STEP)) + 1;
+		}
+	} else if (recordPath != nullptr && !cameraPath.startRecording(recordPath)) {
+		return -1;
+	}
+
+#ifdef GLFW_PLATFORM_NULL
+	// Without a display server GLFW 3.4 can still make a context on its null platform, through OSMesa
+	if (headless && getenv("DISPLAY") == nullptr && getenv("WAYLAND_DISPLAY") == nullptr &&
+		glfwPlatformSupported(GLFW_PLATFORM_NULL)) {
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+#endif
+
 	// Initialise GLFW
 	if (!glfwInit())
 	{
-		std::cerr << "Failed to initialize GLFW." << std::endl;
+		LOG_ERROR("Failed to initialize GLFW.");
 		return -1;
 	}
 
@@ -3592,12 +3396,13 @@ int main(void)
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // For MacOS
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, headless ? GLFW_FALSE : GLFW_TRUE);
 
 	// Open a window and create its OpenGL context
 	window = glfwCreateWindow(windowWidth, windowHeight, "Final Project", NULL, NULL);
 	if (window == NULL)
 	{
-		std::cerr << "Failed to open a GLFW window." << std::endl;
+		LOG_ERROR("Failed to open a GLFW window.");
 		glfwTerminate();
 		return -1;
 	}
@@ -3614,15 +3419,33 @@ int main(void)
 	int version = gladLoadGL(glfwGetProcAddress);
 	if (version == 0)
 	{
-		std::cerr << "Failed to initialize OpenGL context." << std::endl;
+		LOG_ERROR("Failed to initialize OpenGL context.");
 		return -1;
 	}
+	if (countGLCalls) {
+		GLCounters::install();
+	}
+	if (trackGpuMemory) {
+		GLResources::install();
+		GLResources::setBudget(uint64_t(gpuMemoryBudgetMB) << 20);
+	}
+
+	// Headless frames go to a framebuffer of the requested size, the hidden window's is not used
+	OffscreenTarget offscreenTarget;
+	if (headless) {
+		glfwSwapInterval(0);
+		if (!offscreenTarget.initialize(windowWidth, windowHeight)) {
+			glfwTerminate();
+			return -1;
+		}
+		sceneFramebuffer = offscreenTarget.framebufferID;
+	}
 
 
 	// Prepare shadow map size for shadow mapping. Usually this is the size of the window itself, but on some platforms like Mac this can be 2x the size of the window. Use glfwGetFramebufferSize to get the shadow map size properly.
 	glfwGetFramebufferSize(window, &shadowMapWidth, &shadowMapHeight);
-	std::cout << "Shadow Map Width: " << shadowMapWidth << std::endl;
-	std::cout << "Shadow Map Height: " << shadowMapHeight << std::endl;
+	LOG_INFO("Shadow Map Width: %d", shadowMapWidth);
+	LOG_INFO("Shadow Map Height: %d", shadowMapHeight);
 
 	// Background
 	glClearColor(0.2f, 0.2f, 0.2f, 0.f);
@@ -3640,6 +3463,9 @@ int main(void)
 
 	// Add particle system for cloud effect.
 	CloudSystem myCloudSystem;
+	if (stressParticles > 0) {
+		myCloudSystem.particleCount = stressParticles;
+	}
 	myCloudSystem.initialize();
 
 	//Define mountain to used in the scene.
@@ -3666,13 +3492,58 @@ int main(void)
 	myBuilding3.initialize(glm::vec3(-80, 110, -200), glm::vec3(25, 2.5*32, 30), "../Final_Project/Textures/Apartment.jpg");
 	myBuilding4.initialize(glm::vec3(-80, 140, -260), glm::vec3(30, 3.5*32, 28), "../Final_Project/Textures/Apartment_texture.jpg");
 
+	// Render passes are timed on the GPU as well, the overlay shows both
+	GpuProfiler gpuProfiler;
+	ProfilerOverlay profilerOverlay;
+	profilerOverlay.initialize();
+
 	// Initialize the skybox to encapsulate the scene.
 	skybox mySkybox({"../Final_Project/Textures/px.png", "../Final_Project/Textures/nx.png", "../Final_Project/Textures/py.png", "../Final_Project/Textures/ny.png","../Final_Project/Textures/pz.png", "../Final_Project/Textures/nz.png" });
 
+	// Uniform buffer ring holding the joint palettes of every animated character.
+	jointPaletteRing.initialize();
+
 	// initialize the fbo used in rendering of shadows.
 	Lighting_Shadows renderLight;
 	renderLight.initialize();
 
+	// Started before the scene is built, stress scenes are generated on it
+	JobSystem jobSystem;
+	jobSystem.initialize();
+
+	// Static geometry is drawn from one shared scene, in the order it used to be rendered.
+	// The buildings, metro stops and sports centres double as the stress scene's prefabs.
+	Scene staticScene;
+	StressScene stressScene;
+	staticScene.initialize();
+	stressScene.addPrefab(staticScene, myBuilding);
+	stressScene.addPrefab(staticScene, myBuilding2);
+	stressScene.addPrefab(staticScene, myBuilding3);
+	stressScene.addPrefab(staticScene, myBuilding4);
+	myWorld.addToScene(staticScene);
+	myAttributes.addToScene(staticScene);
+	stressScene.addPrefab(staticScene, myCenter);
+	stressScene.addPrefab(staticScene, myCenter2);
+	stressScene.addPrefab(staticScene, myMetro);
+	stressScene.addPrefab(staticScene, myMetro2);
+	myMountain.addToScene(staticScene);
+	{
+		int64_t generationStart = Profiler::now();
+		stressScene.generatePrefabs(staticScene, jobSystem, stressPrefabs);
+		stressScene.generateCrowd(bot, jobSystem, stressBots);
+		staticScene.updateTransforms();
+		stressGenerationMs = (Profiler::now() - generationStart) / 1e6;
+		stressEntities = staticScene.transforms.size();
+	}
+
+	// CPU memory still held by each subsystem once its assets are on the GPU
+	LOG_INFO("Resident CPU memory:");
+	reportResidentMemory("bots", bot.residentBytes() + bot2.residentBytes());
+	reportResidentMemory("mountain", myMountain.residentBytes());
+	reportResidentMemory("sea", myWorld.residentBytes());
+	reportResidentMemory("clouds", myCloudSystem.residentBytes());
+	GLResources::report();
+
 	float near_plane = 1.0f, far_plane = 50.0f;
 	glm::mat4 lightProjection = glm::perspective(glm::radians(depthFoV),(float)windowWidth/windowHeight, depthNear, depthFar);
 	glm::mat4 lightView = glm::lookAt (lightPosition,lightLookat, lightUp);
@@ -3684,92 +3555,358 @@ int main(void)
 
 	// Time and frame rate tracking
 	static double lastTime = glfwGetTime();
-	float time = 0.0f;			// Animation time
 	float fTime = 0.0f;			// Time for measuring fps
 	unsigned long frames = 0;
 
-	renderLight.shadowMapPass(lightSpaceMatrix);
+	// Benchmark runs keep every measured frame time, reserved up front so recording never allocates
+	int renderedFrames = 0;
+	std::vector<float> frameTimes, gpuFrameTimes;
+	frameTimes.reserve(benchmarkFrames);
+	gpuFrameTimes.reserve(benchmarkFrames);
+	const double recordStart = glfwGetTime();
+
+	// Simulation state, only touched by the simulation thread and the frame tasks it runs
+	double lastSimulationTime = lastTime;
+	float animationTime = 0.0f;			// Animation time after the last simulation step
+	int animationSteps = 0;				// Steps this frame that advanced animationTime
+	float animationInterpolation = 1.0f;	// Blend between the poses of the last two steps, 1 while paused
+	float accumulator = 0.0f;			// Frame time not yet consumed by simulation steps
+	float deltaTime = 0.0f;
+	int simulationSteps = 0;
+	float interpolation = 0.0f;			// Fraction of a step between the last two simulation states
+	glm::vec3 cameraEye;
+	glm::mat4 cameraView, cameraVP;
+
+	// The two threads only meet through these
+	TripleBuffer<CameraInput> cameraInputs;
+	TripleBuffer<SceneSnapshot> sceneSnapshots;
+	SceneSnapshot* snapshot = &sceneSnapshots.writeSlot();
+
+	CameraInput& initialCamera = cameraInputs.writeSlot();
+	initialCamera.eyeCenter = eye_center;
+	initialCamera.lookat = lookat;
+	initialCamera.up = up;
+	cameraInputs.publish();
+
+	// CPU stages of a frame run in parallel on the job system, everything that touches
+	// OpenGL stays on the render thread
+	AllocationTracker::configure(failOnSteadyStateAllocation ? AllocationTracker::MODE_FAIL : AllocationTracker::MODE_REPORT,
+								 ALLOCATION_WARMUP_FRAMES);
+	AllocationTracker::nameThread("render");
+	Profiler::nameThread("render");
+
+	// Poses are only evaluated by fixed steps, and only for the last two of a frame since earlier
+	// ones are never drawn. Snapshots blend the last two poses instead of sampling in between.
+	auto stepAnimation = [&](MyBot& character) {
+		const float stepLength = SIMULATION_STEP * playbackSpeed;
+		for (int i = std::max(0, animationSteps - 2); i < animationSteps; ++i) {
+			character.update(animationTime - (animationSteps - 1 - i) * stepLength, stepLength);
+		}
+	};
+
+	TaskGraph frameGraph;
+	int cullBot = frameGraph.add("cull bot", [&] { bot.updateVisibility(cameraVP, lightSpaceMatrix, cameraEye); });
+	int cullBot2 = frameGraph.add("cull bot2", [&] { bot2.updateVisibility(cameraVP, lightSpaceMatrix, cameraEye); });
+	frameGraph.add("animate bot", [&] {
+		AllocationScope allocationScope("animate bot");
+		stepAnimation(bot);
+		bot.captureRenderState(snapshot->bots[0], animationInterpolation);
+	}, { cullBot });
+	frameGraph.add("animate bot2", [&] {
+		AllocationScope allocationScope("animate bot2");
+		stepAnimation(bot2);
+		bot2.captureRenderState(snapshot->bots[1], animationInterpolation);
+	}, { cullBot2 });
+
+	// The crowd is culled and animated in batches across the pool, after the two bots in the snapshot
+	std::function<void(int, int)> animateCrowd = [&](int begin, int end) {
+		for (int i = begin; i < end; ++i) {
+			MyBot& member = stressScene.crowd[i];
+			member.updateVisibility(cameraVP, lightSpaceMatrix, cameraEye);
+			stepAnimation(member);
+			member.captureRenderState(snapshot->bots[2 + i], animationInterpolation);
+		}
+	};
+	if (!stressScene.crowd.empty()) {
+		frameGraph.add("animate crowd", [&] {
+			AllocationScope allocationScope("animate crowd");
+			jobSystem.parallelFor(static_cast<int>(stressScene.crowd.size()), StressScene::CROWD_GRAIN, animateCrowd);
+		});
+	}
+	int cloudUpdate = frameGraph.add("clouds", [&] {
+		AllocationScope allocationScope("clouds");
+		for (int i = 0; i < simulationSteps; ++i) {
+			myCloudSystem.update(SIMULATION_STEP);
+		}
+	});
+	frameGraph.add("cloud draw list", [&] {
+		AllocationScope allocationScope("cloud draw list");
+		myCloudSystem.buildDrawList(cameraVP, cameraEye, interpolation, snapshot->cloudMVPs, snapshot->cloudAlphas);
+	}, { cloudUpdate });
+	frameGraph.add("sea", [&] {
+		AllocationScope allocationScope("sea");
+		for (int i = 0; i < simulationSteps; ++i) {
+			myWorld.stepCliffSea(SIMULATION_STEP);
+		}
+		myWorld.simulateCliffSea();
+		snapshot->seaTime = myWorld.interpolateCliffSea(interpolation, snapshot->seaVertices);
+	});
+
+	// Simulation thread: one frame ahead of the render thread, it prepares the next snapshot
+	// while the current one is drawn and waits once that snapshot is still unread. Benchmarks
+	// hand over in lockstep instead: each snapshot is built from the one camera the render thread
+	// published after taking the previous snapshot, whatever the thread timing.
+	std::atomic<bool> simulating(true);
+	std::thread simulationThread([&] {
+		AllocationTracker::nameThread("simulation");
+		Profiler::nameThread("simulation");
+		while (simulating) {
+			if (benchmarkFrames > 0) {
+				if (!cameraInputs.waitForUnread(simulating)) {
+					continue;
+				}
+				cameraInputs.update();
+			} else if (sceneSnapshots.hasUnread()) {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+				continue;
+			} else {
+				cameraInputs.update();
+			}
+
+			double currentTime = glfwGetTime();
+			deltaTime = float(currentTime - lastSimulationTime);
+			lastSimulationTime = currentTime;
+			if (benchmarkFrames > 0) {
+				// Benchmarks step the same simulated time every frame, so each run draws the same frames
+				deltaTime = SIMULATION_STEP;
+			}
+
+			const CameraInput& camera = cameraInputs.readSlot();
+			cameraEye = camera.eyeCenter;
+			cameraView = glm::lookAt(camera.eyeCenter, camera.lookat, camera.up);
+			cameraVP = projectionMatrix * cameraView;
+
+			// Fixed-step simulation clock, a long frame runs several steps and a short one may run none
+			accumulator += deltaTime;
+			simulationSteps = 0;
+			animationSteps = 0;
+			while (accumulator >= SIMULATION_STEP && simulationSteps < MAX_SIMULATION_STEPS) {
+				accumulator -= SIMULATION_STEP;
+				simulationSteps++;
+				if (playAnimation) {
+					animationTime += SIMULATION_STEP * playbackSpeed;
+					animationSteps++;
+				}
+			}
+			if (simulationSteps == MAX_SIMULATION_STEPS) {
+				accumulator = std::min(accumulator, SIMULATION_STEP);
+			}
+			interpolation = accumulator / SIMULATION_STEP;
+
+			if (playAnimation) {
+				poseCache.beginFrame();
+			}
+			animationInterpolation = playAnimation ? interpolation : 1.0f;
+
+			snapshot = &sceneSnapshots.writeSlot();
+			snapshot->eyeCenter = camera.eyeCenter;
+			snapshot->lookat = camera.lookat;
+			snapshot->up = camera.up;
+			snapshot->viewMatrix = cameraView;
+			snapshot->vp = cameraVP;
+			snapshot->bots.resize(2 + stressScene.crowd.size());
+			{
+				ProfileScope profileScope("simulation frame");
+				frameGraph.run(jobSystem);
+			}
+			sceneSnapshots.publish();
+
+			// Every frame task has finished, the workers rewind their arenas on next use
+			FrameArena::endFrame();
+		}
+	});
+
+	// Nothing to draw before the first snapshot, lockstep frames wait for theirs in the loop
+	if (benchmarkFrames <= 0) {
+		sceneSnapshots.waitForUnread(simulating);
+		sceneSnapshots.update();
+	}
+
+	bool staticShadowsBaked = false;
     // ------------------------------------
     do
 	{
+		AllocationTracker::beginFrame();
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// Update states for animation
 		double currentTime = glfwGetTime();
-		float deltaTime = float(currentTime - lastTime);
+		float frameTime = float(currentTime - lastTime);
 		lastTime = currentTime;
 
-		if (playAnimation) {
-			time += deltaTime * playbackSpeed;
-			bot.update(time);
-			bot2.update(time);
+		// A replayed path holds its first key through the warm-up frames, then advances one
+		// simulation step per frame
+		if (replayPath != nullptr) {
+			int replayFrame = renderedFrames > benchmarkWarmupFrames ? renderedFrames - benchmarkWarmupFrames : 0;
+			CameraPath::Key key = cameraPath.sample(replayFrame * SIMULATION_STEP);
+			eye_center = key.eye;
+			lookat = key.lookat;
+			lightPosition = key.light;
+		} else {
+			cameraPath.record(float(currentTime - recordStart), eye_center, lookat, lightPosition);
+		}
+
+		// Hand the camera to the simulation and draw the latest scene it published,
+		// the previous snapshot is drawn again when no new one is ready
+		CameraInput& cameraInput = cameraInputs.writeSlot();
+		cameraInput.eyeCenter = eye_center;
+		cameraInput.lookat = lookat;
+		cameraInput.up = up;
+
+		if (benchmarkFrames > 0) {
+			// Lockstep: every benchmark frame draws the snapshot made from the previous frame's camera,
+			// and this frame's camera is only published once that snapshot is taken, so the simulation
+			// builds exactly one snapshot per camera and overlaps it with the draw
+			sceneSnapshots.waitForUnread(simulating);
+			sceneSnapshots.update();
+			cameraInputs.publish();
+		} else {
+			cameraInputs.publish();
+			sceneSnapshots.update();
+		}
+		const SceneSnapshot& scene = sceneSnapshots.readSlot();
+		const glm::mat4& viewMatrix = scene.viewMatrix;
+		const glm::mat4& vp = scene.vp;
+
+		// Only entities moved since the last frame have their matrices rebuilt and uploaded
+		{
+			ProfileScope profileScope("scene transforms");
+			GLCounterScope glCounterScope("scene transforms");
+			staticScene.updateTransforms();
 		}
 
-		// -------------------------------------------------------------------------------------
-		// For convenience, we multiply the projection and view matrix together and pass a single matrix for rendering
-		glm::mat4 viewMatrix = glm::lookAt(eye_center, lookat, up);
-		glm::mat4 vp = projectionMatrix * viewMatrix;
-		bot.render(vp);
-		bot2.render(vp);
+		{
+			RenderPassScope pass(gpuProfiler, "draw bots");
+			bot.uploadJointPalette(scene.bots[0]);
+			bot2.uploadJointPalette(scene.bots[1]);
+			bot.skinVertices(scene.bots[0]);
+			bot2.skinVertices(scene.bots[1]);
+			bot.render(vp, scene.bots[0]);
+			bot2.render(vp, scene.bots[1]);
+
+			// Each palette is consumed before the next upload, a crowd can wrap the ring many times a frame
+			for (size_t i = 0; i < stressScene.crowd.size(); ++i) {
+				stressScene.crowd[i].uploadJointPalette(scene.bots[2 + i]);
+				stressScene.crowd[i].skinVertices(scene.bots[2 + i]);
+				stressScene.crowd[i].render(vp, scene.bots[2 + i]);
+			}
+		}
 		// FPS tracking
 		// Count number of frames over a few seconds and take average
 		frames++;
-		fTime += deltaTime;
+		fTime += frameTime;
 		if (fTime > 2.0f) {
 			float fps = frames / fTime;
 			frames = 0;
 			fTime = 0;
 
-			std::stringstream stream;
-			stream << std::fixed << std::setprecision(2) << "Final Project | Frames per second (FPS): " << fps;
-			glfwSetWindowTitle(window, stream.str().c_str());
+			// Formatted on the stack, a stringstream would allocate on the render thread
+			char title[128];
+			snprintf(title, sizeof(title), "Final Project | Frames per second (FPS): %.2f | GPU %.2f ms", fps,
+					 Profiler::state().smoothedGpuMs);
+			glfwSetWindowTitle(window, title);
 		}
 		//------------------------------------------------------------------------------
+		// The static casters are rendered once, the skinned ones every frame in this frame's pose
+		{
+			RenderPassScope pass(gpuProfiler, "shadow pass");
+			if (!staticShadowsBaked) {
+				renderLight.beginStaticPass();
+				staticScene.submitShadows(lightSpaceMatrix);
+				staticShadowsBaked = true;
+			}
+			renderLight.beginDynamicPass();
+			bot.renderShadow(lightSpaceMatrix, scene.bots[0]);
+			bot2.renderShadow(lightSpaceMatrix, scene.bots[1]);
+			for (size_t i = 0; i < stressScene.crowd.size(); ++i) {
+				stressScene.crowd[i].renderShadow(lightSpaceMatrix, scene.bots[2 + i]);
+			}
+			renderLight.endPass();
+		}
 		if (saveDepth) {
-			myBuilding.renderShadow(lightSpaceMatrix);
-			myBuilding2.renderShadow(lightSpaceMatrix);
-			myBuilding3.renderShadow(lightSpaceMatrix);
-			myBuilding4.renderShadow(lightSpaceMatrix);
-			myWorld.renderShadow(lightSpaceMatrix);
-			myAttributes.renderShadow(lightSpaceMatrix);
-			myCenter.renderShadow(lightSpaceMatrix);
-			myMetro.renderShadow(lightSpaceMatrix);
-			myMetro2.renderShadow(lightSpaceMatrix);
-			myCenter2.renderShadow(lightSpaceMatrix);
-			myMountain.renderShadow(lightSpaceMatrix);
-			glBindFramebuffer(GL_FRAMEBUFFER, renderLight.depthTexture);
-			glViewport(0,0,windowWidth, windowHeight);
 			std::string filename = "../Final_Project/depth_camera.png";
-			saveDepthTexture(renderLight.depthTexture, filename);
-			std::cout << "Depth texture saved to " << filename << std::endl;
+			saveDepthTexture(renderLight.FBO, filename);
+			LOG_INFO("Depth texture saved to %s", filename.c_str());
 			saveDepth = false;
 		}
 
 		//------------------------------------------------------------------------------
-		myCloudSystem.update(deltaTime);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, renderLight.depthTexture);
-		myBuilding.renderWithLight(vp, lightSpaceMatrix);
-		myBuilding2.renderWithLight(vp, lightSpaceMatrix);
-		myBuilding3.renderWithLight(vp, lightSpaceMatrix);
-		myBuilding4.renderWithLight(vp, lightSpaceMatrix);
-		myWorld.renderWithLight(vp,lightSpaceMatrix);
-		myAttributes.renderWithLight(vp,lightSpaceMatrix,lightIntensity,lightPosition);
-		myCenter.renderWithLight(vp, lightSpaceMatrix);
-		myCenter2.renderWithLight(vp, lightSpaceMatrix);
-		myMetro.renderWithLight(vp,lightSpaceMatrix);
-		myMetro2.renderWithLight(vp,lightSpaceMatrix);
-		myMountain.renderWithLight(vp,lightSpaceMatrix);
-		myCloudSystem.render(vp,eye_center, lookat, up);
-		mySkybox.render(viewMatrix,projectionMatrix);
+		{
+			RenderPassScope pass(gpuProfiler, "upload sea");
+			myWorld.uploadCliffSea(scene.seaVertices, scene.seaTime);
+		}
+		{
+			RenderPassScope pass(gpuProfiler, "draw scene");
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, renderLight.depthTexture);
+			staticScene.cull(vp);
+			staticScene.submitLit(vp, lightSpaceMatrix);
+		}
+		{
+			RenderPassScope pass(gpuProfiler, "draw clouds");
+			myCloudSystem.render(scene.cloudMVPs, scene.cloudAlphas, scene.eyeCenter, scene.lookat, scene.up);
+		}
+		{
+			RenderPassScope pass(gpuProfiler, "draw skybox");
+			mySkybox.render(viewMatrix,projectionMatrix);
+		}
+		if (showProfiler) {
+			RenderPassScope pass(gpuProfiler, "draw overlay");
+			profilerOverlay.render(windowWidth, windowHeight);
+		}
 		//------------------------------------------------------------------------------
-		// Swap buffers
-		glfwSwapBuffers(window);
+		// Swap buffers, or wait for the GPU so headless frame times include its work
+		if (headless) {
+			ProfileScope profileScope("finish");
+			glFinish();
+		} else {
+			ProfileScope profileScope("swap buffers");
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 
+		// Results of last frame's GPU queries, then this frame's CPU scopes
+		gpuProfiler.endFrame();
+		Profiler::endFrame();
+		GLCounters::endFrame();
+
+		if (benchmarkFrames > 0) {
+			renderedFrames++;
+			if (renderedFrames == benchmarkWarmupFrames) {
+				Profiler::resetTotals();
+			} else if (renderedFrames > benchmarkWarmupFrames) {
+				frameTimes.push_back(float(Profiler::state().frameMs));
+				if (Profiler::state().gpuFrameMs >= 0.0) {
+					gpuFrameTimes.push_back(float(Profiler::state().gpuFrameMs));
+				}
+			}
+			if (renderedFrames >= benchmarkWarmupFrames + benchmarkFrames) {
+				glfwSetWindowShouldClose(window, GL_TRUE);
+			}
+		}
+
+		// Allocations every thread made while this frame was on the render thread
+		AllocationTracker::endFrame();
 	} // Check if the ESC key was pressed or the window was closed
 	while (!glfwWindowShouldClose(window));
 
+	simulating = false;
+	cameraInputs.wakeReader();
+	simulationThread.join();
+	jobSystem.shutdown();
+	AllocationTracker::printSummary();
+	cameraPath.stopRecording();
+	reportBenchmark(frameTimes, gpuFrameTimes);
+
 	// Destroy all objects created
 	myWorld.cleanup();
 	myBuilding.cleanup();
@@ -3777,17 +3914,30 @@ int main(void)
 	myBuilding3.cleanup();
 	myBuilding4.cleanup();
 	bot.cleanup();
+	bot2.cleanup();
+	stressScene.cleanup();
+	jointPaletteRing.cleanup();
 	myMountain.cleanup();
 	myCenter.cleanup();
 	myCenter2.cleanup();
 	myMetro.cleanup();
 	myMetro2.cleanup();
 	myAttributes.cleanup();
+	myCloudSystem.cleanup();
+	mySkybox.cleanup();
+	renderLight.cleanup();
+	staticScene.cleanup();
+	profilerOverlay.cleanup();
+	gpuProfiler.cleanup();
+	GLCounters::closeCsv();
+	offscreenTarget.cleanup();
+	GLResources::shutdown();
 
 	glfwSetCursorPosCallback(window, nullptr);
 	glfwSetMouseButtonCallback(window, nullptr);
 	// Close OpenGL window and terminate GLFW
 	glfwTerminate();
+	Logger::instance().shutdown();
 
 	return 0;
 }
@@ -3809,7 +3959,7 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 			lookat += direction * (MIN_DISTANCE-newDistance);
 		}
 		eye_center = newEyePos;
-		std::cout << "(" << eye_center.x <<"," << eye_center.y << "," << eye_center.z << ")" << std::endl;
+		LOG_DEBUG("Camera (%g,%g,%g)", eye_center.x, eye_center.y, eye_center.z);
 	}
 
 	if (key == GLFW_KEY_S && (action == GLFW_REPEAT || action == GLFW_PRESS)) {
@@ -3819,47 +3969,47 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 			lookat -= direction * (MIN_DISTANCE-newDistance);
 		}
 		eye_center = newEyePos;
-		std::cout << "(" << eye_center.x <<"," << eye_center.y << "," << eye_center.z << ")" << std::endl;
+		LOG_DEBUG("Camera (%g,%g,%g)", eye_center.x, eye_center.y, eye_center.z);
 	}
 	if (key == GLFW_KEY_R && action == GLFW_PRESS)
 	{
-		std::cout << "Reset." << std::endl;
+		LOG_INFO("Reset.");
 	}
 
 	if (key == GLFW_KEY_Y && (action == GLFW_REPEAT || action == GLFW_PRESS))
 	{
 		lightPosition.y+= 1.0;
-		std::cout << "(" << lightPosition.x <<"," << lightPosition.y << "," << lightPosition.z << ")" << std::endl;
+		LOG_DEBUG("Light (%g,%g,%g)", lightPosition.x, lightPosition.y, lightPosition.z);
 	}
 
 	if (key == GLFW_KEY_T && (action == GLFW_REPEAT || action == GLFW_PRESS))
 	{
 		lightPosition.y-= 1.0;
-		std::cout << "(" << lightPosition.x <<"," << lightPosition.y << "," << lightPosition.z << ")" << std::endl;
+		LOG_DEBUG("Light (%g,%g,%g)", lightPosition.x, lightPosition.y, lightPosition.z);
 	}
 
 	if (key == GLFW_KEY_G && (action == GLFW_REPEAT || action == GLFW_PRESS))
 	{
 		lightPosition.x+= 1.0;
-		std::cout << "(" << lightPosition.x <<"," << lightPosition.y << "," << lightPosition.z << ")" << std::endl;
+		LOG_DEBUG("Light (%g,%g,%g)", lightPosition.x, lightPosition.y, lightPosition.z);
 	}
 
 	if (key == GLFW_KEY_F && (action == GLFW_REPEAT || action == GLFW_PRESS))
 	{
 		lightPosition.x-= 1.0;
-		std::cout << "(" << lightPosition.x <<"," << lightPosition.y << "," << lightPosition.z << ")" << std::endl;
+		LOG_DEBUG("Light (%g,%g,%g)", lightPosition.x, lightPosition.y, lightPosition.z);
 	}
 
 	if (key == GLFW_KEY_H && (action == GLFW_REPEAT || action == GLFW_PRESS))
 	{
 		lightPosition.z+= 1.0;
-		std::cout << "(" << lightPosition.x <<"," << lightPosition.y << "," << lightPosition.z << ")" << std::endl;
+		LOG_DEBUG("Light (%g,%g,%g)", lightPosition.x, lightPosition.y, lightPosition.z);
 	}
 
 	if (key == GLFW_KEY_J && (action == GLFW_REPEAT || action == GLFW_PRESS))
 	{
 		lightPosition.z-= 1.0;
-		std::cout << "(" << lightPosition.x <<"," << lightPosition.y << "," << lightPosition.z << ")" << std::endl;
+		LOG_DEBUG("Light (%g,%g,%g)", lightPosition.x, lightPosition.y, lightPosition.z);
 	}
 
 	if (key == GLFW_KEY_W && (action == GLFW_REPEAT || action == GLFW_PRESS))
@@ -3892,7 +4042,7 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 		} else if(newZ > 80.0f) {
 			eye_center.z = 80.f;
 		}
-		std::cout << "(" << eye_center.x <<"," << eye_center.y << "," << eye_center.z << ")" << std::endl;
+		LOG_DEBUG("Camera (%g,%g,%g)", eye_center.x, eye_center.y, eye_center.z);
 	}
 
 	if (key == GLFW_KEY_S && (action == GLFW_REPEAT || action == GLFW_PRESS))
@@ -3924,9 +4074,27 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 		} else if(newZ > 80.0f) {
 			eye_center.z = 80.f;
 		}
-		std::cout << "(" << eye_center.x <<"," << eye_center.y << "," << eye_center.z << ")" << std::endl;
+		LOG_DEBUG("Camera (%g,%g,%g)", eye_center.x, eye_center.y, eye_center.z);
 	}
 
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+		showProfiler = !showProfiler;
+
+	if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+		Profiler::startCapture(TRACE_CAPTURE_FRAMES, TRACE_PATH);
+
+	if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+		if (GLCounters::loggingCsv()) {
+			GLCounters::closeCsv();
+			LOG_INFO("Stopped logging GL counters");
+		} else if (countGLCalls) {
+			GLCounters::openCsv(GL_COUNTERS_PATH);
+		}
+	}
+
+	if (key == GLFW_KEY_F4 && action == GLFW_PRESS)
+		GLResources::report();
+
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GL_TRUE);
 }
@@ -3947,9 +4115,9 @@ static GLuint LoadTextureTileBox(const char *texture_file_path) {
 	if (img) {
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, img);
 		glGenerateMipmap(GL_TEXTURE_2D);
-		std::cout << "Loaded" << texture_file_path << std::endl;
+		LOG_DEBUG("Loaded %s", texture_file_path);
 	} else {
-		std::cout << "Failed to load texture " << texture_file_path << std::endl;
+		LOG_ERROR("Failed to load texture %s", texture_file_path);
 	}
 	stbi_image_free(img);
 
@@ -3969,7 +4137,7 @@ static void saveDepthTexture(GLuint fbo, std::string filename) {
 	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 	glReadBuffer(GL_DEPTH_COMPONENT);
 	glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
 
 	std::vector<unsigned char> img(width * height * 3);
 	for (int i = 0; i < width * height; ++i) img[3*i] = img[3*i+1] = img[3*i+2] = depth[i] * 255;
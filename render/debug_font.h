@@ -0,0 +1,111 @@
+#ifndef _DEBUG_FONT_H_
+#define _DEBUG_FONT_H_
+
+#include <cstdint>
+
+// Fixed width bitmap font for debug overlays, printable ASCII from the space to the tilde. Each
+// glyph is DEBUG_FONT_HEIGHT rows from the top, bit 5 of a row is its leftmost pixel.
+static const int DEBUG_FONT_WIDTH = 6;
+static const int DEBUG_FONT_HEIGHT = 10;
+static const int DEBUG_FONT_FIRST = 32;
+static const int DEBUG_FONT_COUNT = 95;
+
+static const uint8_t DEBUG_FONT[DEBUG_FONT_COUNT][DEBUG_FONT_HEIGHT] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// space
+	{ 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x00, 0x18, 0x00, 0x00 },	// !
+	{ 0x00, 0x00, 0x14, 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00 },	// "
+	{ 0x00, 0x14, 0x14, 0x3e, 0x14, 0x14, 0x3e, 0x14, 0x14, 0x00 },	// #
+	{ 0x08, 0x1e, 0x32, 0x3c, 0x1e, 0x06, 0x36, 0x3c, 0x08, 0x00 },	// $
+	{ 0x00, 0x38, 0x2a, 0x3c, 0x08, 0x1e, 0x2a, 0x0e, 0x00, 0x00 },	// %
+	{ 0x00, 0x00, 0x1c, 0x30, 0x18, 0x3e, 0x2c, 0x3e, 0x00, 0x00 },	// &
+	{ 0x00, 0x0c, 0x08, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// quote
+	{ 0x00, 0x04, 0x08, 0x18, 0x18, 0x18, 0x18, 0x08, 0x04, 0x00 },	// (
+	{ 0x00, 0x10, 0x08, 0x0c, 0x0c, 0x0c, 0x0c, 0x08, 0x10, 0x00 },	// )
+	{ 0x00, 0x08, 0x3c, 0x18, 0x24, 0x00, 0x00, 0x00, 0x00, 0x00 },	// *
+	{ 0x00, 0x00, 0x08, 0x08, 0x3e, 0x08, 0x08, 0x00, 0x00, 0x00 },	// +
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x08, 0x10 },	// ,
+	{ 0x00, 0x00, 0x00, 0x00, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00 },	// -
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00 },	// .
+	{ 0x00, 0x02, 0x02, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x00 },	// /
+	{ 0x00, 0x1c, 0x36, 0x36, 0x36, 0x36, 0x36, 0x1c, 0x00, 0x00 },	// 0
+	{ 0x00, 0x0c, 0x3c, 0x0c, 0x0c, 0x0c, 0x0c, 0x3f, 0x00, 0x00 },	// 1
+	{ 0x00, 0x1c, 0x36, 0x06, 0x0c, 0x18, 0x36, 0x3e, 0x00, 0x00 },	// 2
+	{ 0x00, 0x1c, 0x36, 0x06, 0x1c, 0x06, 0x36, 0x1c, 0x00, 0x00 },	// 3
+	{ 0x00, 0x06, 0x0e, 0x16, 0x36, 0x3f, 0x06, 0x06, 0x00, 0x00 },	// 4
+	{ 0x00, 0x3e, 0x30, 0x3c, 0x36, 0x06, 0x26, 0x3c, 0x00, 0x00 },	// 5
+	{ 0x00, 0x1c, 0x36, 0x30, 0x3c, 0x36, 0x36, 0x1c, 0x00, 0x00 },	// 6
+	{ 0x00, 0x3e, 0x36, 0x06, 0x0c, 0x0c, 0x18, 0x18, 0x00, 0x00 },	// 7
+	{ 0x00, 0x1c, 0x36, 0x36, 0x1c, 0x36, 0x36, 0x1c, 0x00, 0x00 },	// 8
+	{ 0x00, 0x1c, 0x36, 0x36, 0x1e, 0x06, 0x36, 0x1c, 0x00, 0x00 },	// 9
+	{ 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x18, 0x00, 0x00 },	// :
+	{ 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x18, 0x10, 0x20 },	// ;
+	{ 0x00, 0x00, 0x0c, 0x18, 0x30, 0x18, 0x0c, 0x00, 0x00, 0x00 },	// <
+	{ 0x00, 0x00, 0x00, 0x3c, 0x00, 0x3c, 0x00, 0x00, 0x00, 0x00 },	// =
+	{ 0x00, 0x00, 0x18, 0x0c, 0x06, 0x0c, 0x18, 0x00, 0x00, 0x00 },	// >
+	{ 0x00, 0x00, 0x1c, 0x26, 0x0c, 0x18, 0x00, 0x18, 0x00, 0x00 },	// ?
+	{ 0x00, 0x1c, 0x32, 0x26, 0x2a, 0x2a, 0x27, 0x30, 0x1c, 0x00 },	// @
+	{ 0x00, 0x00, 0x3c, 0x1c, 0x14, 0x3e, 0x36, 0x37, 0x00, 0x00 },	// A
+	{ 0x00, 0x00, 0x3c, 0x36, 0x3c, 0x36, 0x36, 0x3c, 0x00, 0x00 },	// B
+	{ 0x00, 0x00, 0x1e, 0x36, 0x30, 0x30, 0x36, 0x1c, 0x00, 0x00 },	// C
+	{ 0x00, 0x00, 0x3c, 0x36, 0x36, 0x36, 0x36, 0x3c, 0x00, 0x00 },	// D
+	{ 0x00, 0x00, 0x3e, 0x30, 0x3c, 0x30, 0x36, 0x3e, 0x00, 0x00 },	// E
+	{ 0x00, 0x00, 0x3e, 0x30, 0x3c, 0x30, 0x30, 0x38, 0x00, 0x00 },	// F
+	{ 0x00, 0x00, 0x1c, 0x36, 0x30, 0x3e, 0x36, 0x1e, 0x00, 0x00 },	// G
+	{ 0x00, 0x00, 0x37, 0x36, 0x3e, 0x36, 0x36, 0x37, 0x00, 0x00 },	// H
+	{ 0x00, 0x00, 0x3c, 0x18, 0x18, 0x18, 0x18, 0x3c, 0x00, 0x00 },	// I
+	{ 0x00, 0x00, 0x1e, 0x0c, 0x0c, 0x2c, 0x2c, 0x38, 0x00, 0x00 },	// J
+	{ 0x00, 0x00, 0x36, 0x34, 0x38, 0x3c, 0x36, 0x3b, 0x00, 0x00 },	// K
+	{ 0x00, 0x00, 0x38, 0x30, 0x30, 0x30, 0x36, 0x3e, 0x00, 0x00 },	// L
+	{ 0x00, 0x00, 0x22, 0x36, 0x36, 0x3e, 0x2a, 0x2a, 0x00, 0x00 },	// M
+	{ 0x00, 0x00, 0x37, 0x3a, 0x3a, 0x36, 0x36, 0x32, 0x00, 0x00 },	// N
+	{ 0x00, 0x00, 0x1c, 0x36, 0x36, 0x36, 0x36, 0x1c, 0x00, 0x00 },	// O
+	{ 0x00, 0x00, 0x3c, 0x36, 0x36, 0x3c, 0x30, 0x38, 0x00, 0x00 },	// P
+	{ 0x00, 0x00, 0x1c, 0x36, 0x36, 0x36, 0x36, 0x1c, 0x06, 0x00 },	// Q
+	{ 0x00, 0x00, 0x3c, 0x36, 0x36, 0x3c, 0x36, 0x3b, 0x00, 0x00 },	// R
+	{ 0x00, 0x00, 0x1e, 0x32, 0x3c, 0x0e, 0x26, 0x3c, 0x00, 0x00 },	// S
+	{ 0x00, 0x00, 0x3e, 0x1a, 0x18, 0x18, 0x18, 0x3c, 0x00, 0x00 },	// T
+	{ 0x00, 0x00, 0x37, 0x36, 0x36, 0x36, 0x36, 0x1c, 0x00, 0x00 },	// U
+	{ 0x00, 0x00, 0x37, 0x36, 0x14, 0x1c, 0x1c, 0x08, 0x00, 0x00 },	// V
+	{ 0x00, 0x00, 0x2b, 0x2a, 0x2a, 0x3e, 0x1c, 0x14, 0x00, 0x00 },	// W
+	{ 0x00, 0x00, 0x33, 0x1e, 0x0c, 0x0c, 0x1e, 0x33, 0x00, 0x00 },	// X
+	{ 0x00, 0x00, 0x33, 0x33, 0x1e, 0x0c, 0x0c, 0x1e, 0x00, 0x00 },	// Y
+	{ 0x00, 0x00, 0x3e, 0x36, 0x0c, 0x18, 0x36, 0x3e, 0x00, 0x00 },	// Z
+	{ 0x00, 0x1c, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1c, 0x00 },	// [
+	{ 0x00, 0x20, 0x20, 0x10, 0x10, 0x08, 0x08, 0x04, 0x04, 0x00 },	// backslash
+	{ 0x00, 0x1c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x1c, 0x00 },	// ]
+	{ 0x00, 0x08, 0x1c, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ^
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f },	// _
+	{ 0x00, 0x18, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// `
+	{ 0x00, 0x00, 0x00, 0x1c, 0x36, 0x1e, 0x36, 0x3f, 0x00, 0x00 },	// a
+	{ 0x00, 0x30, 0x30, 0x3c, 0x36, 0x36, 0x36, 0x3c, 0x00, 0x00 },	// b
+	{ 0x00, 0x00, 0x00, 0x1c, 0x36, 0x30, 0x36, 0x1c, 0x00, 0x00 },	// c
+	{ 0x00, 0x0e, 0x06, 0x1e, 0x36, 0x36, 0x36, 0x1f, 0x00, 0x00 },	// d
+	{ 0x00, 0x00, 0x00, 0x1c, 0x36, 0x3e, 0x30, 0x1e, 0x00, 0x00 },	// e
+	{ 0x00, 0x0e, 0x18, 0x3e, 0x18, 0x18, 0x18, 0x3e, 0x00, 0x00 },	// f
+	{ 0x00, 0x00, 0x00, 0x1b, 0x36, 0x36, 0x36, 0x1e, 0x06, 0x3c },	// g
+	{ 0x00, 0x30, 0x30, 0x3c, 0x36, 0x36, 0x36, 0x36, 0x00, 0x00 },	// h
+	{ 0x00, 0x0c, 0x00, 0x3c, 0x0c, 0x0c, 0x0c, 0x3f, 0x00, 0x00 },	// i
+	{ 0x00, 0x0c, 0x00, 0x3c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x38 },	// j
+	{ 0x00, 0x30, 0x30, 0x36, 0x3c, 0x38, 0x3c, 0x37, 0x00, 0x00 },	// k
+	{ 0x00, 0x3c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x3f, 0x00, 0x00 },	// l
+	{ 0x00, 0x00, 0x00, 0x3c, 0x3e, 0x2a, 0x2a, 0x2a, 0x00, 0x00 },	// m
+	{ 0x00, 0x00, 0x00, 0x2c, 0x36, 0x36, 0x36, 0x36, 0x00, 0x00 },	// n
+	{ 0x00, 0x00, 0x00, 0x1c, 0x36, 0x36, 0x36, 0x1c, 0x00, 0x00 },	// o
+	{ 0x00, 0x00, 0x00, 0x3c, 0x36, 0x36, 0x36, 0x3c, 0x30, 0x38 },	// p
+	{ 0x00, 0x00, 0x00, 0x1b, 0x36, 0x36, 0x36, 0x1e, 0x06, 0x0f },	// q
+	{ 0x00, 0x00, 0x00, 0x37, 0x1d, 0x18, 0x18, 0x3c, 0x00, 0x00 },	// r
+	{ 0x00, 0x00, 0x00, 0x1e, 0x38, 0x1e, 0x07, 0x3e, 0x00, 0x00 },	// s
+	{ 0x00, 0x18, 0x18, 0x3e, 0x18, 0x18, 0x1b, 0x0e, 0x00, 0x00 },	// t
+	{ 0x00, 0x00, 0x00, 0x36, 0x36, 0x36, 0x36, 0x1f, 0x00, 0x00 },	// u
+	{ 0x00, 0x00, 0x00, 0x36, 0x36, 0x1c, 0x1c, 0x08, 0x00, 0x00 },	// v
+	{ 0x00, 0x00, 0x00, 0x2b, 0x2a, 0x3e, 0x1e, 0x14, 0x00, 0x00 },	// w
+	{ 0x00, 0x00, 0x00, 0x3b, 0x1e, 0x0c, 0x1e, 0x37, 0x00, 0x00 },	// x
+	{ 0x00, 0x00, 0x00, 0x37, 0x36, 0x36, 0x14, 0x1c, 0x18, 0x30 },	// y
+	{ 0x00, 0x00, 0x00, 0x3e, 0x2c, 0x18, 0x36, 0x3e, 0x00, 0x00 },	// z
+	{ 0x00, 0x06, 0x0c, 0x0c, 0x18, 0x0c, 0x0c, 0x0c, 0x06, 0x00 },	// {
+	{ 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00 },	// |
+	{ 0x00, 0x30, 0x18, 0x18, 0x0c, 0x18, 0x18, 0x18, 0x30, 0x00 },	// }
+	{ 0x00, 0x00, 0x00, 0x1a, 0x2c, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ~
+};
+
+#endif
@@ -0,0 +1,441 @@
+#ifndef _GL_COUNTERS_H_
+#define _GL_COUNTERS_H_
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <core/log.h>
+
+// Per-frame counts of the GL calls the renderer makes. install() swaps glad's function pointers for
+// counting wrappers that forward to the driver, so call sites stay plain gl* calls. Calls are
+// attributed to the section open at the time, normally a render pass, or to "other" outside any.
+// Everything here runs on the thread owning the GL context.
+struct GLCounters {
+	static const int MAX_SECTIONS = 32;
+	static const int OTHER = 0;				// Section of calls made outside any pass
+	static const int TRACKED_TEXTURE_UNITS = 16;
+
+	struct Counts {
+		uint64_t drawCalls;
+		uint64_t programBinds;
+		uint64_t textureBinds;
+		uint64_t vertexArrayBinds;
+		uint64_t bufferBinds;
+		uint64_t redundantBinds;		// Program, 2D texture or VAO binds of what was already bound
+		uint64_t uniformCalls;
+		uint64_t uniformBytes;
+		uint64_t stateChanges;			// Enables, blend, depth, viewport and framebuffer changes
+		uint64_t uploadCalls;
+		uint64_t uploadBytes;			// Buffer and texture data handed to the driver, mapped writes included
+
+		void add(const Counts& other) {
+			drawCalls += other.drawCalls;
+			programBinds += other.programBinds;
+			textureBinds += other.textureBinds;
+			vertexArrayBinds += other.vertexArrayBinds;
+			bufferBinds += other.bufferBinds;
+			redundantBinds += other.redundantBinds;
+			uniformCalls += other.uniformCalls;
+			uniformBytes += other.uniformBytes;
+			stateChanges += other.stateChanges;
+			uploadCalls += other.uploadCalls;
+			uploadBytes += other.uploadBytes;
+		}
+	};
+
+	struct Section {
+		const char* name;
+		Counts current;			// Frame being recorded
+		Counts last;			// Last finished frame, what the overlay shows
+	};
+
+	// The driver's entry points, called by the wrappers
+	struct Entries {
+		PFNGLDRAWARRAYSPROC drawArrays;
+		PFNGLDRAWELEMENTSPROC drawElements;
+		PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced;
+		PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
+		PFNGLUSEPROGRAMPROC useProgram;
+		PFNGLACTIVETEXTUREPROC activeTexture;
+		PFNGLBINDTEXTUREPROC bindTexture;
+		PFNGLBINDVERTEXARRAYPROC bindVertexArray;
+		PFNGLBINDBUFFERPROC bindBuffer;
+		PFNGLBINDBUFFERBASEPROC bindBufferBase;
+		PFNGLBINDBUFFERRANGEPROC bindBufferRange;
+		PFNGLUNIFORM1IPROC uniform1i;
+		PFNGLUNIFORM1FPROC uniform1f;
+		PFNGLUNIFORM2FPROC uniform2f;
+		PFNGLUNIFORM3FVPROC uniform3fv;
+		PFNGLUNIFORMMATRIX3FVPROC uniformMatrix3fv;
+		PFNGLUNIFORMMATRIX4FVPROC uniformMatrix4fv;
+		PFNGLENABLEPROC enable;
+		PFNGLDISABLEPROC disable;
+		PFNGLBLENDFUNCPROC blendFunc;
+		PFNGLDEPTHMASKPROC depthMask;
+		PFNGLDEPTHFUNCPROC depthFunc;
+		PFNGLVIEWPORTPROC viewport;
+		PFNGLBINDFRAMEBUFFERPROC bindFramebuffer;
+		PFNGLBUFFERDATAPROC bufferData;
+		PFNGLBUFFERSUBDATAPROC bufferSubData;
+		PFNGLTEXIMAGE2DPROC texImage2D;
+		PFNGLMAPBUFFERRANGEPROC mapBufferRange;
+	};
+
+	struct State {
+		Entries real;
+		bool installed = false;
+		Section sections[MAX_SECTIONS];
+		int sectionCount = 1;
+		int current = OTHER;
+		Counts total;			// Last finished frame over every section
+		uint64_t frames = 0;
+
+		// What is bound, to spot redundant binds
+		GLuint program = 0;
+		GLuint vertexArray = 0;
+		GLuint textureUnit = 0;
+		GLuint textures[TRACKED_TEXTURE_UNITS];
+
+		FILE* csv = nullptr;
+
+		State() {
+			memset(sections, 0, sizeof(sections));
+			memset(&total, 0, sizeof(total));
+			memset(textures, 0, sizeof(textures));
+			sections[OTHER].name = "other";
+		}
+	};
+
+	static State& state() {
+		static State instance;
+		return instance;
+	}
+
+	static Counts& counts() {
+		State& s = state();
+		return s.sections[s.current].current;
+	}
+
+	// Call once after gladLoadGL, before any object is created
+	static void install() {
+		State& s = state();
+		if (s.installed) {
+			return;
+		}
+		s.installed = true;
+#define GL_COUNTERS_HOOK(entry, name) s.real.entry = glad_##name; glad_##name = entry
+		GL_COUNTERS_HOOK(drawArrays, glDrawArrays);
+		GL_COUNTERS_HOOK(drawElements, glDrawElements);
+		GL_COUNTERS_HOOK(drawArraysInstanced, glDrawArraysInstanced);
+		GL_COUNTERS_HOOK(drawElementsInstanced, glDrawElementsInstanced);
+		GL_COUNTERS_HOOK(useProgram, glUseProgram);
+		GL_COUNTERS_HOOK(activeTexture, glActiveTexture);
+		GL_COUNTERS_HOOK(bindTexture, glBindTexture);
+		GL_COUNTERS_HOOK(bindVertexArray, glBindVertexArray);
+		GL_COUNTERS_HOOK(bindBuffer, glBindBuffer);
+		GL_COUNTERS_HOOK(bindBufferBase, glBindBufferBase);
+		GL_COUNTERS_HOOK(bindBufferRange, glBindBufferRange);
+		GL_COUNTERS_HOOK(uniform1i, glUniform1i);
+		GL_COUNTERS_HOOK(uniform1f, glUniform1f);
+		GL_COUNTERS_HOOK(uniform2f, glUniform2f);
+		GL_COUNTERS_HOOK(uniform3fv, glUniform3fv);
+		GL_COUNTERS_HOOK(uniformMatrix3fv, glUniformMatrix3fv);
+		GL_COUNTERS_HOOK(uniformMatrix4fv, glUniformMatrix4fv);
+		GL_COUNTERS_HOOK(enable, glEnable);
+		GL_COUNTERS_HOOK(disable, glDisable);
+		GL_COUNTERS_HOOK(blendFunc, glBlendFunc);
+		GL_COUNTERS_HOOK(depthMask, glDepthMask);
+		GL_COUNTERS_HOOK(depthFunc, glDepthFunc);
+		GL_COUNTERS_HOOK(viewport, glViewport);
+		GL_COUNTERS_HOOK(bindFramebuffer, glBindFramebuffer);
+		GL_COUNTERS_HOOK(bufferData, glBufferData);
+		GL_COUNTERS_HOOK(bufferSubData, glBufferSubData);
+		GL_COUNTERS_HOOK(texImage2D, glTexImage2D);
+		GL_COUNTERS_HOOK(mapBufferRange, glMapBufferRange);
+#undef GL_COUNTERS_HOOK
+	}
+
+	// Sections are found by name, the name must outlive the counters
+	static int beginSection(const char* name) {
+		State& s = state();
+		int previous = s.current;
+		for (int i = 0; i < s.sectionCount; ++i) {
+			if (s.sections[i].name == name || strcmp(s.sections[i].name, name) == 0) {
+				s.current = i;
+				return previous;
+			}
+		}
+		if (s.sectionCount < MAX_SECTIONS) {
+			s.sections[s.sectionCount].name = name;
+			s.current = s.sectionCount++;
+		}
+		return previous;
+	}
+
+	static void endSection(int previous) {
+		state().current = previous;
+	}
+
+	// Rolls the frame's counts over and appends them to the CSV log when one is open
+	static void endFrame() {
+		State& s = state();
+		memset(&s.total, 0, sizeof(s.total));
+		for (int i = 0; i < s.sectionCount; ++i) {
+			Section& section = s.sections[i];
+			section.last = section.current;
+			memset(&section.current, 0, sizeof(section.current));
+			s.total.add(section.last);
+			if (s.csv != nullptr) {
+				writeRow(section.name, section.last);
+			}
+		}
+		if (s.csv != nullptr) {
+			writeRow("total", s.total);
+		}
+		s.frames++;
+	}
+
+	// One row per section and frame, plus a total row
+	static bool openCsv(const char* path) {
+		State& s = state();
+		closeCsv();
+		s.csv = fopen(path, "w");
+		if (s.csv == nullptr) {
+			LOG_ERROR("Failed to open %s for the GL counters.", path);
+			return false;
+		}
+		fprintf(s.csv, "frame,section,draws,programs,textures,vertex_arrays,buffers,redundant_binds,"
+					   "uniforms,uniform_bytes,state_changes,uploads,upload_bytes\n");
+		LOG_INFO("Logging GL counters to %s", path);
+		return true;
+	}
+
+	static void closeCsv() {
+		State& s = state();
+		if (s.csv != nullptr) {
+			fclose(s.csv);
+			s.csv = nullptr;
+		}
+	}
+
+	static bool loggingCsv() {
+		return state().csv != nullptr;
+	}
+
+	static void writeRow(const char* name, const Counts& c) {
+		fprintf(state().csv, "%llu,%s,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+				(unsigned long long)state().frames, name,
+				(unsigned long long)c.drawCalls, (unsigned long long)c.programBinds, (unsigned long long)c.textureBinds,
+				(unsigned long long)c.vertexArrayBinds, (unsigned long long)c.bufferBinds, (unsigned long long)c.redundantBinds,
+				(unsigned long long)c.uniformCalls, (unsigned long long)c.uniformBytes, (unsigned long long)c.stateChanges,
+				(unsigned long long)c.uploadCalls, (unsigned long long)c.uploadBytes);
+	}
+
+	static void uniform(uint64_t bytes) {
+		Counts& c = counts();
+		c.uniformCalls++;
+		c.uniformBytes += bytes;
+	}
+
+	static void upload(uint64_t bytes) {
+		Counts& c = counts();
+		c.uploadCalls++;
+		c.uploadBytes += bytes;
+	}
+
+	static uint64_t pixelBytes(GLenum format, GLenum type) {
+		uint64_t components = 4;
+		switch (format) {
+			case GL_RED: case GL_DEPTH_COMPONENT: components = 1; break;
+			case GL_RG: components = 2; break;
+			case GL_RGB: components = 3; break;
+		}
+		return components * (type == GL_UNSIGNED_BYTE ? 1 : 4);
+	}
+
+	// Wrappers
+	static void GLAD_API_PTR drawArrays(GLenum mode, GLint first, GLsizei count) {
+		counts().drawCalls++;
+		state().real.drawArrays(mode, first, count);
+	}
+
+	static void GLAD_API_PTR drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+		counts().drawCalls++;
+		state().real.drawElements(mode, count, type, indices);
+	}
+
+	static void GLAD_API_PTR drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+		counts().drawCalls++;
+		state().real.drawArraysInstanced(mode, first, count, instances);
+	}
+
+	static void GLAD_API_PTR drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances) {
+		counts().drawCalls++;
+		state().real.drawElementsInstanced(mode, count, type, indices, instances);
+	}
+
+	static void GLAD_API_PTR useProgram(GLuint program) {
+		State& s = state();
+		Counts& c = counts();
+		c.programBinds++;
+		if (program == s.program) {
+			c.redundantBinds++;
+		}
+		s.program = program;
+		s.real.useProgram(program);
+	}
+
+	static void GLAD_API_PTR activeTexture(GLenum unit) {
+		State& s = state();
+		s.textureUnit = unit - GL_TEXTURE0;
+		counts().stateChanges++;
+		s.real.activeTexture(unit);
+	}
+
+	static void GLAD_API_PTR bindTexture(GLenum target, GLuint texture) {
+		State& s = state();
+		Counts& c = counts();
+		c.textureBinds++;
+		if (target == GL_TEXTURE_2D && s.textureUnit < TRACKED_TEXTURE_UNITS) {
+			if (s.textures[s.textureUnit] == texture) {
+				c.redundantBinds++;
+			}
+			s.textures[s.textureUnit] = texture;
+		}
+		s.real.bindTexture(target, texture);
+	}
+
+	static void GLAD_API_PTR bindVertexArray(GLuint vertexArray) {
+		State& s = state();
+		Counts& c = counts();
+		c.vertexArrayBinds++;
+		if (vertexArray == s.vertexArray) {
+			c.redundantBinds++;
+		}
+		s.vertexArray = vertexArray;
+		s.real.bindVertexArray(vertexArray);
+	}
+
+	static void GLAD_API_PTR bindBuffer(GLenum target, GLuint buffer) {
+		counts().bufferBinds++;
+		state().real.bindBuffer(target, buffer);
+	}
+
+	static void GLAD_API_PTR bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+		counts().bufferBinds++;
+		state().real.bindBufferBase(target, index, buffer);
+	}
+
+	static void GLAD_API_PTR bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		counts().bufferBinds++;
+		state().real.bindBufferRange(target, index, buffer, offset, size);
+	}
+
+	static void GLAD_API_PTR uniform1i(GLint location, GLint v0) {
+		uniform(sizeof(GLint));
+		state().real.uniform1i(location, v0);
+	}
+
+	static void GLAD_API_PTR uniform1f(GLint location, GLfloat v0) {
+		uniform(sizeof(GLfloat));
+		state().real.uniform1f(location, v0);
+	}
+
+	static void GLAD_API_PTR uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+		uniform(2 * sizeof(GLfloat));
+		state().real.uniform2f(location, v0, v1);
+	}
+
+	static void GLAD_API_PTR uniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+		uniform(uint64_t(count) * 3 * sizeof(GLfloat));
+		state().real.uniform3fv(location, count, value);
+	}
+
+	static void GLAD_API_PTR uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+		uniform(uint64_t(count) * 9 * sizeof(GLfloat));
+		state().real.uniformMatrix3fv(location, count, transpose, value);
+	}
+
+	static void GLAD_API_PTR uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+		uniform(uint64_t(count) * 16 * sizeof(GLfloat));
+		state().real.uniformMatrix4fv(location, count, transpose, value);
+	}
+
+	static void GLAD_API_PTR enable(GLenum capability) {
+		counts().stateChanges++;
+		state().real.enable(capability);
+	}
+
+	static void GLAD_API_PTR disable(GLenum capability) {
+		counts().stateChanges++;
+		state().real.disable(capability);
+	}
+
+	static void GLAD_API_PTR blendFunc(GLenum source, GLenum destination) {
+		counts().stateChanges++;
+		state().real.blendFunc(source, destination);
+	}
+
+	static void GLAD_API_PTR depthMask(GLboolean flag) {
+		counts().stateChanges++;
+		state().real.depthMask(flag);
+	}
+
+	static void GLAD_API_PTR depthFunc(GLenum func) {
+		counts().stateChanges++;
+		state().real.depthFunc(func);
+	}
+
+	static void GLAD_API_PTR viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		counts().stateChanges++;
+		state().real.viewport(x, y, width, height);
+	}
+
+	static void GLAD_API_PTR bindFramebuffer(GLenum target, GLuint framebuffer) {
+		counts().stateChanges++;
+		state().real.bindFramebuffer(target, framebuffer);
+	}
+
+	// Allocations without data move nothing and are not counted as uploads
+	static void GLAD_API_PTR bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		if (data != nullptr) {
+			upload(size);
+		}
+		state().real.bufferData(target, size, data, usage);
+	}
+
+	static void GLAD_API_PTR bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+		upload(size);
+		state().real.bufferSubData(target, offset, size, data);
+	}
+
+	static void GLAD_API_PTR texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+										GLint border, GLenum format, GLenum type, const void* pixels) {
+		if (pixels != nullptr) {
+			upload(uint64_t(width) * height * pixelBytes(format, type));
+		}
+		state().real.texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+	}
+
+	// A write mapping is counted as uploading the whole range
+	static void* GLAD_API_PTR mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+		if (access & GL_MAP_WRITE_BIT) {
+			upload(length);
+		}
+		return state().real.mapBufferRange(target, offset, length, access);
+	}
+};
+
+// Attributes the GL calls of the enclosing block to a section
+struct GLCounterScope {
+	int previous;
+
+	explicit GLCounterScope(const char* name) : previous(GLCounters::beginSection(name)) {}
+
+	~GLCounterScope() {
+		GLCounters::endSection(previous);
+	}
+};
+
+#endif
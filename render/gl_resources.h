@@ -0,0 +1,683 @@
+#ifndef _GL_RESOURCES_H_
+#define _GL_RESOURCES_H_
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <core/log.h>
+
+// Estimated GPU memory of every live GL object, by category and owner. install() swaps glad's
+// create, delete and storage entry points for wrappers, like GLCounters does, so objects made with
+// plain gl* calls are tracked as well as the handles below. Sizes are estimated from the storage
+// requested: buffer data sizes, texture level 0 (mipmaps add a third) and renderbuffer storage,
+// at the bytes per pixel drivers usually use. Objects are attributed to the GLOwnerScope open when
+// they were created. The object a storage call applies to is found from bindings shadowed by the
+// bind wrappers, never by asking the driver, since a glGet can stall a threaded driver every frame.
+// Everything here runs on the thread owning the GL context.
+struct GLResources {
+	enum Category { BUFFER, TEXTURE, VERTEX_ARRAY, PROGRAM, FRAMEBUFFER, RENDERBUFFER, QUERY, CATEGORY_COUNT };
+
+	static const int MAX_OWNERS = 32;			// Owners listed in a report, the rest are summed as "other"
+	static const int MAX_LEAKS_LISTED = 64;
+	static const int TRACKED_TEXTURE_UNITS = 32;
+
+	// Buffer targets with a binding of their own, element buffers are held by the vertex array
+	enum BufferTarget {
+		ARRAY_TARGET, UNIFORM_TARGET, PIXEL_PACK_TARGET, PIXEL_UNPACK_TARGET, COPY_READ_TARGET, COPY_WRITE_TARGET,
+		TEXTURE_BUFFER_TARGET, TRANSFORM_FEEDBACK_TARGET, BUFFER_TARGET_COUNT
+	};
+
+	struct Object {
+		GLuint name;
+		Category category;
+		const char* owner;
+		uint64_t bytes;
+		uint64_t faceBytes[6];		// Level 0 of each texture face, cube maps have six
+		bool mipmapped;
+	};
+
+	// The previously installed entry points, called by the wrappers
+	struct Entries {
+		PFNGLGENBUFFERSPROC genBuffers;
+		PFNGLDELETEBUFFERSPROC deleteBuffers;
+		PFNGLBUFFERDATAPROC bufferData;
+		PFNGLGENTEXTURESPROC genTextures;
+		PFNGLDELETETEXTURESPROC deleteTextures;
+		PFNGLTEXIMAGE2DPROC texImage2D;
+		PFNGLGENERATEMIPMAPPROC generateMipmap;
+		PFNGLGENVERTEXARRAYSPROC genVertexArrays;
+		PFNGLDELETEVERTEXARRAYSPROC deleteVertexArrays;
+		PFNGLCREATEPROGRAMPROC createProgram;
+		PFNGLDELETEPROGRAMPROC deleteProgram;
+		PFNGLGENFRAMEBUFFERSPROC genFramebuffers;
+		PFNGLDELETEFRAMEBUFFERSPROC deleteFramebuffers;
+		PFNGLGENRENDERBUFFERSPROC genRenderbuffers;
+		PFNGLDELETERENDERBUFFERSPROC deleteRenderbuffers;
+		PFNGLRENDERBUFFERSTORAGEPROC renderbufferStorage;
+		PFNGLGENQUERIESPROC genQueries;
+		PFNGLDELETEQUERIESPROC deleteQueries;
+		PFNGLBINDBUFFERPROC bindBuffer;
+		PFNGLBINDBUFFERBASEPROC bindBufferBase;
+		PFNGLBINDBUFFERRANGEPROC bindBufferRange;
+		PFNGLBINDVERTEXARRAYPROC bindVertexArray;
+		PFNGLACTIVETEXTUREPROC activeTexture;
+		PFNGLBINDTEXTUREPROC bindTexture;
+		PFNGLBINDRENDERBUFFERPROC bindRenderbuffer;
+	};
+
+	struct State {
+		Entries real;
+		bool installed = false;
+		bool contextAlive = true;		// Cleared by shutdown(), handles destroyed later delete nothing
+		std::unordered_map<uint64_t, Object> objects;
+		const char* owner = "unowned";
+		uint64_t bytes[CATEGORY_COUNT];
+		uint64_t counts[CATEGORY_COUNT];
+		uint64_t total = 0;
+		uint64_t peak = 0;
+		uint64_t budget = 0;			// Warned about when exceeded, 0 is no budget
+		bool overBudget = false;
+
+		// What is bound, kept up to date by the bind wrappers
+		GLuint buffers[BUFFER_TARGET_COUNT];
+		GLuint vertexArray = 0;
+		std::unordered_map<GLuint, GLuint> elementBuffers;	// Element buffer of each vertex array
+		GLuint textureUnit = 0;
+		GLuint textures2D[TRACKED_TEXTURE_UNITS];
+		GLuint texturesCube[TRACKED_TEXTURE_UNITS];
+		GLuint renderbuffer = 0;
+
+		State() {
+			memset(bytes, 0, sizeof(bytes));
+			memset(counts, 0, sizeof(counts));
+			memset(buffers, 0, sizeof(buffers));
+			memset(textures2D, 0, sizeof(textures2D));
+			memset(texturesCube, 0, sizeof(texturesCube));
+		}
+	};
+
+	static State& state() {
+		static State instance;
+		return instance;
+	}
+
+	static const char* categoryName(int category) {
+		static const char* names[CATEGORY_COUNT] = {
+			"buffers", "textures", "vertex arrays", "programs", "framebuffers", "renderbuffers", "queries"
+		};
+		return names[category];
+	}
+
+	// Call once after gladLoadGL, after GLCounters::install() and before any object is created
+	static void install() {
+		State& s = state();
+		if (s.installed) {
+			return;
+		}
+		s.installed = true;
+#define GL_RESOURCES_HOOK(entry, name) s.real.entry = glad_##name; glad_##name = entry
+		GL_RESOURCES_HOOK(genBuffers, glGenBuffers);
+		GL_RESOURCES_HOOK(deleteBuffers, glDeleteBuffers);
+		GL_RESOURCES_HOOK(bufferData, glBufferData);
+		GL_RESOURCES_HOOK(genTextures, glGenTextures);
+		GL_RESOURCES_HOOK(deleteTextures, glDeleteTextures);
+		GL_RESOURCES_HOOK(texImage2D, glTexImage2D);
+		GL_RESOURCES_HOOK(generateMipmap, glGenerateMipmap);
+		GL_RESOURCES_HOOK(genVertexArrays, glGenVertexArrays);
+		GL_RESOURCES_HOOK(deleteVertexArrays, glDeleteVertexArrays);
+		GL_RESOURCES_HOOK(createProgram, glCreateProgram);
+		GL_RESOURCES_HOOK(deleteProgram, glDeleteProgram);
+		GL_RESOURCES_HOOK(genFramebuffers, glGenFramebuffers);
+		GL_RESOURCES_HOOK(deleteFramebuffers, glDeleteFramebuffers);
+		GL_RESOURCES_HOOK(genRenderbuffers, glGenRenderbuffers);
+		GL_RESOURCES_HOOK(deleteRenderbuffers, glDeleteRenderbuffers);
+		GL_RESOURCES_HOOK(renderbufferStorage, glRenderbufferStorage);
+		GL_RESOURCES_HOOK(genQueries, glGenQueries);
+		GL_RESOURCES_HOOK(deleteQueries, glDeleteQueries);
+		GL_RESOURCES_HOOK(bindBuffer, glBindBuffer);
+		GL_RESOURCES_HOOK(bindBufferBase, glBindBufferBase);
+		GL_RESOURCES_HOOK(bindBufferRange, glBindBufferRange);
+		GL_RESOURCES_HOOK(bindVertexArray, glBindVertexArray);
+		GL_RESOURCES_HOOK(activeTexture, glActiveTexture);
+		GL_RESOURCES_HOOK(bindTexture, glBindTexture);
+		GL_RESOURCES_HOOK(bindRenderbuffer, glBindRenderbuffer);
+#undef GL_RESOURCES_HOOK
+	}
+
+	static bool contextAlive() {
+		return state().contextAlive;
+	}
+
+	static void setBudget(uint64_t bytes) {
+		state().budget = bytes;
+	}
+
+	static uint64_t totalBytes() {
+		return state().total;
+	}
+
+	static uint64_t peakBytes() {
+		return state().peak;
+	}
+
+	static uint64_t objectCount() {
+		return state().objects.size();
+	}
+
+	// Owners are compared by pointer, the name must outlive the tracker
+	static const char* setOwner(const char* owner) {
+		State& s = state();
+		const char* previous = s.owner;
+		s.owner = owner;
+		return previous;
+	}
+
+	static uint64_t key(Category category, GLuint name) {
+		return (uint64_t(category) << 32) | name;
+	}
+
+	static Object* find(Category category, GLuint name) {
+		std::unordered_map<uint64_t, Object>::iterator it = state().objects.find(key(category, name));
+		return it != state().objects.end() ? &it->second : nullptr;
+	}
+
+	static void created(Category category, GLsizei n, const GLuint* names) {
+		State& s = state();
+		for (GLsizei i = 0; i < n; ++i) {
+			if (names[i] == 0) {
+				continue;
+			}
+			// A name deleted behind the tracker's back and handed out again is replaced
+			destroyed(category, 1, &names[i]);
+			Object& object = s.objects[key(category, names[i])];
+			memset(&object, 0, sizeof(object));
+			object.name = names[i];
+			object.category = category;
+			object.owner = s.owner;
+			s.counts[category]++;
+		}
+	}
+
+	static void destroyed(Category category, GLsizei n, const GLuint* names) {
+		State& s = state();
+		for (GLsizei i = 0; i < n; ++i) {
+			std::unordered_map<uint64_t, Object>::iterator it = s.objects.find(key(category, names[i]));
+			if (it == s.objects.end()) {
+				continue;
+			}
+			resize(it->second, 0);
+			s.counts[category]--;
+			s.objects.erase(it);
+			unbind(category, names[i]);
+		}
+	}
+
+	static void resize(Object& object, uint64_t bytes) {
+		State& s = state();
+		s.bytes[object.category] += bytes - object.bytes;
+		s.total += bytes - object.bytes;
+		object.bytes = bytes;
+		if (s.total > s.peak) {
+			s.peak = s.total;
+		}
+		if (s.budget > 0 && s.total > s.budget && !s.overBudget) {
+			LOG_WARN("Estimated GPU memory %.1f MiB is over the %.1f MiB budget", s.total / 1048576.0,
+					 s.budget / 1048576.0);
+		}
+		s.overBudget = s.budget > 0 && s.total > s.budget;
+	}
+
+	static void resizeTexture(Object& object) {
+		uint64_t bytes = 0;
+		for (int face = 0; face < 6; ++face) {
+			bytes += object.faceBytes[face];
+		}
+		resize(object, object.mipmapped ? bytes * 4 / 3 : bytes);
+	}
+
+	static int bufferTarget(GLenum target) {
+		switch (target) {
+			case GL_ARRAY_BUFFER: return ARRAY_TARGET;
+			case GL_UNIFORM_BUFFER: return UNIFORM_TARGET;
+			case GL_PIXEL_PACK_BUFFER: return PIXEL_PACK_TARGET;
+			case GL_PIXEL_UNPACK_BUFFER: return PIXEL_UNPACK_TARGET;
+			case GL_COPY_READ_BUFFER: return COPY_READ_TARGET;
+			case GL_COPY_WRITE_BUFFER: return COPY_WRITE_TARGET;
+			case GL_TEXTURE_BUFFER: return TEXTURE_BUFFER_TARGET;
+			case GL_TRANSFORM_FEEDBACK_BUFFER: return TRANSFORM_FEEDBACK_TARGET;
+		}
+		return -1;
+	}
+
+	static GLuint boundBuffer(GLenum target) {
+		State& s = state();
+		if (target == GL_ELEMENT_ARRAY_BUFFER) {
+			std::unordered_map<GLuint, GLuint>::const_iterator it = s.elementBuffers.find(s.vertexArray);
+			return it != s.elementBuffers.end() ? it->second : 0;
+		}
+		int slot = bufferTarget(target);
+		return slot >= 0 ? s.buffers[slot] : 0;
+	}
+
+	static bool cubeFace(GLenum target) {
+		return target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+	}
+
+	// Texture bound to the active unit, 0 for targets and units that are not shadowed
+	static GLuint boundTexture(GLenum target) {
+		State& s = state();
+		if (s.textureUnit >= TRACKED_TEXTURE_UNITS) {
+			return 0;
+		}
+		if (target == GL_TEXTURE_2D) {
+			return s.textures2D[s.textureUnit];
+		}
+		if (target == GL_TEXTURE_CUBE_MAP || cubeFace(target)) {
+			return s.texturesCube[s.textureUnit];
+		}
+		return 0;
+	}
+
+	// Deleting a bound object unbinds it, as GL does
+	static void unbind(Category category, GLuint name) {
+		State& s = state();
+		switch (category) {
+			case BUFFER:
+				for (int i = 0; i < BUFFER_TARGET_COUNT; ++i) {
+					if (s.buffers[i] == name) {
+						s.buffers[i] = 0;
+					}
+				}
+				if (s.elementBuffers.count(s.vertexArray) != 0 && s.elementBuffers[s.vertexArray] == name) {
+					s.elementBuffers[s.vertexArray] = 0;
+				}
+				break;
+			case TEXTURE:
+				for (int i = 0; i < TRACKED_TEXTURE_UNITS; ++i) {
+					if (s.textures2D[i] == name) {
+						s.textures2D[i] = 0;
+					}
+					if (s.texturesCube[i] == name) {
+						s.texturesCube[i] = 0;
+					}
+				}
+				break;
+			case VERTEX_ARRAY:
+				s.elementBuffers.erase(name);
+				if (s.vertexArray == name) {
+					s.vertexArray = 0;
+				}
+				break;
+			case RENDERBUFFER:
+				if (s.renderbuffer == name) {
+					s.renderbuffer = 0;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+
+	// Bytes per pixel of an internal format, RGB is padded to four like most drivers store it
+	static uint64_t formatBytes(GLenum internalFormat) {
+		switch (internalFormat) {
+			case GL_RED: case GL_R8: case GL_STENCIL_INDEX8:
+				return 1;
+			case GL_RG: case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16:
+				return 2;
+			case GL_RGBA16F: case GL_RG32F:
+				return 8;
+			case GL_RGBA32F: case GL_RGB32F:
+				return 16;
+		}
+		return 4;
+	}
+
+	// Creates or deletes objects of any category, for the handles
+	static void generate(Category category, GLsizei n, GLuint* names) {
+		switch (category) {
+			case BUFFER: glGenBuffers(n, names); break;
+			case TEXTURE: glGenTextures(n, names); break;
+			case VERTEX_ARRAY: glGenVertexArrays(n, names); break;
+			case PROGRAM: for (GLsizei i = 0; i < n; ++i) { names[i] = glCreateProgram(); } break;
+			case FRAMEBUFFER: glGenFramebuffers(n, names); break;
+			case RENDERBUFFER: glGenRenderbuffers(n, names); break;
+			case QUERY: glGenQueries(n, names); break;
+			default: break;
+		}
+	}
+
+	static void destroy(Category category, GLsizei n, const GLuint* names) {
+		switch (category) {
+			case BUFFER: glDeleteBuffers(n, names); break;
+			case TEXTURE: glDeleteTextures(n, names); break;
+			case VERTEX_ARRAY: glDeleteVertexArrays(n, names); break;
+			case PROGRAM: for (GLsizei i = 0; i < n; ++i) { glDeleteProgram(names[i]); } break;
+			case FRAMEBUFFER: glDeleteFramebuffers(n, names); break;
+			case RENDERBUFFER: glDeleteRenderbuffers(n, names); break;
+			case QUERY: glDeleteQueries(n, names); break;
+			default: break;
+		}
+	}
+
+	struct OwnerTotals {
+		const char* owner;
+		uint64_t bytes[CATEGORY_COUNT];
+		uint64_t counts[CATEGORY_COUNT];
+		uint64_t total;
+	};
+
+	// Sums the live objects per owner into totals, returns the number of rows used
+	static int ownerTotals(OwnerTotals* totals) {
+		int rows = 0;
+		for (const std::pair<const uint64_t, Object>& entry : state().objects) {
+			const Object& object = entry.second;
+			int row = 0;
+			while (row < rows && totals[row].owner != object.owner && strcmp(totals[row].owner, object.owner) != 0) {
+				row++;
+			}
+			if (row == rows) {
+				if (rows == MAX_OWNERS) {
+					row = MAX_OWNERS - 1;
+					totals[row].owner = "other";
+				} else {
+					memset(&totals[rows], 0, sizeof(totals[rows]));
+					totals[rows++].owner = object.owner;
+				}
+			}
+			totals[row].bytes[object.category] += object.bytes;
+			totals[row].counts[object.category]++;
+			totals[row].total += object.bytes;
+		}
+		return rows;
+	}
+
+	static void logOwners(OwnerTotals* totals, int rows) {
+		LOG_INFO("  %-20s%12s%12s%12s%12s%9s", "owner", "total KiB", "buffers", "textures", "renderbufs", "objects");
+		for (int i = 0; i < rows; ++i) {
+			const OwnerTotals& row = totals[i];
+			uint64_t objects = 0;
+			for (int c = 0; c < CATEGORY_COUNT; ++c) {
+				objects += row.counts[c];
+			}
+			LOG_INFO("  %-20s%12.1f%12.1f%12.1f%12.1f%9llu", row.owner, row.total / 1024.0, row.bytes[BUFFER] / 1024.0,
+					 row.bytes[TEXTURE] / 1024.0, row.bytes[RENDERBUFFER] / 1024.0, (unsigned long long)objects);
+		}
+	}
+
+	// Live breakdown by category and owner
+	static void report() {
+		State& s = state();
+		if (!s.installed) {
+			LOG_INFO("GPU memory tracking is not installed");
+			return;
+		}
+		LOG_INFO("Estimated GPU memory: %.1f MiB in %zu objects, peak %.1f MiB", s.total / 1048576.0,
+				 s.objects.size(), s.peak / 1048576.0);
+		for (int c = 0; c < CATEGORY_COUNT; ++c) {
+			LOG_INFO("  %-20s%12.1f KiB %6llu", categoryName(c), s.bytes[c] / 1024.0, (unsigned long long)s.counts[c]);
+		}
+		OwnerTotals totals[MAX_OWNERS];
+		logOwners(totals, ownerTotals(totals));
+	}
+
+	// Lists what is still alive as leaks, call after every cleanup and before the context is
+	// destroyed. Handles destroyed afterwards no longer call into GL.
+	static void shutdown() {
+		State& s = state();
+		if (s.installed && !s.objects.empty()) {
+			LOG_WARN("%zu GL objects leaked, %.1f KiB of GPU memory", s.objects.size(), s.total / 1024.0);
+			OwnerTotals totals[MAX_OWNERS];
+			logOwners(totals, ownerTotals(totals));
+			int listed = 0;
+			for (const std::pair<const uint64_t, Object>& entry : s.objects) {
+				const Object& object = entry.second;
+				if (listed++ == MAX_LEAKS_LISTED) {
+					LOG_WARN("  ... and %zu more", s.objects.size() - MAX_LEAKS_LISTED);
+					break;
+				}
+				LOG_WARN("  %-20s%-14s#%-9u%.1f KiB", object.owner, categoryName(object.category), object.name,
+						 object.bytes / 1024.0);
+			}
+		} else if (s.installed) {
+			LOG_INFO("No GL objects leaked");
+		}
+		s.contextAlive = false;
+	}
+
+	// Wrappers
+	static void GLAD_API_PTR genBuffers(GLsizei n, GLuint* names) {
+		state().real.genBuffers(n, names);
+		created(BUFFER, n, names);
+	}
+
+	static void GLAD_API_PTR deleteBuffers(GLsizei n, const GLuint* names) {
+		destroyed(BUFFER, n, names);
+		state().real.deleteBuffers(n, names);
+	}
+
+	// Orphaning with the same size leaves the estimate as it is
+	static void GLAD_API_PTR bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		Object* object = find(BUFFER, boundBuffer(target));
+		if (object != nullptr && object->bytes != uint64_t(size)) {
+			resize(*object, size);
+		}
+		state().real.bufferData(target, size, data, usage);
+	}
+
+	static void GLAD_API_PTR genTextures(GLsizei n, GLuint* names) {
+		state().real.genTextures(n, names);
+		created(TEXTURE, n, names);
+	}
+
+	static void GLAD_API_PTR deleteTextures(GLsizei n, const GLuint* names) {
+		destroyed(TEXTURE, n, names);
+		state().real.deleteTextures(n, names);
+	}
+
+	// Only level 0 is sized, smaller levels are accounted for by glGenerateMipmap
+	static void GLAD_API_PTR texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+										GLint border, GLenum format, GLenum type, const void* pixels) {
+		Object* object = level == 0 ? find(TEXTURE, boundTexture(target)) : nullptr;
+		if (object != nullptr) {
+			object->faceBytes[cubeFace(target) ? target - GL_TEXTURE_CUBE_MAP_POSITIVE_X : 0] = uint64_t(width) * height * formatBytes(internalFormat);
+			resizeTexture(*object);
+		}
+		state().real.texImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+	}
+
+	static void GLAD_API_PTR generateMipmap(GLenum target) {
+		Object* object = find(TEXTURE, boundTexture(target));
+		if (object != nullptr && !object->mipmapped) {
+			object->mipmapped = true;
+			resizeTexture(*object);
+		}
+		state().real.generateMipmap(target);
+	}
+
+	static void GLAD_API_PTR genVertexArrays(GLsizei n, GLuint* names) {
+		state().real.genVertexArrays(n, names);
+		created(VERTEX_ARRAY, n, names);
+	}
+
+	static void GLAD_API_PTR deleteVertexArrays(GLsizei n, const GLuint* names) {
+		destroyed(VERTEX_ARRAY, n, names);
+		state().real.deleteVertexArrays(n, names);
+	}
+
+	static GLuint GLAD_API_PTR createProgram() {
+		GLuint program = state().real.createProgram();
+		created(PROGRAM, 1, &program);
+		return program;
+	}
+
+	static void GLAD_API_PTR deleteProgram(GLuint program) {
+		destroyed(PROGRAM, 1, &program);
+		state().real.deleteProgram(program);
+	}
+
+	static void GLAD_API_PTR genFramebuffers(GLsizei n, GLuint* names) {
+		state().real.genFramebuffers(n, names);
+		created(FRAMEBUFFER, n, names);
+	}
+
+	static void GLAD_API_PTR deleteFramebuffers(GLsizei n, const GLuint* names) {
+		destroyed(FRAMEBUFFER, n, names);
+		state().real.deleteFramebuffers(n, names);
+	}
+
+	static void GLAD_API_PTR genRenderbuffers(GLsizei n, GLuint* names) {
+		state().real.genRenderbuffers(n, names);
+		created(RENDERBUFFER, n, names);
+	}
+
+	static void GLAD_API_PTR deleteRenderbuffers(GLsizei n, const GLuint* names) {
+		destroyed(RENDERBUFFER, n, names);
+		state().real.deleteRenderbuffers(n, names);
+	}
+
+	static void GLAD_API_PTR renderbufferStorage(GLenum target, GLenum internalFormat, GLsizei width, GLsizei height) {
+		Object* object = find(RENDERBUFFER, state().renderbuffer);
+		if (object != nullptr) {
+			resize(*object, uint64_t(width) * height * formatBytes(internalFormat));
+		}
+		state().real.renderbufferStorage(target, internalFormat, width, height);
+	}
+
+	static void GLAD_API_PTR genQueries(GLsizei n, GLuint* names) {
+		state().real.genQueries(n, names);
+		created(QUERY, n, names);
+	}
+
+	static void GLAD_API_PTR deleteQueries(GLsizei n, const GLuint* names) {
+		destroyed(QUERY, n, names);
+		state().real.deleteQueries(n, names);
+	}
+
+	static void GLAD_API_PTR bindBuffer(GLenum target, GLuint buffer) {
+		State& s = state();
+		int slot = bufferTarget(target);
+		if (target == GL_ELEMENT_ARRAY_BUFFER) {
+			s.elementBuffers[s.vertexArray] = buffer;
+		} else if (slot >= 0) {
+			s.buffers[slot] = buffer;
+		}
+		s.real.bindBuffer(target, buffer);
+	}
+
+	// Indexed binds set the generic binding of the target too
+	static void GLAD_API_PTR bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+		State& s = state();
+		int slot = bufferTarget(target);
+		if (slot >= 0) {
+			s.buffers[slot] = buffer;
+		}
+		s.real.bindBufferBase(target, index, buffer);
+	}
+
+	static void GLAD_API_PTR bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		State& s = state();
+		int slot = bufferTarget(target);
+		if (slot >= 0) {
+			s.buffers[slot] = buffer;
+		}
+		s.real.bindBufferRange(target, index, buffer, offset, size);
+	}
+
+	static void GLAD_API_PTR bindVertexArray(GLuint vertexArray) {
+		state().vertexArray = vertexArray;
+		state().real.bindVertexArray(vertexArray);
+	}
+
+	static void GLAD_API_PTR activeTexture(GLenum unit) {
+		state().textureUnit = unit - GL_TEXTURE0;
+		state().real.activeTexture(unit);
+	}
+
+	static void GLAD_API_PTR bindTexture(GLenum target, GLuint texture) {
+		State& s = state();
+		if (s.textureUnit < TRACKED_TEXTURE_UNITS) {
+			if (target == GL_TEXTURE_2D) {
+				s.textures2D[s.textureUnit] = texture;
+			} else if (target == GL_TEXTURE_CUBE_MAP) {
+				s.texturesCube[s.textureUnit] = texture;
+			}
+		}
+		s.real.bindTexture(target, texture);
+	}
+
+	static void GLAD_API_PTR bindRenderbuffer(GLenum target, GLuint renderbuffer) {
+		state().renderbuffer = renderbuffer;
+		state().real.bindRenderbuffer(target, renderbuffer);
+	}
+};
+
+// Attributes the GL objects created in the enclosing block to an owner
+struct GLOwnerScope {
+	const char* previous;
+
+	explicit GLOwnerScope(const char* owner) : previous(GLResources::setOwner(owner)) {}
+
+	~GLOwnerScope() {
+		GLResources::setOwner(previous);
+	}
+};
+
+// Owning handle of one GL object, deleted on reset() or when the handle is destroyed. Handles move
+// but never copy, and convert to the object name so they pass straight to gl* calls. Objects made
+// elsewhere, such as programs from LoadShadersFromString, are adopted with reset(name).
+template <GLResources::Category C>
+struct GLHandle {
+	GLuint id = 0;
+
+	GLHandle() = default;
+
+	explicit GLHandle(GLuint id) : id(id) {}
+
+	GLHandle(GLHandle&& other) noexcept : id(other.id) {
+		other.id = 0;
+	}
+
+	GLHandle& operator=(GLHandle&& other) noexcept {
+		if (this != &other) {
+			reset(other.id);
+			other.id = 0;
+		}
+		return *this;
+	}
+
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+
+	~GLHandle() {
+		reset();
+	}
+
+	// Replaces the held object with a new one
+	void create() {
+		reset();
+		GLResources::generate(C, 1, &id);
+	}
+
+	// Nothing is deleted once the context is gone, the object was already reported as leaked
+	void reset(GLuint name = 0) {
+		if (id != 0 && id != name && GLResources::contextAlive()) {
+			GLResources::destroy(C, 1, &id);
+		}
+		id = name;
+	}
+
+	operator GLuint() const {
+		return id;
+	}
+};
+
+typedef GLHandle<GLResources::BUFFER> GLBuffer;
+typedef GLHandle<GLResources::TEXTURE> GLTexture;
+typedef GLHandle<GLResources::VERTEX_ARRAY> GLVertexArray;
+typedef GLHandle<GLResources::PROGRAM> GLProgram;
+typedef GLHandle<GLResources::FRAMEBUFFER> GLFramebuffer;
+typedef GLHandle<GLResources::RENDERBUFFER> GLRenderbuffer;
+
+#endif
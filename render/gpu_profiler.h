@@ -0,0 +1,123 @@
+#ifndef _GPU_PROFILER_H_
+#define _GPU_PROFILER_H_
+
+#include <glad/gl.h>
+#include <cstring>
+#include <core/profiler.h>
+#include <render/gl_counters.h>
+#include <render/gl_resources.h>
+
+// GPU time of render passes from GL_TIME_ELAPSED queries. Each pass owns two queries used on
+// alternate frames and endFrame() reads the ones issued a frame earlier, which the GPU has normally
+// finished by then, so reading back never stalls the pipeline. A query whose result is still
+// pending is not reissued, its pass just goes untimed for a frame. Time-elapsed queries cannot
+// nest: a pass begun while another is being timed is only timed on the CPU.
+struct GpuProfiler {
+	static const int MAX_PASSES = 32;
+
+	struct Pass {
+		const char* name;
+		GLuint queries[2];
+		bool pending[2];			// Issued and not read back yet
+		int64_t submitted[2];		// CPU time the pass began, places it on the trace timeline
+	};
+
+	Pass passes[MAX_PASSES];
+	int passCount = 0;
+	int active = -1;			// Pass whose query is running
+	uint64_t frame = 0;
+
+	int findPass(const char* name) {
+		for (int i = 0; i < passCount; ++i) {
+			if (passes[i].name == name || strcmp(passes[i].name, name) == 0) {
+				return i;
+			}
+		}
+		if (passCount == MAX_PASSES) {
+			return -1;
+		}
+		Pass& pass = passes[passCount];
+		pass.name = name;
+		GLOwnerScope owner("gpu profiler");
+		glGenQueries(2, pass.queries);
+		pass.pending[0] = pass.pending[1] = false;
+		pass.submitted[0] = pass.submitted[1] = 0;
+		return passCount++;
+	}
+
+	// False when the pass is not timed on the GPU this frame
+	bool begin(const char* name) {
+		if (active >= 0) {
+			return false;
+		}
+		int index = findPass(name);
+		if (index < 0) {
+			return false;
+		}
+		Pass& pass = passes[index];
+		int slot = frame & 1;
+		if (pass.pending[slot]) {
+			return false;
+		}
+		glBeginQuery(GL_TIME_ELAPSED, pass.queries[slot]);
+		pass.pending[slot] = true;
+		pass.submitted[slot] = Profiler::now();
+		active = index;
+		return true;
+	}
+
+	void end() {
+		if (active < 0) {
+			return;
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+		active = -1;
+	}
+
+	// Hands the previous frame's results to the profiler, call before Profiler::endFrame()
+	void endFrame() {
+		int slot = (frame + 1) & 1;
+		for (int i = 0; i < passCount; ++i) {
+			Pass& pass = passes[i];
+			if (!pass.pending[slot]) {
+				continue;
+			}
+			GLint available = 0;
+			glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				continue;
+			}
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &elapsed);
+			pass.pending[slot] = false;
+			Profiler::recordGpu(pass.name, pass.submitted[slot], static_cast<int64_t>(elapsed));
+		}
+		frame++;
+	}
+
+	void cleanup() {
+		for (int i = 0; i < passCount; ++i) {
+			glDeleteQueries(2, passes[i].queries);
+		}
+		passCount = 0;
+		active = -1;
+	}
+};
+
+// CPU and GPU timing and the GL call counts of one render pass under the same name
+struct RenderPassScope {
+	ProfileScope cpu;
+	GLCounterScope calls;
+	GpuProfiler& gpu;
+	bool timed;
+
+	RenderPassScope(GpuProfiler& gpu, const char* name) : cpu(name), calls(name), gpu(gpu), timed(gpu.begin(name)) {}
+
+	~RenderPassScope() {
+		if (timed) {
+			gpu.end();
+		}
+	}
+};
+
+#endif
@@ -8,4 +8,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 
 GLuint LoadShadersFromString(std::string VertexShaderCode, std::string FragmentShaderCode);
 
+// Vertex-only program whose outputs are captured with transform feedback into a single interleaved buffer
+GLuint LoadTransformFeedbackShaderFromString(std::string VertexShaderCode, const char *const *Varyings, int VaryingCount);
+
 #endif
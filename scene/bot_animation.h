@@ -0,0 +1,1222 @@
+#ifndef _BOT_ANIMATION_H_
+#define _BOT_ANIMATION_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <tiny_gltf.h>
+#include <core/frame_arena.h>
+#include <core/log.h>
+#include <core/resident_bytes.h>
+#include <scene/frustum.h>
+#include <scene/gltf_buffers.h>
+#include <scene/settings.h>
+
+// Local transform of one node, what clips animate. Poses are blended in this space, a blend of the
+// resulting matrices would shear and shrink limbs that turn between the two poses.
+struct JointPose {
+	glm::vec3 translation = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+
+	glm::mat4 matrix() const {
+		return glm::scale(glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation), scale);
+	}
+
+	static JointPose blend(const JointPose& from, const JointPose& to, float alpha) {
+		JointPose pose;
+		pose.translation = glm::mix(from.translation, to.translation, alpha);
+		pose.rotation = glm::slerp(from.rotation, to.rotation, alpha);
+		pose.scale = glm::mix(from.scale, to.scale, alpha);
+		return pose;
+	}
+};
+
+// Per-frame cache of evaluated joint palettes. Characters playing the same clip of the same skeleton
+// at the same (quantized) time share one evaluation, so pose cost follows unique poses, not instances.
+struct PoseCache {
+	static constexpr float TIME_RESOLUTION = 240.0f;	// Cache slots per second of animation time
+
+	struct Key {
+		size_t skeleton;	// Hash of the model file the skeleton was loaded from
+		int clip;
+		long long quantizedTime;
+
+		bool operator==(const Key& other) const {
+			return skeleton == other.skeleton && clip == other.clip && quantizedTime == other.quantizedTime;
+		}
+	};
+	// Local node pose and the joint palettes of every skin built from it
+	struct Entry {
+		std::vector<JointPose> nodePoses;
+		std::vector<std::vector<glm::mat4>> jointMatrices;
+	};
+
+	// Entries are reused from frame to frame to avoid reallocating. A frame holds one entry per
+	// distinct pose, so a linear scan of the keys stays short and, unlike a node based map, never allocates.
+	std::vector<Entry> entries;
+	std::vector<Key> keys;
+	size_t usedEntries = 0;
+
+	size_t hits = 0;
+	size_t misses = 0;
+
+	// Characters animate in parallel, find and insert are done under this lock
+	std::mutex mutex;
+
+	void beginFrame() {
+		usedEntries = 0;
+		hits = 0;
+		misses = 0;
+	}
+
+	static long long quantize(float time) {
+		return static_cast<long long>(floor(time * TIME_RESOLUTION + 0.5f));
+	}
+
+	static float dequantize(long long quantizedTime) {
+		return quantizedTime / TIME_RESOLUTION;
+	}
+
+	const Entry* find(const Key& key) {
+		for (size_t i = 0; i < usedEntries; ++i) {
+			if (keys[i] == key) {
+				hits++;
+				return &entries[i];
+			}
+		}
+		misses++;
+		return nullptr;
+	}
+
+	Entry& insert(const Key& key) {
+		if (usedEntries == entries.size()) {
+			entries.emplace_back();
+			keys.emplace_back();
+		}
+		keys[usedEntries] = key;
+		return entries[usedEntries++];
+	}
+};
+static PoseCache poseCache;
+
+// CPU half of a skinned glTF character: clip sampling, the animation LOD and the pose handed to the
+// renderer. MyBot in main.cpp loads the model, uploads it and draws the pose.
+struct BotAnimation {
+	glm::vec3 position;
+	glm::vec3 scale;
+
+	// Skinning, the per-instance pose of one skin
+	struct SkinObject {
+		// Transforms the geometry following the movement of the joints
+		std::vector<glm::mat4> globalJointTransforms;
+
+		// Combined transforms
+		std::vector<glm::mat4> jointMatrices;
+
+		// Pose at the fixed step before jointMatrices, the render state blends from it
+		std::vector<glm::mat4> steppedJointMatrices;
+	};
+	std::vector<SkinObject> skinObjects;
+
+	// Local pose of every node at the current step, and the two poses the animation LOD blends
+	// between when the pose is not sampled every step
+	std::vector<JointPose> nodePoses;
+	std::vector<JointPose> previousNodePoses;
+	std::vector<JointPose> sampledNodePoses;
+
+	// Animation
+	enum Interpolation { INTERPOLATION_LINEAR, INTERPOLATION_STEP };
+	struct SamplerObject {
+		std::vector<float> input;
+		std::vector<glm::vec4> output;
+		int interpolation;
+		float sampleRate = 0.0f;	// Keys per second when the input is uniformly spaced, 0 otherwise
+		bool outputIsRotation = false;
+
+		// Quantized keys, used instead of input/output once the sampler is compressed.
+		// Times are 16 bits normalised over the clip, values are 48 bits per key: rotations
+		// use the smallest-three encoding, translations and scales are normalised to their range.
+		bool compressed = false;
+		std::vector<uint16_t> packedTimes;
+		std::vector<uint16_t> packedValues;
+		float startTime = 0.0f;
+		float timeScale = 0.0f;
+		glm::vec3 valueMin = glm::vec3(0.0f);
+		glm::vec3 valueScale = glm::vec3(0.0f);
+
+		int keyCount() const {
+			return compressed ? static_cast<int>(packedTimes.size()) : static_cast<int>(input.size());
+		}
+
+		float keyTime(int i) const {
+			return compressed ? startTime + packedTimes[i] * timeScale : input[i];
+		}
+
+		float endTime() const {
+			return keyTime(keyCount() - 1);
+		}
+
+		glm::vec4 keyValue(int i) const {
+			if (!compressed) {
+				return output[i];
+			}
+			const uint16_t *packed = &packedValues[i * 3];
+			if (!outputIsRotation) {
+				return glm::vec4(valueMin + glm::vec3(packed[0], packed[1], packed[2]) * valueScale, 0.0f);
+			}
+
+			// Smallest three: 2 bits for the index of the dropped component, 15 bits for each of the others
+			uint64_t bits = (uint64_t(packed[0]) << 32) | (uint64_t(packed[1]) << 16) | uint64_t(packed[2]);
+			int largest = static_cast<int>(bits >> 45) & 3;
+			const float scale = 1.0f / (32767.0f * float(M_SQRT1_2 * 2.0));
+			glm::vec4 q;
+			float sum = 0.0f;
+			for (int c = 3, shift = 30; c >= 0; --c) {
+				if (c == largest) {
+					continue;
+				}
+				q[c] = (static_cast<int>((bits >> shift) & 0x7FFF) - 16383.5f) * scale * 2.0f;
+				sum += q[c] * q[c];
+				shift -= 15;
+			}
+			q[largest] = sqrt(std::max(0.0f, 1.0f - sum));
+			return q;
+		}
+	};
+	struct ChannelObject {
+		int sampler;
+		std::string targetPath;
+		int targetNode;
+	};
+	struct AnimationObject {
+		std::vector<SamplerObject> samplers;	// Animation data
+		float duration = 0.0f;					// Loop length when every sampler ends at the same time, 0 otherwise
+	};
+
+	// Everything the animation reads but never writes, built once by prepareAnimationData().
+	// Crowd copies share their source's, only the pose, cursors and LOD state are per instance.
+	struct AnimationData {
+		tinygltf::Model skeleton;			// Nodes, skins and animations of the model, no buffers
+		std::vector<std::vector<glm::mat4>> inverseBindMatrices;	// One per skin
+		std::vector<AnimationObject> animationObjects;
+		std::vector<int> nodeParents;		// Parent of every node, -1 for roots
+	};
+	std::shared_ptr<const AnimationData> animationData;
+	bool sharesAnimationData = false;	// Set on crowd copies, the source counts the shared data
+
+	// Last keyframe index of each channel of each clip, animation time is mostly monotonic
+	std::vector<std::vector<int>> channelCursors;
+
+	// Pose sharing: instances of the same model and clip at the same time reuse one evaluation.
+	// Crowd members pick a phase offset from a small set so only a few unique poses are evaluated.
+	std::string modelPath = "../Final_Project/model/bot/bot.glb";
+	size_t skeletonID = 0;
+	float phaseOffset = 0.0f;
+
+	// Animation level of detail. Small on-screen characters sample their pose every 2nd/4th/8th
+	// step and blend towards it in between, characters outside both frusta are not sampled at all.
+	struct AnimationLOD {
+		int updateInterval = 1;         // Simulation steps between pose evaluations
+		int stepsSinceUpdate = 0;
+		float blendStartTime = 0.0f;    // Animation time of the pose we are blending from
+		float blendEndTime = 0.0f;      // Animation time of the sampled pose we are blending to
+		bool inCameraView = true;
+		bool inShadowView = true;
+		bool needsResync = true;        // Set when the pose was not evaluated in the previous step
+	};
+	AnimationLOD lod;
+
+	// What the render thread needs from a simulated bot, copied into every scene snapshot
+	struct RenderState {
+		bool inCameraView = false;
+		bool inShadowView = false;
+		std::vector<glm::mat4> jointMatrices;
+	};
+
+	// Screen coverage (fraction of the viewport height) thresholds for each update interval
+	const float LOD_COVERAGE_FULL = 0.25f;
+	const float LOD_COVERAGE_HALF = 0.10f;
+	const float LOD_COVERAGE_QUARTER = 0.04f;
+
+	// Bind pose bounding sphere in model space, padded so animated limbs stay inside it
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+	const float BOUNDS_PADDING = 1.5f;
+
+	// Keys a channel cursor may step forward before falling back to a binary search
+	const int MAX_CURSOR_STEPS = 4;
+
+	// Largest joint displacement allowed when dropping keys during animation compression, as a
+	// fraction of the skeleton's size. Rotation and scale errors are measured at the end of the
+	// joint's longest chain of children, but never nearer than MIN_JOINT_EXTENT.
+	const float POSE_TOLERANCE = 0.0005f;
+	const float MIN_JOINT_EXTENT = 0.05f;
+
+	glm::mat4 getNodeTransform(const tinygltf::Node& node) {
+		glm::mat4 transform(1.0f);
+
+		if (node.matrix.size() == 16) {
+			transform = glm::make_mat4(node.matrix.data());
+		} else {
+			if (node.translation.size() == 3) {
+				transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+			}
+			if (node.rotation.size() == 4) {
+				glm::quat q(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
+				transform *= glm::mat4_cast(q);
+			}
+			if (node.scale.size() == 3) {
+				transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+			}
+		}
+		return transform;
+	}
+
+	void computeLocalNodeTransform(const tinygltf::Model& model,
+		int nodeIndex,
+		std::vector<glm::mat4> &localTransforms)
+	{
+		const tinygltf::Node& node = model.nodes[nodeIndex];
+
+		glm::mat4 localTransform = glm::mat4(1.0f); // Start with the identity matrix
+
+		// Step 1: Check for the `matrix` property
+		if (!node.matrix.empty()) {
+			// Use the provided matrix directly if it exists
+			localTransform = glm::make_mat4(node.matrix.data());
+		} else {
+			// Step 2: Apply translation, rotation, and scale
+			glm::vec3 translation(0.0f);
+			glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+			glm::vec3 scale(1.0f);
+
+			if (!node.translation.empty()) {
+				translation = glm::vec3(node.translation[0], node.translation[1], node.translation[2]);
+			}
+
+			if (!node.rotation.empty()) {
+				rotation = glm::quat(node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2]);
+			}
+
+			if (!node.scale.empty()) {
+				scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+			}
+
+			// Step 3: Combine translation, rotation, and scale into a single transform
+			localTransform = glm::translate(glm::mat4(1.0f), translation) *
+							 glm::mat4_cast(rotation) *
+							 glm::scale(glm::mat4(1.0f), scale);
+		}
+
+		// Step 4: Store the computed local transform
+		localTransforms[nodeIndex] = localTransform;
+	}
+
+
+	void computeGlobalNodeTransform(const tinygltf::Model& model,
+		const std::vector<glm::mat4> &localTransforms,
+		int nodeIndex, const glm::mat4& parentTransform,
+		std::vector<glm::mat4> &globalTransforms)
+	{
+		if (nodeIndex < 0 || nodeIndex >= model.nodes.size() ||
+			nodeIndex >= localTransforms.size() ||
+			nodeIndex >= globalTransforms.size()) {
+			return; // Or handle error appropriately
+			}
+
+		// Step 1: Compute the global transform for the current node
+		glm::mat4 globalTransform = parentTransform * localTransforms[nodeIndex];
+		globalTransforms[nodeIndex] = globalTransform;
+
+		// Step 2: Iterate over the children of the current node
+		const tinygltf::Node& node = model.nodes[nodeIndex];
+		for (int childIndex : node.children) {
+			// Recursively compute global transforms for child nodes
+			computeGlobalNodeTransform(model, localTransforms, childIndex, globalTransform, globalTransforms);
+		}
+	}
+
+	std::vector<SkinObject> prepareSkinning(const tinygltf::Model &model, const GltfBuffers &buffers, std::vector<std::vector<glm::mat4>> &inverseBindMatrices) {
+		std::vector<SkinObject> skinObjects;
+		inverseBindMatrices.assign(model.skins.size(), std::vector<glm::mat4>());
+
+		// In our Blender exporter, the default number of joints that may influence a vertex is set to 4, just for convenient implementation in shaders.
+
+		for (size_t i = 0; i < model.skins.size(); i++) {
+			SkinObject skinObject;
+
+			const tinygltf::Skin &skin = model.skins[i];
+
+			// Read inverseBindMatrices
+			const tinygltf::Accessor &accessor = model.accessors[skin.inverseBindMatrices];
+			assert(accessor.type == TINYGLTF_TYPE_MAT4);
+			const float *ptr = reinterpret_cast<const float *>(buffers.accessor(model, accessor));
+
+			std::vector<glm::mat4> &skinInverseBindMatrices = inverseBindMatrices[i];
+			skinInverseBindMatrices.resize(accessor.count);
+			for (size_t j = 0; j < accessor.count; j++) {
+				float m[16];
+				memcpy(m, ptr + j * 16, 16 * sizeof(float));
+				skinInverseBindMatrices[j] = glm::make_mat4(m);
+			}
+
+			assert(skin.joints.size() == accessor.count);
+
+			skinObject.globalJointTransforms.resize(skin.joints.size());
+			skinObject.jointMatrices.resize(skin.joints.size());
+
+			// ----------------------------------------------
+			// TODO: your code here to compute joint matrices
+			// Initialize local transforms for all nodes
+			std::vector<glm::mat4> localTransforms(model.nodes.size(), glm::mat4(1.0f));
+
+			// Compute local transforms for joints
+			for (int jointIndex : skin.joints) {
+				computeLocalNodeTransform(model, jointIndex, localTransforms);
+			}
+
+			// Initialize joint matrices for bind pose
+			for (size_t j = 0; j < skin.joints.size(); j++) {
+				int jointIndex = skin.joints[j];
+				skinObject.globalJointTransforms[j] = localTransforms[jointIndex];
+				skinObject.jointMatrices[j] = skinObject.globalJointTransforms[j] * skinInverseBindMatrices[j];
+			}
+			// ----------------------------------------------
+			skinObjects.push_back(skinObject);
+		}
+		return skinObjects;
+	}
+
+	int findKeyframeIndex(const SamplerObject& sampler, float animationTime)
+	{
+		int left = 0;
+		int right = sampler.keyCount() - 1;
+
+		while (left <= right) {
+			int mid = (left + right) / 2;
+
+			if (mid + 1 < sampler.keyCount() && sampler.keyTime(mid) <= animationTime && animationTime < sampler.keyTime(mid + 1)) {
+				return mid;
+			}
+			else if (sampler.keyTime(mid) > animationTime) {
+				right = mid - 1;
+			}
+			else { // animationTime >= times[mid + 1]
+				left = mid + 1;
+			}
+		}
+
+		// Target not found
+		return sampler.keyCount() - 2;
+	}
+
+	// Keyframe lookup for a channel that remembers where it was last frame. Uniformly resampled
+	// clips index directly, otherwise the cursor is advanced a few keys before falling back to
+	// the binary search (e.g. when the animation wraps around).
+	int findKeyframeIndex(const SamplerObject& sampler, float animationTime, int& cursor)
+	{
+		const int lastIndex = sampler.keyCount() - 2;
+
+		if (sampler.sampleRate > 0.0f) {
+			cursor = glm::clamp(static_cast<int>((animationTime - sampler.keyTime(0)) * sampler.sampleRate), 0, lastIndex);
+			return cursor;
+		}
+
+		cursor = glm::clamp(cursor, 0, lastIndex);
+		if (sampler.keyTime(cursor) <= animationTime) {
+			for (int steps = 0; steps < MAX_CURSOR_STEPS; ++steps) {
+				if (cursor == lastIndex || animationTime < sampler.keyTime(cursor + 1)) {
+					return cursor;
+				}
+				cursor++;
+			}
+		}
+
+		cursor = findKeyframeIndex(sampler, animationTime);
+		return cursor;
+	}
+
+	// Resample every sampler of a clip to a fixed rate, so keyframe lookup becomes a single multiply
+	void resampleAnimation(AnimationObject &animationObject, float sampleRate)
+	{
+		for (SamplerObject &sampler : animationObject.samplers) {
+			if (sampler.input.size() < 2) {
+				continue;
+			}
+
+			const float startTime = sampler.input.front();
+			const float endTime = sampler.input.back();
+			const int numKeys = static_cast<int>(ceil((endTime - startTime) * sampleRate)) + 1;
+			// Rotations are the only four component outputs in a glTF animation
+			const bool isRotation = sampler.outputIsRotation;
+
+			std::vector<float> input(numKeys);
+			std::vector<glm::vec4> output(numKeys);
+			int cursor = 0;
+			for (int k = 0; k < numKeys; ++k) {
+				float t = std::min(startTime + k / sampleRate, endTime);
+				int i = findKeyframeIndex(sampler, t, cursor);
+				float previousTime = sampler.input[i];
+				float nextTime = sampler.input[i + 1];
+				float alpha = glm::clamp((t - previousTime) / (nextTime - previousTime), 0.0f, 1.0f);
+
+				const glm::vec4 &value0 = sampler.output[i];
+				const glm::vec4 &value1 = sampler.output[i + 1];
+				if (sampler.interpolation == INTERPOLATION_STEP) {
+					output[k] = alpha < 1.0f ? value0 : value1;
+				} else if (isRotation) {
+					glm::quat q = glm::slerp(glm::quat(value0.w, value0.x, value0.y, value0.z),
+											 glm::quat(value1.w, value1.x, value1.y, value1.z), alpha);
+					output[k] = glm::vec4(q.x, q.y, q.z, q.w);
+				} else {
+					output[k] = glm::mix(value0, value1, alpha);
+				}
+				input[k] = t;
+			}
+
+			// The last key is clamped to the clip end, the spacing of every other key is exact
+			sampler.input = input;
+			sampler.output = output;
+			sampler.sampleRate = sampleRate;
+		}
+	}
+
+	// Distance from every node to the end of its longest chain of children, in the bind pose
+	std::vector<float> computeNodeExtents(const tinygltf::Model &model)
+	{
+		std::vector<float> extents(model.nodes.size(), -1.0f);
+		std::function<float(int)> extentOf = [&](int nodeIndex) {
+			if (extents[nodeIndex] >= 0.0f) {
+				return extents[nodeIndex];
+			}
+			extents[nodeIndex] = 0.0f;	// Guards against cycles in broken files
+			float extent = 0.0f;
+			for (int child : model.nodes[nodeIndex].children) {
+				float offset = glm::length(glm::vec3(getNodeTransform(model.nodes[child])[3]));
+				extent = std::max(extent, offset + extentOf(child));
+			}
+			extents[nodeIndex] = extent;
+			return extent;
+		};
+		for (size_t i = 0; i < model.nodes.size(); ++i) {
+			extentOf(static_cast<int>(i));
+		}
+		return extents;
+	}
+
+	// Drop keys that linear interpolation between their neighbours reproduces within the tolerances,
+	// valueTolerance in output units and rotationTolerance in radians
+	void reduceKeys(SamplerObject &sampler, float valueTolerance, float rotationTolerance)
+	{
+		const int numKeys = static_cast<int>(sampler.input.size());
+		if (numKeys < 3 || sampler.interpolation != INTERPOLATION_LINEAR) {
+			return;
+		}
+
+		auto interpolationError = [&](int first, int last, int i) {
+			float alpha = (sampler.input[i] - sampler.input[first]) / (sampler.input[last] - sampler.input[first]);
+			const glm::vec4 &value0 = sampler.output[first];
+			const glm::vec4 &value1 = sampler.output[last];
+			if (sampler.outputIsRotation) {
+				glm::quat q = glm::slerp(glm::quat(value0.w, value0.x, value0.y, value0.z),
+										 glm::quat(value1.w, value1.x, value1.y, value1.z), alpha);
+				const glm::vec4 &key = sampler.output[i];
+				float d = std::min(1.0f, std::abs(q.x * key.x + q.y * key.y + q.z * key.z + q.w * key.w));
+				return 2.0f * acos(d) > rotationTolerance;
+			}
+			return glm::length(glm::vec3(glm::mix(value0, value1, alpha) - sampler.output[i])) > valueTolerance;
+		};
+
+		std::vector<float> input;
+		std::vector<glm::vec4> output;
+		int anchor = 0;
+		input.push_back(sampler.input[0]);
+		output.push_back(sampler.output[0]);
+		while (anchor < numKeys - 1) {
+			// Extend the segment from the anchor for as long as every skipped key stays within tolerance
+			int end = anchor + 1;
+			while (end + 1 < numKeys) {
+				bool fits = true;
+				for (int i = anchor + 1; i <= end && fits; ++i) {
+					fits = !interpolationError(anchor, end + 1, i);
+				}
+				if (!fits) {
+					break;
+				}
+				end++;
+			}
+			input.push_back(sampler.input[end]);
+			output.push_back(sampler.output[end]);
+			anchor = end;
+		}
+
+		sampler.input = input;
+		sampler.output = output;
+	}
+
+	// Quantize a sampler's keys in place, the float input and output are released afterwards
+	void compressSampler(SamplerObject &sampler, float valueTolerance, float rotationTolerance)
+	{
+		const int numKeys = static_cast<int>(sampler.input.size());
+		if (numKeys < 2) {
+			return;
+		}
+		if (sampler.sampleRate == 0.0f) {
+			reduceKeys(sampler, valueTolerance, rotationTolerance);
+		}
+
+		sampler.startTime = sampler.input.front();
+		sampler.timeScale = (sampler.input.back() - sampler.startTime) / 65535.0f;
+		sampler.packedTimes.resize(sampler.input.size());
+		int numReduced = 0;
+		for (size_t i = 0; i < sampler.input.size(); ++i) {
+			float normalized = sampler.timeScale > 0.0f ? (sampler.input[i] - sampler.startTime) / sampler.timeScale : 0.0f;
+			uint16_t packedTime = static_cast<uint16_t>(glm::clamp(normalized + 0.5f, 0.0f, 65535.0f));
+
+			// Keys that quantize to the same time would make a zero length interval, keep the later one
+			if (numReduced > 0 && packedTime == sampler.packedTimes[numReduced - 1]) {
+				numReduced--;
+				sampler.sampleRate = 0.0f;
+			}
+			sampler.packedTimes[numReduced] = packedTime;
+			sampler.output[numReduced] = sampler.output[i];
+			numReduced++;
+		}
+		sampler.packedTimes.resize(numReduced);
+		sampler.output.resize(numReduced);
+
+		sampler.packedValues.resize(numReduced * 3);
+		if (sampler.outputIsRotation) {
+			const float scale = 32767.0f * float(M_SQRT1_2 * 2.0);
+			for (int i = 0; i < numReduced; ++i) {
+				glm::vec4 q = glm::normalize(sampler.output[i]);
+				int largest = 0;
+				for (int c = 1; c < 4; ++c) {
+					if (std::abs(q[c]) > std::abs(q[largest])) {
+						largest = c;
+					}
+				}
+				// q and -q are the same rotation, keep the dropped component positive
+				if (q[largest] < 0.0f) {
+					q = -q;
+				}
+
+				uint64_t bits = uint64_t(largest) << 45;
+				for (int c = 3, shift = 30; c >= 0; --c) {
+					if (c == largest) {
+						continue;
+					}
+					float quantized = glm::clamp(q[c] * 0.5f * scale + 16383.5f, 0.0f, 32767.0f);
+					bits |= uint64_t(quantized + 0.5f) << shift;
+					shift -= 15;
+				}
+				sampler.packedValues[i * 3 + 0] = static_cast<uint16_t>(bits >> 32);
+				sampler.packedValues[i * 3 + 1] = static_cast<uint16_t>(bits >> 16);
+				sampler.packedValues[i * 3 + 2] = static_cast<uint16_t>(bits);
+			}
+		} else {
+			glm::vec3 minValue(std::numeric_limits<float>::max());
+			glm::vec3 maxValue(-std::numeric_limits<float>::max());
+			for (const glm::vec4 &value : sampler.output) {
+				minValue = glm::min(minValue, glm::vec3(value));
+				maxValue = glm::max(maxValue, glm::vec3(value));
+			}
+			sampler.valueMin = minValue;
+			sampler.valueScale = (maxValue - minValue) / 65535.0f;
+			for (int i = 0; i < numReduced; ++i) {
+				for (int c = 0; c < 3; ++c) {
+					float normalized = sampler.valueScale[c] > 0.0f ? (sampler.output[i][c] - minValue[c]) / sampler.valueScale[c] : 0.0f;
+					sampler.packedValues[i * 3 + c] = static_cast<uint16_t>(glm::clamp(normalized + 0.5f, 0.0f, 65535.0f));
+				}
+			}
+		}
+
+		sampler.compressed = true;
+		std::vector<float>().swap(sampler.input);
+		std::vector<glm::vec4>().swap(sampler.output);
+	}
+
+	// The tolerances of a sampler follow from the node it animates, see POSE_TOLERANCE
+	void compressAnimation(const tinygltf::Animation &anim, AnimationObject &animationObject, const std::vector<float> &nodeExtents)
+	{
+		float skeletonSize = 0.0f;
+		for (float extent : nodeExtents) {
+			skeletonSize = std::max(skeletonSize, extent);
+		}
+		const float maxDisplacement = POSE_TOLERANCE * skeletonSize;
+		const float minExtent = std::max(MIN_JOINT_EXTENT * skeletonSize, std::numeric_limits<float>::min());
+
+		// Translations move points directly, rotations and scales move them a lever arm away. A sampler
+		// without a channel keeps every key, one shared by several channels takes the tightest tolerance.
+		std::vector<float> valueTolerances(animationObject.samplers.size(), -1.0f);
+		std::vector<float> rotationTolerances(animationObject.samplers.size(), -1.0f);
+		for (const tinygltf::AnimationChannel &channel : anim.channels) {
+			if (channel.sampler < 0 || channel.sampler >= static_cast<int>(animationObject.samplers.size()) ||
+				channel.target_node < 0 || channel.target_node >= static_cast<int>(nodeExtents.size())) {
+				continue;
+			}
+			float tolerance = maxDisplacement;
+			if (channel.target_path != "translation") {
+				tolerance /= std::max(nodeExtents[channel.target_node], minExtent);
+			}
+			float &current = channel.target_path == "rotation" ? rotationTolerances[channel.sampler] : valueTolerances[channel.sampler];
+			current = current < 0.0f ? tolerance : std::min(current, tolerance);
+		}
+
+		size_t rawBytes = 0;
+		size_t compressedBytes = 0;
+		for (size_t i = 0; i < animationObject.samplers.size(); ++i) {
+			SamplerObject &sampler = animationObject.samplers[i];
+			rawBytes += sampler.input.size() * sizeof(float) + sampler.output.size() * sizeof(glm::vec4);
+			compressSampler(sampler, std::max(valueTolerances[i], 0.0f), std::max(rotationTolerances[i], 0.0f));
+			compressedBytes += (sampler.packedTimes.size() + sampler.packedValues.size()) * sizeof(uint16_t);
+		}
+		LOG_INFO("Compressed animation keys: %zu -> %zu bytes (%.1fx)", rawBytes, compressedBytes,
+				 compressedBytes > 0 ? double(rawBytes) / double(compressedBytes) : 0.0);
+	}
+
+	std::vector<AnimationObject> prepareAnimation(const tinygltf::Model &model, const GltfBuffers &buffers)
+	{
+		std::vector<AnimationObject> animationObjects;
+		const std::vector<float> nodeExtents = computeNodeExtents(model);
+		for (const auto &anim : model.animations) {
+			AnimationObject animationObject;
+
+			for (size_t s = 0; s < anim.samplers.size(); ++s) {
+				const tinygltf::AnimationSampler &sampler = anim.samplers[s];
+				SamplerObject samplerObject;
+
+				const tinygltf::Accessor &inputAccessor = model.accessors[sampler.input];
+				const tinygltf::BufferView &inputBufferView = model.bufferViews[inputAccessor.bufferView];
+
+				assert(inputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+				assert(inputAccessor.type == TINYGLTF_TYPE_SCALAR);
+
+				// Input (time) values
+				samplerObject.input.resize(inputAccessor.count);
+
+				const unsigned char *inputPtr = buffers.accessor(model, inputAccessor);
+				const float *inputBuf = reinterpret_cast<const float*>(inputPtr);
+
+				// Read input (time) values
+				int stride = inputAccessor.ByteStride(inputBufferView);
+				for (size_t i = 0; i < inputAccessor.count; ++i) {
+					samplerObject.input[i] = *reinterpret_cast<const float*>(inputPtr + i * stride);
+				}
+
+				const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
+				const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
+
+				assert(outputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+
+				const unsigned char *outputPtr = buffers.accessor(model, outputAccessor);
+				const float *outputBuf = reinterpret_cast<const float*>(outputPtr);
+
+				int outputStride = outputAccessor.ByteStride(outputBufferView);
+
+				// Output values
+				samplerObject.output.resize(outputAccessor.count);
+				samplerObject.outputIsRotation = outputAccessor.type == TINYGLTF_TYPE_VEC4;
+
+				// Other interpolations are resolved here, once, so every channel still animates.
+				// CUBICSPLINE keys are (in-tangent, value, out-tangent), only the values are kept.
+				bool cubicSpline = sampler.interpolation == "CUBICSPLINE";
+				if (sampler.interpolation == "LINEAR" || cubicSpline) {
+					samplerObject.interpolation = INTERPOLATION_LINEAR;
+				} else {
+					samplerObject.interpolation = INTERPOLATION_STEP;
+				}
+				if (cubicSpline) {
+					LOG_WARN("Animation '%s' sampler %zu: CUBICSPLINE played back as LINEAR", anim.name.c_str(), s);
+				} else if (sampler.interpolation != "LINEAR" && sampler.interpolation != "STEP") {
+					LOG_WARN("Animation '%s' sampler %zu: unsupported interpolation '%s' played back as STEP",
+							 anim.name.c_str(), s, sampler.interpolation.c_str());
+				}
+
+				for (size_t i = 0; i < outputAccessor.count; ++i) {
+
+					if (outputAccessor.type == TINYGLTF_TYPE_VEC3) {
+						memcpy(&samplerObject.output[i], outputPtr + i * 3 * sizeof(float), 3 * sizeof(float));
+					} else if (outputAccessor.type == TINYGLTF_TYPE_VEC4) {
+						memcpy(&samplerObject.output[i], outputPtr + i * 4 * sizeof(float), 4 * sizeof(float));
+					} else {
+						LOG_WARN("Unsupport accessor type ...");
+					}
+
+				}
+
+				if (cubicSpline) {
+					for (size_t i = 0; i < samplerObject.input.size() && i * 3 + 1 < samplerObject.output.size(); ++i) {
+						samplerObject.output[i] = samplerObject.output[i * 3 + 1];
+					}
+					samplerObject.output.resize(std::min(samplerObject.output.size(), samplerObject.input.size()));
+				}
+
+				animationObject.samplers.push_back(samplerObject);
+			}
+
+			if (resampleAnimations) {
+				resampleAnimation(animationObject, ANIMATION_SAMPLE_RATE);
+			}
+			if (compressAnimations) {
+				compressAnimation(anim, animationObject, nodeExtents);
+			}
+
+			// The pose only repeats with the clip when every channel loops at the same time
+			for (const SamplerObject &sampler : animationObject.samplers) {
+				if (sampler.keyCount() < 2) {
+					continue;
+				}
+				if (animationObject.duration == 0.0f) {
+					animationObject.duration = sampler.endTime();
+				} else if (sampler.endTime() != animationObject.duration) {
+					animationObject.duration = 0.0f;
+					break;
+				}
+			}
+
+			animationObjects.push_back(animationObject);
+		}
+		return animationObjects;
+	}
+
+	void updateAnimation(
+		const tinygltf::Model &model,
+		const tinygltf::Animation &anim,
+		const AnimationObject &animationObject,
+		std::vector<int> &cursors,
+		float time,
+		std::vector<JointPose> &poses)
+	{
+		// Every channel sets one component of its node's pose, nodes without channels keep the identity
+		poses.assign(model.nodes.size(), JointPose());
+		for (size_t c = 0; c < anim.channels.size(); ++c) {
+			const auto &channel = anim.channels[c];
+
+			int targetNodeIndex = channel.target_node;
+			const SamplerObject &sampler = animationObject.samplers[channel.sampler];
+			if (sampler.keyCount() < 2) {
+				continue;
+			}
+
+			// Calculate current animation time (wrap if necessary)
+			float animationTime = fmod(time, sampler.endTime());
+			int keyframeIndex = findKeyframeIndex(sampler, animationTime, cursors[c]);
+			int nextKeyframeIndex = keyframeIndex + 1;
+
+			// Get the previous and next keyframe times
+			float previousTime = sampler.keyTime(keyframeIndex);
+			float nextTime = sampler.keyTime(nextKeyframeIndex);
+			float t = nextTime > previousTime ? (animationTime - previousTime) / (nextTime - previousTime) : 0.0f;
+
+			const glm::vec4 value0 = sampler.keyValue(keyframeIndex);
+			const glm::vec4 value1 = sampler.keyValue(nextKeyframeIndex);
+
+			if (channel.target_path == "translation") {
+				glm::vec3 translation;
+				if (sampler.interpolation == INTERPOLATION_LINEAR) {
+					// Perform linear interpolation
+					translation = glm::mix(glm::vec3(value0), glm::vec3(value1), t);
+				} else {
+					// Use the current keyframe's value
+					translation = glm::vec3(value0);
+				}
+
+				poses[targetNodeIndex].translation = translation;
+			} else if (channel.target_path == "rotation") {
+				glm::quat rotation0(value0.w, value0.x, value0.y, value0.z);
+				glm::quat rotation;
+				if (sampler.interpolation == INTERPOLATION_LINEAR) {
+					// Perform spherical linear interpolation (slerp) for smooth rotation
+					rotation = glm::slerp(rotation0, glm::quat(value1.w, value1.x, value1.y, value1.z), t);
+				} else {
+					rotation = rotation0;
+				}
+
+				poses[targetNodeIndex].rotation = rotation;
+			} else if (channel.target_path == "scale") {
+				glm::vec3 scale;
+				if (sampler.interpolation == INTERPOLATION_LINEAR) {
+					// Perform linear interpolation for smooth scaling transitions
+					scale = glm::mix(glm::vec3(value0), glm::vec3(value1), t);
+				} else {
+					scale = glm::vec3(value0);
+				}
+				poses[targetNodeIndex].scale = scale;
+			}
+		}
+	}
+
+	std::vector<int> computeNodeParents(const tinygltf::Model& model) {
+		std::vector<int> nodeParents(model.nodes.size(), -1); // Initialize with -1 (root nodes)
+
+		for (size_t i = 0; i < model.nodes.size(); ++i) {
+			const tinygltf::Node& node = model.nodes[i];
+			for (int childIndex : node.children) {
+				nodeParents[childIndex] = i; // Set the parent of the child
+			}
+		}
+
+		return nodeParents;
+	}
+
+	// Bounding sphere of the bind pose, taken from the min/max of every POSITION accessor
+	void computeBounds(const tinygltf::Model &model) {
+		glm::vec3 minBounds(std::numeric_limits<float>::max());
+		glm::vec3 maxBounds(-std::numeric_limits<float>::max());
+		bool found = false;
+
+		for (const auto &mesh : model.meshes) {
+			for (const auto &primitive : mesh.primitives) {
+				auto it = primitive.attributes.find("POSITION");
+				if (it == primitive.attributes.end()) {
+					continue;
+				}
+				const tinygltf::Accessor &accessor = model.accessors[it->second];
+				if (accessor.minValues.size() != 3 || accessor.maxValues.size() != 3) {
+					continue;
+				}
+				minBounds = glm::min(minBounds, glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]));
+				maxBounds = glm::max(maxBounds, glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]));
+				found = true;
+			}
+		}
+
+		if (!found) {
+			// No bounds in the file, never cull this model
+			boundsCenter = glm::vec3(0.0f);
+			boundsRadius = std::numeric_limits<float>::max();
+			return;
+		}
+		boundsCenter = 0.5f * (minBounds + maxBounds);
+		boundsRadius = 0.5f * glm::length(maxBounds - minBounds) * BOUNDS_PADDING;
+	}
+
+	// Decide whether the character is visible and how often its pose should be sampled
+	void updateVisibility(const glm::mat4& viewProjection, const glm::mat4& lightSpaceMatrix, const glm::vec3& cameraPos) {
+		glm::vec3 worldCenter = position + scale * boundsCenter;
+		float worldRadius = boundsRadius * std::max(scale.x, std::max(scale.y, scale.z));
+
+		bool wasVisible = lod.inCameraView || lod.inShadowView;
+		lod.inCameraView = Frustum::fromMatrix(viewProjection).intersectsSphere(worldCenter, worldRadius);
+		lod.inShadowView = Frustum::fromMatrix(lightSpaceMatrix).intersectsSphere(worldCenter, worldRadius);
+		if (!wasVisible && (lod.inCameraView || lod.inShadowView)) {
+			lod.needsResync = true;
+		}
+
+		// Fraction of the viewport height covered by the bounding sphere
+		float distance = std::max(glm::length(worldCenter - cameraPos), zNear);
+		float coverage = worldRadius / (distance * tan(glm::radians(FoV) * 0.5f));
+
+		int interval = 8;
+		if (coverage > LOD_COVERAGE_FULL) {
+			interval = 1;
+		} else if (coverage > LOD_COVERAGE_HALF) {
+			interval = 2;
+		} else if (coverage > LOD_COVERAGE_QUARTER) {
+			interval = 4;
+		}
+		// Only visible in the shadow map, the silhouette does not need a smooth pose
+		if (!lod.inCameraView) {
+			interval = 8;
+		}
+		lod.updateInterval = interval;
+	}
+
+	// Advance the animation by one fixed step to time, sampling the pose at the rate chosen by the LOD.
+	// The pose of the step before is kept for the render state to blend from.
+	void update(float time, float stepLength) {
+		if (!animationData || animationData->skeleton.animations.empty() || animationData->skeleton.skins.empty()) {
+			return;
+		}
+
+		// Outside the camera and shadow frusta, the pose is not needed at all
+		if (!lod.inCameraView && !lod.inShadowView) {
+			lod.needsResync = true;
+			return;
+		}
+
+		if (lod.needsResync) {
+			// Sample the current time directly so we never blend from a stale pose
+			samplePose(time);
+			previousNodePoses = nodePoses;
+			sampledNodePoses = nodePoses;
+			for (SkinObject& skinObject : skinObjects) {
+				skinObject.steppedJointMatrices = skinObject.jointMatrices;
+			}
+			lod.blendStartTime = time;
+			lod.blendEndTime = time;
+			lod.stepsSinceUpdate = 0;
+			lod.needsResync = false;
+			return;
+		}
+
+		for (SkinObject& skinObject : skinObjects) {
+			skinObject.steppedJointMatrices = skinObject.jointMatrices;
+		}
+
+		lod.stepsSinceUpdate++;
+		if (lod.stepsSinceUpdate >= lod.updateInterval || time >= lod.blendEndTime) {
+			// Blend from the pose of the last step towards the pose one interval ahead
+			float sampleTime = time + stepLength * (lod.updateInterval - 1);
+			previousNodePoses = nodePoses;
+			samplePose(sampleTime);
+			sampledNodePoses = nodePoses;
+			lod.blendStartTime = time;
+			lod.blendEndTime = sampleTime;
+			lod.stepsSinceUpdate = 0;
+
+			if (lod.updateInterval == 1) {
+				return;
+			}
+		}
+
+		float blendLength = lod.blendEndTime - lod.blendStartTime;
+		float alpha = blendLength > 0.0f ? glm::clamp((time - lod.blendStartTime) / blendLength, 0.0f, 1.0f) : 1.0f;
+		if (previousNodePoses.size() != sampledNodePoses.size()) {
+			return;
+		}
+		nodePoses.resize(sampledNodePoses.size());
+		for (size_t i = 0; i < nodePoses.size(); ++i) {
+			nodePoses[i] = JointPose::blend(previousNodePoses[i], sampledNodePoses[i], alpha);
+		}
+		buildJointMatrices();
+	}
+
+	// Evaluate the pose through the per-frame pose cache
+	void samplePose(float time) {
+		const int clip = 0;
+		float poseTime = time + phaseOffset;
+		const AnimationObject& animationObject = animationData->animationObjects[clip];
+		if (animationObject.duration > 0.0f) {
+			poseTime = fmod(poseTime, animationObject.duration);
+		}
+
+		PoseCache::Key key = { skeletonID, clip, PoseCache::quantize(poseTime) };
+		{
+			std::lock_guard<std::mutex> lock(poseCache.mutex);
+			if (const PoseCache::Entry* cached = poseCache.find(key)) {
+				nodePoses = cached->nodePoses;
+				for (size_t i = 0; i < skinObjects.size() && i < cached->jointMatrices.size(); ++i) {
+					skinObjects[i].jointMatrices = cached->jointMatrices[i];
+				}
+				return;
+			}
+		}
+
+		// Evaluate at the quantized time so every instance sharing the entry gets the same pose.
+		// Two characters missing on the same key at once both evaluate it, the result is identical.
+		evaluatePose(PoseCache::dequantize(key.quantizedTime));
+		std::lock_guard<std::mutex> lock(poseCache.mutex);
+		PoseCache::Entry& entry = poseCache.insert(key);
+		entry.nodePoses = nodePoses;
+		entry.jointMatrices.resize(skinObjects.size());
+		for (size_t i = 0; i < skinObjects.size(); ++i) {
+			entry.jointMatrices[i] = skinObjects[i].jointMatrices;
+		}
+	}
+
+// Complete skeletal animation update function with missing edge cases handled
+void evaluatePose(float time) {
+    // Early return if no animations or models exist
+    if (!animationData || animationData->skeleton.animations.empty() || animationData->skeleton.skins.empty()) {
+        return;
+    }
+
+    // Handle animation and skin data, shared read-only with every copy of this bot
+    const AnimationData& data = *animationData;
+    const tinygltf::Model& model = data.skeleton;
+
+    // Step 1: Sample the local pose of every node
+    updateAnimation(model, model.animations[0], data.animationObjects[0], channelCursors[0], time, nodePoses);
+    buildJointMatrices();
+}
+
+// Joint palettes of every skin from the local node poses
+void buildJointMatrices() {
+    const AnimationData& data = *animationData;
+    const tinygltf::Model& model = data.skeleton;
+    const tinygltf::Skin& skin = model.skins[0];
+    const std::vector<int>& nodeParents = data.nodeParents;
+    if (nodePoses.size() != model.nodes.size()) {
+        return;
+    }
+
+    // Local transforms of all nodes, scratch space comes from this worker's frame arena
+    FrameVector<glm::mat4> nodeTransforms(model.nodes.size());
+    for (size_t i = 0; i < nodePoses.size(); ++i) {
+        nodeTransforms[i] = nodePoses[i].matrix();
+    }
+
+    // Step 2: Parent relationships were computed once at load time
+
+    // Step 3: Process each skin object
+    for (size_t s = 0; s < skinObjects.size(); ++s) {
+        SkinObject& skinObject = skinObjects[s];
+        const std::vector<glm::mat4>& inverseBindMatrices = data.inverseBindMatrices[s];
+        const size_t numJoints = skin.joints.size();
+
+        // Validate joint data
+        if (inverseBindMatrices.size() != numJoints) {
+            continue;
+        }
+        skinObject.globalJointTransforms.resize(numJoints);
+
+        // Compute global transforms using parent hierarchy
+        for (size_t i = 0; i < numJoints; ++i) {
+            const int jointIndex = skin.joints[i];
+
+            // Validate joint index
+            if (jointIndex < 0 || jointIndex >= static_cast<int>(model.nodes.size())) {
+                continue;  // Skip invalid joint
+            }
+
+            const int parentIndex = nodeParents[jointIndex];
+
+            if (parentIndex == -1) {
+                skinObject.globalJointTransforms[i] = nodeTransforms[jointIndex];
+            } else {
+                // Find parent's transform index in the joints array
+                int parentTransformIndex = -1;
+                for (size_t j = 0; j < numJoints; ++j) {
+                    if (skin.joints[j] == parentIndex) {
+                        parentTransformIndex = j;
+                        break;
+                    }
+                }
+
+                if (parentTransformIndex != -1) {
+                    skinObject.globalJointTransforms[i] =
+                        skinObject.globalJointTransforms[parentTransformIndex] *
+                        nodeTransforms[jointIndex];
+                } else {
+                    // Parent isn't in joint list, use local transform
+                    skinObject.globalJointTransforms[i] = nodeTransforms[jointIndex];
+                }
+            }
+        }
+
+        // Step 4: Compute final joint matrices for GPU skinning
+        skinObject.jointMatrices.resize(numJoints);
+        for (size_t i = 0; i < numJoints; ++i) {
+            skinObject.jointMatrices[i] =
+                skinObject.globalJointTransforms[i] *
+                inverseBindMatrices[i];
+        }
+    }
+}
+
+	// CPU side of MyBot::initialize(), everything update() needs from the loaded model. Only reads
+	// buffers here, nothing keeps pointing into them afterwards.
+	void prepareAnimationData(const tinygltf::Model &model, const GltfBuffers &buffers) {
+		skeletonID = std::hash<std::string>()(modelPath);
+		std::shared_ptr<AnimationData> data = std::make_shared<AnimationData>();
+		data->skeleton.nodes = model.nodes;
+		data->skeleton.skins = model.skins;
+		data->skeleton.animations = model.animations;
+
+		// Prepare joint matrices
+		skinObjects = prepareSkinning(model, buffers, data->inverseBindMatrices);
+
+		// Prepare animation data
+		data->animationObjects = prepareAnimation(model, buffers);
+		data->nodeParents = computeNodeParents(model);
+		animationData = data;
+		resetChannelCursors();
+
+		// Bounds used for culling and animation LOD
+		computeBounds(model);
+	}
+
+	void resetChannelCursors() {
+		channelCursors.resize(animationData->skeleton.animations.size());
+		for (size_t i = 0; i < channelCursors.size(); ++i) {
+			channelCursors[i].assign(animationData->skeleton.animations[i].channels.size(), 0);
+		}
+	}
+
+	// CPU half of a crowd instance of an initialized bot, safe to run on a worker thread.
+	// The clips, skins and nodes are shared with the source, only the pose state is copied.
+	void copyInstance(const BotAnimation &source) {
+		sharesAnimationData = true;
+		modelPath = source.modelPath;
+		skeletonID = source.skeletonID;
+		animationData = source.animationData;
+		skinObjects = source.skinObjects;
+		nodePoses = source.nodePoses;
+		resetChannelCursors();
+		boundsCenter = source.boundsCenter;
+		boundsRadius = source.boundsRadius;
+	}
+
+	// Simulation thread side, reuses the capacity of the snapshot's palette. Blends the poses of the
+	// last two steps by alpha, the pose itself is only evaluated by update().
+	void captureRenderState(RenderState &state, float alpha) const {
+		state.inCameraView = lod.inCameraView;
+		state.inShadowView = lod.inShadowView;
+		if (skinObjects.empty()) {
+			state.jointMatrices.clear();
+			return;
+		}
+		const SkinObject &skinObject = skinObjects[0];
+		if (alpha >= 1.0f || skinObject.steppedJointMatrices.size() != skinObject.jointMatrices.size()) {
+			state.jointMatrices = skinObject.jointMatrices;
+			return;
+		}
+		state.jointMatrices.resize(skinObject.jointMatrices.size());
+		for (size_t i = 0; i < skinObject.jointMatrices.size(); ++i) {
+			state.jointMatrices[i] = skinObject.steppedJointMatrices[i] * (1.0f - alpha) +
+									 skinObject.jointMatrices[i] * alpha;
+		}
+	}
+
+	static const int MAX_PALETTE_JOINTS = 128;	// Must match MAX_JOINTS in animationVertexShader
+
+	// Top three rows of every joint matrix, the layout of the JointPalette uniform block (a mat3x4
+	// per joint). The last row of an affine transform is always (0,0,0,1) and is not stored.
+	static void packJointPalette(const std::vector<glm::mat4>& jointMatrices, size_t numJoints, glm::vec4* rows) {
+		for (size_t i = 0; i < numJoints; ++i) {
+			const glm::mat4& m = jointMatrices[i];
+			for (int r = 0; r < 3; ++r) {
+				rows[i * 3 + r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+			}
+		}
+	}
+
+	size_t residentBytes() const {
+		size_t bytes = 0;
+		for (const SkinObject &skinObject : skinObjects) {
+			bytes += ::residentBytes(skinObject.globalJointTransforms) +
+					 ::residentBytes(skinObject.jointMatrices) + ::residentBytes(skinObject.steppedJointMatrices);
+		}
+		bytes += ::residentBytes(nodePoses) + ::residentBytes(previousNodePoses) + ::residentBytes(sampledNodePoses);
+
+		// Shared animation data is counted once, by the bot that built it
+		if (animationData && !sharesAnimationData) {
+			for (const std::vector<glm::mat4> &inverseBindMatrices : animationData->inverseBindMatrices) {
+				bytes += ::residentBytes(inverseBindMatrices);
+			}
+			for (const AnimationObject &animationObject : animationData->animationObjects) {
+				for (const SamplerObject &sampler : animationObject.samplers) {
+					bytes += ::residentBytes(sampler.input) + ::residentBytes(sampler.output) +
+							 ::residentBytes(sampler.packedTimes) + ::residentBytes(sampler.packedValues);
+				}
+			}
+		}
+		return bytes;
+	}
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef _CLOUDS_H_
+#define _CLOUDS_H_
+
+#include <algorithm>
+#ifndef _USE_MATH_DEFINES
+#define _USE_MATH_DEFINES
+#endif
+#include <math.h>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/norm.hpp>
+#include <core/profiler.h>
+#include <core/resident_bytes.h>
+
+// Struct defining a particle to be used in a cloud system.
+struct CloudParticle {
+	glm::vec3 position;
+	glm::vec3 previousPosition;	// Position before the last simulation step
+	glm::vec3 velocity;
+	float size;
+	float alpha;
+	float life;
+};
+
+// CPU half of the cloud system: particles are stepped and sorted here, CloudSystem in main.cpp draws them
+struct CloudSimulation {
+	std::vector<CloudParticle> particles;	// Simulated on the CPU every frame
+	std::mt19937 gen;						// Seeded once, respawns draw from it every frame
+
+	int particleCount = 2000;				// Set before initialize(), e.g. by the benchmarks
+	const float CLOUD_HEIGHT_MIN = 150.0f; // Adjust based on mountain height
+	const float CLOUD_HEIGHT_MAX = 200.0f;
+	const float CLOUD_RADIUS = 300.0f;     // How far clouds spread from center
+
+	// A negative seed draws one from std::random_device
+	void initializeParticles(int seed) {
+		particles.clear();
+		particles.reserve(particleCount);
+
+		if (seed >= 0) {
+			gen.seed(static_cast<unsigned int>(seed));
+		} else {
+			std::random_device rd;
+			gen.seed(rd());
+		}
+		std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
+		std::uniform_real_distribution<float> radiusDist(0.0f, CLOUD_RADIUS);
+		std::uniform_real_distribution<float> heightDist(CLOUD_HEIGHT_MIN, CLOUD_HEIGHT_MAX);
+		std::uniform_real_distribution<float> sizeDist(20.0f, 40.0F);
+		std::uniform_real_distribution<float> lifeDist(5.0f, 10.0f );
+
+		// Sets up each particle to be used in our cloud effect, each particle is generated with a degree of randomness.
+		for(int i = 0; i < particleCount; i++) {
+			float angle = angleDist(gen);
+			float radius = radiusDist(gen);
+			float height = heightDist(gen);
+
+			CloudParticle particle;
+			particle.position = glm::vec3(
+				180.0f + radius * cos(angle),
+				height,
+				-100.0f + radius * sin(angle)
+				);
+			particle.previousPosition = particle.position;
+
+			particle.velocity = glm::vec3(
+				cos(angle) * 2.0f,
+				0.0f,
+				sin(angle) * 2.0f
+				);
+
+			particle.size = sizeDist(gen);
+			particle.alpha = 0.3f;
+			particle.life = lifeDist(gen);
+
+			particles.push_back(particle);
+		}
+	}
+
+	void update(float deltaTime) {
+		std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * M_PI);
+		std::uniform_real_distribution<float> radiusDist(0.0f, CLOUD_RADIUS);
+		std::uniform_real_distribution<float> heightDist(CLOUD_HEIGHT_MIN, CLOUD_HEIGHT_MAX);
+		std::uniform_real_distribution<float> sizeDist(20.0f, 40.0F);
+		std::uniform_real_distribution<float> lifeDist(5.0f, 10.0f );
+
+		// Iterate though each element in the container.
+		for(auto& particle : particles) {
+			particle.life -= deltaTime;
+
+			if (particle.life <= 0.0f) {
+				//Reset the particle to new random state.
+				float angle = angleDist(gen);
+				float radius = radiusDist(gen);
+				float height = heightDist(gen);
+
+				particle.position = glm::vec3(
+				180.0f + radius * cos(angle),
+				height,
+				-100.0f + radius * sin(angle)
+				);
+				particle.previousPosition = particle.position;	// Respawned, nothing to interpolate from
+
+				particle.velocity = glm::vec3(
+					cos(angle) * 2.0f,
+					0.0f,
+					sin(angle) * 2.0f
+					);
+
+				particle.size = sizeDist(gen);
+				particle.alpha = 0.3f;
+				particle.life = lifeDist(gen);
+			}
+			else {
+				// update particle position
+				particle.previousPosition = particle.position;
+				particle.position += particle.velocity * deltaTime;
+
+				// adjust the particle's alpha based on life.
+				particle.alpha = std::min(0.3f, particle.life * 0.1f);
+			}
+		}
+	}
+
+	// Per-particle draw data sorted back to front, built on the simulation thread.
+	// alpha interpolates each particle between its last two simulated positions.
+	void buildDrawList(const glm::mat4& ViewProjection, const glm::vec3& cameraPos, float alpha,
+					   std::vector<glm::mat4>& drawMVPs, std::vector<float>& drawAlphas) {
+		// Sort particles by distance to camera (back to front)
+		{
+			ProfileScope profileScope("cloud sort");
+			std::sort(particles.begin(), particles.end(),
+				[cameraPos](const CloudParticle& a, const CloudParticle& b) {
+					return glm::length2(a.position - cameraPos) > glm::length2(b.position - cameraPos);
+				});
+		}
+
+		drawMVPs.resize(particles.size());
+		drawAlphas.resize(particles.size());
+		for (size_t i = 0; i < particles.size(); ++i) {
+			glm::vec3 position = glm::mix(particles[i].previousPosition, particles[i].position, alpha);
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+			model = glm::scale(model, glm::vec3(particles[i].size));
+
+			drawMVPs[i] = ViewProjection * model;
+			drawAlphas[i] = particles[i].alpha;
+		}
+	}
+
+	size_t residentBytes() const {
+		return ::residentBytes(particles);
+	}
+};
+
+#endif
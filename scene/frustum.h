@@ -0,0 +1,41 @@
+#ifndef _FRUSTUM_H_
+#define _FRUSTUM_H_
+
+#include <glm/glm.hpp>
+
+// View frustum extracted from a view-projection matrix, used to skip work for objects that cannot be seen.
+struct Frustum {
+	glm::vec4 planes[6];
+
+	static Frustum fromMatrix(const glm::mat4& m) {
+		Frustum frustum;
+		// Rows of the matrix (glm is column-major)
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		frustum.planes[0] = row3 + row0; // Left
+		frustum.planes[1] = row3 - row0; // Right
+		frustum.planes[2] = row3 + row1; // Bottom
+		frustum.planes[3] = row3 - row1; // Top
+		frustum.planes[4] = row3 + row2; // Near
+		frustum.planes[5] = row3 - row2; // Far
+
+		for (auto& plane : frustum.planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const {
+		for (const auto& plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif
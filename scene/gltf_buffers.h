@@ -0,0 +1,59 @@
+#ifndef _GLTF_BUFFERS_H_
+#define _GLTF_BUFFERS_H_
+
+#include <cstddef>
+#include <vector>
+#include <tiny_gltf.h>
+#include <core/mapped_file.h>
+
+// Where the bytes of every buffer of a glTF model are while it is prepared. loadGltf() points the
+// BIN chunk of a .glb and external .bin files at their mapped pages, tinygltf never copies them.
+// Buffers tinygltf did load (data URIs, models built in memory) point into tinygltf::Buffer::data.
+// Everything read from the buffers has to be uploaded or copied before release().
+struct GltfBuffers {
+	std::vector<const unsigned char*> data;		// One per model.buffers entry
+	std::vector<size_t> sizes;
+	std::vector<MappedFile> files;				// Mappings the pointers above refer to
+
+	// Use the buffers tinygltf loaded itself
+	void useModel(const tinygltf::Model& model) {
+		release();
+		for (const tinygltf::Buffer& buffer : model.buffers) {
+			data.push_back(buffer.data.empty() ? nullptr : buffer.data.data());
+			sizes.push_back(buffer.data.size());
+		}
+	}
+
+	// False when a buffer view reaches past its buffer
+	bool validate(const tinygltf::Model& model) const {
+		for (const tinygltf::BufferView& bufferView : model.bufferViews) {
+			if (bufferView.buffer < 0 || bufferView.buffer >= static_cast<int>(data.size()) ||
+				data[bufferView.buffer] == nullptr ||
+				bufferView.byteOffset + bufferView.byteLength > sizes[bufferView.buffer]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const unsigned char* view(const tinygltf::Model& model, int bufferView) const {
+		const tinygltf::BufferView& view = model.bufferViews[bufferView];
+		return data[view.buffer] + view.byteOffset;
+	}
+
+	// First element of an accessor
+	const unsigned char* accessor(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const {
+		return view(model, accessor.bufferView) + accessor.byteOffset;
+	}
+
+	void release() {
+		for (MappedFile& file : files) {
+			file.close();
+		}
+		files.clear();
+		data.clear();
+		sizes.clear();
+	}
+};
+
+#endif
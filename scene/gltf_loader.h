@@ -0,0 +1,208 @@
+#ifndef _GLTF_LOADER_H_
+#define _GLTF_LOADER_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <tiny_gltf.h>
+#include <json.hpp>			// nlohmann::json, shipped next to tiny_gltf.h
+#include <scene/gltf_buffers.h>
+
+// Stands in for a buffer tinygltf should not load: one zero byte it decodes without touching the file
+static const char* GLTF_PLACEHOLDER_URI = "data:application/octet-stream;base64,AA==";
+
+// Percent-decoded relative URI, as tinygltf resolves external files
+static std::string decodeGltfUri(const std::string& uri) {
+	std::string decoded;
+	for (size_t i = 0; i < uri.size(); ++i) {
+		if (uri[i] == '%' && i + 2 < uri.size()) {
+			char hex[3] = { uri[i + 1], uri[i + 2], 0 };
+			decoded += static_cast<char>(strtol(hex, nullptr, 16));
+			i += 2;
+		} else {
+			decoded += uri[i];
+		}
+	}
+	return decoded;
+}
+
+// Split a mapped .glb into its JSON and BIN chunks, false when the header or chunk table is invalid
+static bool readGlbChunks(const MappedFile& file, const char*& json, size_t& jsonSize,
+						  const unsigned char*& bin, size_t& binSize) {
+	const uint32_t JSON_CHUNK = 0x4E4F534A;
+	const uint32_t BIN_CHUNK = 0x004E4942;
+	uint32_t header[3];
+	if (file.size < 20) {
+		return false;
+	}
+	memcpy(header, file.data, sizeof(header));
+	if (header[1] != 2 || header[2] > file.size) {
+		return false;
+	}
+
+	size_t offset = 12;
+	json = nullptr;
+	bin = nullptr;
+	jsonSize = 0;
+	binSize = 0;
+	while (offset + 8 <= header[2]) {
+		uint32_t chunk[2];
+		memcpy(chunk, file.data + offset, sizeof(chunk));
+		offset += 8;
+		if (chunk[0] > header[2] - offset) {
+			return false;
+		}
+		if (chunk[1] == JSON_CHUNK && json == nullptr) {
+			json = reinterpret_cast<const char*>(file.data + offset);
+			jsonSize = chunk[0];
+		} else if (chunk[1] == BIN_CHUNK && bin == nullptr) {
+			bin = file.data + offset;
+			binSize = chunk[0];
+		}
+		offset += (chunk[0] + 3) & ~size_t(3);
+	}
+	return json != nullptr;
+}
+
+// Load a .gltf or .glb. With mapBuffers, the JSON is read here first and every buffer held in the
+// BIN chunk or an external .bin file is swapped for GLTF_PLACEHOLDER_URI, so tinygltf only parses the
+// scene description and buffers points at the mapped pages. Data URIs, buffers images are decoded
+// from and loads without mapBuffers go through tinygltf, which copies them into the model.
+static bool loadGltf(tinygltf::Model& model, GltfBuffers& buffers, const std::string& path, bool mapBuffers,
+					 std::string& err, std::string& warn) {
+	tinygltf::TinyGLTF loader;
+	buffers.release();
+	const std::string baseDir = path.substr(0, path.find_last_of("/\\") + 1);
+	const bool isBinary = path.size() > 4 && path.compare(path.size() - 4, 4, ".glb") == 0;
+
+	MappedFile file;
+	if (!mapBuffers || !file.open(path.c_str())) {
+		bool res = isBinary ? loader.LoadBinaryFromFile(&model, &err, &warn, path)
+							: loader.LoadASCIIFromFile(&model, &err, &warn, path);
+		if (res) {
+			buffers.useModel(model);
+		}
+		return res;
+	}
+
+	const char* json = reinterpret_cast<const char*>(file.data);
+	size_t jsonSize = file.size;
+	const unsigned char* bin = nullptr;
+	size_t binSize = 0;
+	if (isBinary && !readGlbChunks(file, json, jsonSize, bin, binSize)) {
+		err = "Invalid .glb header or chunks in " + path;
+		file.close();
+		return false;
+	}
+
+	nlohmann::json document = nlohmann::json::parse(json, json + jsonSize, nullptr, false);
+	if (document.is_discarded() || !document.is_object()) {
+		err = "Invalid glTF JSON in " + path;
+		file.close();
+		return false;
+	}
+
+	// tinygltf decodes images while it loads, their buffers have to stay in the model
+	const size_t bufferCount = document.contains("buffers") && document["buffers"].is_array() ? document["buffers"].size() : 0;
+	std::vector<bool> keepBuffer(bufferCount, false);
+	if (document.contains("images") && document["images"].is_array() && document.contains("bufferViews")) {
+		for (const nlohmann::json& image : document["images"]) {
+			size_t bufferView = image.value("bufferView", size_t(-1));
+			if (bufferView < document["bufferViews"].size()) {
+				size_t buffer = document["bufferViews"][bufferView].value("buffer", size_t(-1));
+				if (buffer < bufferCount) {
+					keepBuffer[buffer] = true;
+				}
+			}
+		}
+	}
+
+	std::vector<const unsigned char*> mapped(bufferCount, nullptr);
+	std::vector<size_t> mappedSizes(bufferCount, 0);
+	std::vector<std::string> uris(bufferCount);
+	bool binChunkMapped = false;
+	for (size_t i = 0; i < bufferCount; ++i) {
+		nlohmann::json& buffer = document["buffers"][i];
+		size_t byteLength = buffer.value("byteLength", size_t(0));
+		uris[i] = buffer.value("uri", std::string());
+		if (keepBuffer[i] || uris[i].compare(0, 5, "data:") == 0) {
+			continue;
+		}
+
+		if (uris[i].empty()) {
+			// Only the first buffer of a .glb may refer to the BIN chunk
+			if (i != 0 || bin == nullptr || byteLength > binSize) {
+				continue;
+			}
+			mapped[i] = bin;
+			binChunkMapped = true;
+		} else {
+			MappedFile external;
+			if (!external.open((baseDir + decodeGltfUri(uris[i])).c_str())) {
+				continue;
+			}
+			if (external.size < byteLength) {
+				external.close();
+				continue;
+			}
+			mapped[i] = external.data;
+			buffers.files.push_back(std::move(external));
+		}
+		mappedSizes[i] = byteLength;
+		buffer["byteLength"] = 1;
+		buffer["uri"] = GLTF_PLACEHOLDER_URI;
+	}
+
+	// A .glb whose BIN chunk is still needed (e.g. by an embedded image) is handed over whole
+	bool res;
+	if (isBinary && bin != nullptr && !binChunkMapped) {
+		buffers.release();
+		res = loader.LoadBinaryFromMemory(&model, &err, &warn, file.data, static_cast<unsigned int>(file.size), baseDir);
+		file.close();
+		if (res) {
+			buffers.useModel(model);
+		}
+		return res;
+	}
+
+	std::string rewritten = document.dump();
+	res = loader.LoadASCIIFromString(&model, &err, &warn, rewritten.c_str(),
+									 static_cast<unsigned int>(rewritten.size()), baseDir);
+	if (!res) {
+		file.close();
+		buffers.release();
+		return false;
+	}
+
+	// The model keeps the original URIs and no bytes for the mapped buffers
+	buffers.data.assign(model.buffers.size(), nullptr);
+	buffers.sizes.assign(model.buffers.size(), 0);
+	for (size_t i = 0; i < model.buffers.size(); ++i) {
+		if (i < bufferCount && mapped[i] != nullptr) {
+			model.buffers[i].uri = uris[i];
+			std::vector<unsigned char>().swap(model.buffers[i].data);
+			buffers.data[i] = mapped[i];
+			buffers.sizes[i] = mappedSizes[i];
+		} else {
+			buffers.data[i] = model.buffers[i].data.empty() ? nullptr : model.buffers[i].data.data();
+			buffers.sizes[i] = model.buffers[i].data.size();
+		}
+	}
+	if (binChunkMapped) {
+		buffers.files.push_back(std::move(file));
+	} else {
+		file.close();
+	}
+
+	if (!buffers.validate(model)) {
+		err = "A buffer view reaches past its buffer in " + path;
+		buffers.release();
+		return false;
+	}
+	return true;
+}
+
+#endif
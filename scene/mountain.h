@@ -0,0 +1,147 @@
+#ifndef _MOUNTAIN_H_
+#define _MOUNTAIN_H_
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <core/resident_bytes.h>
+
+// CPU half of the mountain surrounding the scene: the triangle soup over the [-1, 1] footprint,
+// uploaded by Mountain in main.cpp
+struct MountainGeometry {
+    std::vector<float> vertex_buffer_data;
+    std::vector<float> normal_buffer_data;
+    std::vector<float> uv_buffer_data;
+
+    // Mountain generation parameters
+    int segments = 20;  // Number of segments per edge, set before initialize()
+    const float BASE_HEIGHT = 0.15f;
+    const float MAX_HEIGHT = 2.0f;
+
+    float perlinNoise(float x, float y) {
+        // Simple noise function for height variation
+        return sin(x * 0.1f) * cos(y * 0.1f) * 0.5f +
+               sin(x * 0.2f + y * 0.3f) * 0.25f;
+    }
+
+    float getHeight(float x, float z, float edgeDistance) {
+        // Create height variation that smoothly decreases as we move away from the edge
+        float noise = perlinNoise(x * 10.0f, z * 10.0f);
+        float height = MAX_HEIGHT * (1.0f - edgeDistance) * (0.8f + 0.2f * noise);
+        return std::max(BASE_HEIGHT, height);
+    }
+
+    void generateMountainGeometry() {
+        // Clear existing data
+        vertex_buffer_data.clear();
+        normal_buffer_data.clear();
+        uv_buffer_data.clear();
+
+        std::vector<std::vector<glm::vec3>> vertices;
+        std::vector<std::vector<float>> heights;
+
+        // Generate grid of vertices
+        for (int i = 0; i <= segments; i++) {
+            std::vector<glm::vec3> row;
+            std::vector<float> heightRow;
+            float z = -1.0f + (2.0f * i / segments);
+
+            for (int j = 0; j <= segments; j++) {
+                float x = -1.0f + (2.0f * j / segments);
+
+                // Calculate distance from edges
+                float distFromLeft = abs(x + 1.0f);
+                float distFromRight = abs(x - 1.0f);
+                float distFromBack = abs(z - 1.0f);
+
+                // Find minimum distance to any edge
+                float edgeDistance = std::min({distFromLeft, distFromRight, distFromBack});
+                edgeDistance = std::min(1.0f, edgeDistance * 2.0f);  // Scale distance for sharper falloff
+
+                // Generate height based on edge distance and noise
+                float height = getHeight(x, z, edgeDistance);
+
+                // Keep base height for points not near edges
+                if (edgeDistance > 0.8f) {
+                    height = BASE_HEIGHT;
+                }
+
+                // Store vertex and height
+                row.push_back(glm::vec3(x, height, z));
+                heightRow.push_back(height);
+            }
+            vertices.push_back(row);
+            heights.push_back(heightRow);
+        }
+
+        // Generate triangles
+        for (int i = 0; i < segments; i++) {
+            for (int j = 0; j < segments; j++) {
+                glm::vec3 v1 = vertices[i][j];
+                glm::vec3 v2 = vertices[i+1][j];
+                glm::vec3 v3 = vertices[i][j+1];
+                glm::vec3 v4 = vertices[i+1][j+1];
+
+                // Calculate normals
+                glm::vec3 normal1 = glm::normalize(glm::cross(v2 - v1, v3 - v1));
+                glm::vec3 normal2 = glm::normalize(glm::cross(v4 - v2, v3 - v2));
+
+                // First triangle
+                vertex_buffer_data.insert(vertex_buffer_data.end(), {
+                    v1.x, v1.y, v1.z,
+                    v2.x, v2.y, v2.z,
+                    v3.x, v3.y, v3.z
+                });
+
+                // Second triangle
+                vertex_buffer_data.insert(vertex_buffer_data.end(), {
+                    v2.x, v2.y, v2.z,
+                    v4.x, v4.y, v4.z,
+                    v3.x, v3.y, v3.z
+                });
+
+                // Normals for first triangle
+                normal_buffer_data.insert(normal_buffer_data.end(), {
+                    normal1.x, normal1.y, normal1.z,
+                    normal1.x, normal1.y, normal1.z,
+                    normal1.x, normal1.y, normal1.z
+                });
+
+                // Normals for second triangle
+                normal_buffer_data.insert(normal_buffer_data.end(), {
+                    normal2.x, normal2.y, normal2.z,
+                    normal2.x, normal2.y, normal2.z,
+                    normal2.x, normal2.y, normal2.z
+                });
+
+                // UV coordinates
+                float texU1 = static_cast<float>(j) / segments;
+                float texU2 = static_cast<float>(j + 1) / segments;
+                float texV1 = static_cast<float>(i) / segments;
+                float texV2 = static_cast<float>(i + 1) / segments;
+
+                // UVs for first triangle
+                uv_buffer_data.insert(uv_buffer_data.end(), {
+                	texU1, texV1,
+					texU1, texV2,
+					texU2, texV1
+                });
+
+                // UVs for second triangle
+                uv_buffer_data.insert(uv_buffer_data.end(), {
+                	texU1, texV2,
+                	texU2, texV2,
+                	texU2, texV1
+                });
+            }
+        }
+    }
+
+    size_t residentBytes() const {
+        return ::residentBytes(vertex_buffer_data) + ::residentBytes(normal_buffer_data) +
+               ::residentBytes(uv_buffer_data);
+    }
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef _SEA_H_
+#define _SEA_H_
+
+#include <cstdint>
+#include <math.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <core/resident_bytes.h>
+
+// CPU half of the sea off the cliff: the grid and the waves evaluated on it every simulation step.
+// world_setup in main.cpp uploads and draws it.
+struct SeaSimulation {
+	struct SeaVertex {
+		glm::vec3 position;
+		glm::vec2 texCoord;
+		glm::vec3 normal;
+	};
+
+	std::vector<SeaVertex> seaVertices;	// Kept, the waves are animated on the CPU
+	std::vector<SeaVertex> previousSeaVertices;	// Waves of the step before seaVertices
+	std::vector<uint32_t> seaIndices;	// Released once uploaded
+	float seaTime = 0.0f;
+	float previousSeaTime = 0.0f;
+	float evaluatedSeaTime = -1.0f;		// Wave time seaVertices currently hold
+
+	int seaGridSize = 64;				// Vertices per side, set before intialize()
+	const float SEA_EXTEND_OUT = 2000.0f;
+	const float SEA_EXTEND_SIDE = 3000.0f;
+	const float CLIFF_BASE_X = 0.0f;
+	const float TEXTURE_REPEAT = 50.0f;
+
+	// CPU side of world_setup::initializeCliffSea(), the grid the waves are evaluated on
+	void generateCliffSea() {
+    seaVertices.clear();
+    seaIndices.clear();
+
+    // Calculate grid spacings
+    float gridSpacingOut = SEA_EXTEND_OUT / (seaGridSize - 1);
+    float gridSpacingSide = SEA_EXTEND_SIDE / (seaGridSize - 1);
+
+    // Generate vertices with higher density near cliff
+    for (int z = 0; z < seaGridSize; z++) {
+        for (int x = 0; x < seaGridSize; x++) {
+            SeaVertex vertex;
+
+            // Use exponential distribution for x-coordinates (outward from cliff)
+            float xProgress = static_cast<float>(x) / (seaGridSize - 1);
+            float xPos = CLIFF_BASE_X - SEA_EXTEND_OUT * (1.0f - exp(-3.0f *(1.0f - xProgress)));
+
+            // Use a wider range for z-coordinates (lateral spread)
+            float zProgress = static_cast<float>(z) / (seaGridSize - 1);
+            // Center the z-coordinate range around the cliff
+            float zPos = -SEA_EXTEND_SIDE/2 + zProgress * SEA_EXTEND_SIDE;
+
+            vertex.position = glm::vec3(xPos, -0.15f, zPos);
+
+            // Calculate texture coordinates with more detail near cliff
+            vertex.texCoord.x = (1.0f - xProgress) * TEXTURE_REPEAT;
+            vertex.texCoord.y = zProgress * TEXTURE_REPEAT;
+
+            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+
+            seaVertices.push_back(vertex);
+        }
+    }
+
+    // Generate indices for triangle strips
+    for (int z = 0; z < seaGridSize - 1; z++) {
+        for (int x = 0; x < seaGridSize - 1; x++) {
+            uint32_t topLeft = z * seaGridSize + x;
+            uint32_t topRight = topLeft + 1;
+            uint32_t bottomLeft = (z + 1) * seaGridSize + x;
+            uint32_t bottomRight = bottomLeft + 1;
+
+            seaIndices.push_back(topLeft);
+            seaIndices.push_back(bottomLeft);
+            seaIndices.push_back(topRight);
+
+            seaIndices.push_back(topRight);
+            seaIndices.push_back(bottomLeft);
+            seaIndices.push_back(bottomRight);
+        }
+    }
+    previousSeaVertices = seaVertices;
+}
+
+	// One fixed simulation step, the waves are a function of seaTime only
+	void stepCliffSea(float step) {
+    previousSeaTime = seaTime;
+    seaTime += step;
+}
+
+	// CPU only, runs on a worker thread. Evaluates the waves of the last two steps, reusing the
+	// previous evaluation when a single step was taken.
+	void simulateCliffSea() {
+    if (seaTime == evaluatedSeaTime) {
+        return;
+    }
+    if (previousSeaTime == evaluatedSeaTime) {
+        seaVertices.swap(previousSeaVertices);
+    } else {
+        evaluateCliffSea(previousSeaVertices, previousSeaTime);
+    }
+    evaluateCliffSea(seaVertices, seaTime);
+    evaluatedSeaTime = seaTime;
+}
+
+	// Writes the wave heights and normals at waveTime, the grid positions are left as generated
+	void evaluateCliffSea(std::vector<SeaVertex>& vertices, float waveTime) {
+    for (size_t i = 0; i < vertices.size(); i++) {
+        SeaVertex& vertex = vertices[i];
+
+        // Calculate distance from cliff base for wave scaling
+        float distFromCliff = abs(vertex.position.x - CLIFF_BASE_X);
+        float waveScale = exp(-distFromCliff / 500.0f); // Waves diminish with distance
+
+        // Calculate distance from center for lateral wave scaling
+        float distFromCenter = abs(vertex.position.z);
+        float lateralScale = exp(-distFromCenter / 1000.0f); // Waves diminish with lateral distance
+
+        // Combine both scaling factors
+        float combinedScale = waveScale * (0.7f + 0.3f * lateralScale);
+
+        // Composite wave function
+        float x = vertex.position.x;
+        float z = vertex.position.z;
+        float height = 0.0f;
+
+        // Base wave formation parameters
+        const float BASE_SEA_LEVEL = -0.15f;
+        const float MAX_WAVE_HEIGHT = 0.1f;
+
+        // Function to create a shaped wave peak
+        auto createWavePeak = [](float phase, float peakWidth = 1.0f) {
+            // Create sharper peaks using power and smoothstep
+            float base = sin(phase);
+            float shaped = base * base * base * base;  // Sharpen peaks
+            return shaped * glm::smoothstep(0.0f, 1.0f, 0.5f + base * 0.5f);
+        };
+
+        // Create multiple wave groups moving at different speeds and directions
+        // Wave Group 1 - Large primary waves
+        {
+            float waveLength = 80.0f;
+            float speed = 0.4f;
+            float direction = 0.8f;  // Angle relative to cliff
+            float phase = (x * direction + z * (1.0f - direction)) / waveLength + waveTime * speed;
+            height += createWavePeak(phase) * 0.08f;
+        }
+
+        // Wave Group 2 - Medium waves at different angle
+        {
+            float waveLength = 60.0f;
+            float speed = 0.3f;
+            float direction = 0.6f;
+            float phase = (x * direction - z * (1.0f - direction)) / waveLength + waveTime * speed;
+            height += createWavePeak(phase, 1.5f) * 0.06f;
+        }
+
+        // Wave Group 3 - Smaller, faster waves
+        {
+            float waveLength = 40.0f;
+            float speed = 0.5f;
+            float direction = 0.4f;
+            float phase = (x * direction + z * (1.0f - direction)) / waveLength + waveTime * speed;
+            height += createWavePeak(phase, 2.0f) * 0.04f;
+        }
+
+        // Add subtle surface variation
+        height += sin(x * 0.05f + z * 0.05f + waveTime * 0.8f) * 0.01f;
+
+        // Apply scaling and ensure waves stay within bounds
+        height *= waveScale;
+        height = glm::clamp(height, -MAX_WAVE_HEIGHT, MAX_WAVE_HEIGHT);
+        vertex.position.y = BASE_SEA_LEVEL + height;
+
+        // Calculate wave normal based on the final wave shape
+        float heightScale = height / MAX_WAVE_HEIGHT; // Normalize height for normal calculation
+        float dx = heightScale * waveScale * 0.4f;   // Scale normal based on wave height and distance
+        float dz = heightScale * waveScale * 0.3f;
+        vertex.normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+
+        // Scale waves based on combined distance factor
+        height *= combinedScale;
+
+        // Clamp the height to prevent waves from going above cliff base
+        height = glm::clamp(height, -MAX_WAVE_HEIGHT, MAX_WAVE_HEIGHT);
+        vertex.position.y = BASE_SEA_LEVEL + height;
+
+        // Calculate normal based on wave height gradients
+        float Dx = cos(x * 0.01f + z * 0.01f + waveTime * 0.5f) * 0.015f * combinedScale;
+        float Dz = cos(z * 0.02f + waveTime * 0.8f) * 0.02f * combinedScale;
+        vertex.normal = glm::normalize(glm::vec3(-Dx, 1.0f, -Dz));
+    }
+
+}
+
+	// Blends the last two evaluated steps into out for a frame, returns the wave time they stand for.
+	// Normals are not renormalised, the lighting shader does.
+	float interpolateCliffSea(float alpha, std::vector<SeaVertex>& out) const {
+    out.resize(seaVertices.size());
+    for (size_t i = 0; i < seaVertices.size(); i++) {
+        const SeaVertex& previous = previousSeaVertices[i];
+        const SeaVertex& current = seaVertices[i];
+        out[i].position = glm::vec3(current.position.x, glm::mix(previous.position.y, current.position.y, alpha), current.position.z);
+        out[i].texCoord = current.texCoord;
+        out[i].normal = glm::mix(previous.normal, current.normal, alpha);
+    }
+    return glm::mix(previousSeaTime, seaTime, alpha);
+}
+
+	size_t residentBytes() const {
+		return ::residentBytes(seaVertices) + ::residentBytes(previousSeaVertices) + ::residentBytes(seaIndices);
+	}
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _SCENE_SETTINGS_H_
+#define _SCENE_SETTINGS_H_
+
+// Settings the CPU side of the scene reads, shared by main.cpp and the CPU benchmarks.
+// main.cpp changes some of them from the command line.
+
+// Camera projection, also sizes the bots' animation LOD
+static float FoV = 40.0f;
+static float zNear = 1.0f;
+static float zFar = 1500.0f;
+
+// Animation
+static bool resampleAnimations = false;			// Resample clips to a uniform rate at load time
+static const float ANIMATION_SAMPLE_RATE = 30.0f;	// Keys per second of resampled clips
+static bool compressAnimations = true;			// Quantize clips and drop redundant keys at load time
+
+// Simulation runs at a fixed rate, rendering interpolates between the last two steps
+static const float SIMULATION_STEP = 1.0f / 60.0f;
+static const int MAX_SIMULATION_STEPS = 8;		// Drop time after a hitch instead of spiralling
+
+#endif